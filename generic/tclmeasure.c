@@ -5,6 +5,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <tcl.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MEAS_HAVE_SSE2
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MEAS_HAVE_AVX2
+#endif
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
@@ -26,6 +43,7 @@
  *
  * Side Effects:
  *      - Ensures the namespace `::tclmeasure` exists
+ *      - Allocates the per-interpreter MeasConfig, shared by all commands as client data
  *      - Registers the following object-based commands:
  *          ::tclmeasure::TrigTarg
  *          ::tclmeasure::FindDerivWhen
@@ -33,11 +51,20 @@
  *          ::tclmeasure::DerivAt
  *          ::tclmeasure::Integ
  *          ::tclmeasure::MinMaxPPMinAtMaxAt
+ *          ::tclmeasure::configure
+ *          ::tclmeasure::Stream
+ *          ::tclmeasure::rawfile
+ *          ::tclmeasure::readtable
+ *          ::tclmeasure::vector
+ *          ::tclmeasure::dataset
+ *          ::tclmeasure::Sweep
+ *          ::tclmeasure::accumulator
  *      - Marks the extension as available via `package require tclmeasure`
  *
  * Notes:
  *      - Requires Tcl version 8.6 through 10.0 (inclusive), verified via `Tcl_InitStubs()`
  *      - Relies on `Tcl_CreateObjCommand2`, which requires Tcl 8.6+
+ *      - Vector arguments of all commands are converted to the "measvector" type (see GetMeasVectorFromObj)
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
@@ -53,1842 +80,8242 @@ extern DLLEXPORT int Tclmeasure_Init(Tcl_Interp *interp) {
     if (Tcl_PkgProvideEx(interp, PACKAGE_NAME, PACKAGE_VERSION, NULL) != TCL_OK) {
         return TCL_ERROR;
     }
-    Tcl_CreateObjCommand2(interp, "::tclmeasure::TrigTarg", (Tcl_ObjCmdProc2 *)TrigTargCmdProc2, NULL, NULL);
-    Tcl_CreateObjCommand2(interp, "::tclmeasure::FindDerivWhen", (Tcl_ObjCmdProc2 *)FindDerivWhenCmdProc2, NULL, NULL);
-    Tcl_CreateObjCommand2(interp, "::tclmeasure::FindAt", (Tcl_ObjCmdProc2 *)FindAtCmdProc2, NULL, NULL);
-    Tcl_CreateObjCommand2(interp, "::tclmeasure::DerivAt", (Tcl_ObjCmdProc2 *)DerivAtCmdProc2, NULL, NULL);
-    Tcl_CreateObjCommand2(interp, "::tclmeasure::Integ", (Tcl_ObjCmdProc2 *)IntegCmdProc2, NULL, NULL);
+    MeasConfig *configPtr = (MeasConfig *)Tcl_Alloc(sizeof(MeasConfig));
+    configPtr->checkX = 0;
+    configPtr->threads = 1;
+    configPtr->reproducible = 0;
+    configPtr->cumulative = 0;
+    configPtr->streams = 0;
+    configPtr->files = 0;
+    configPtr->sets = 0;
+    configPtr->accums = 0;
+    configPtr->binary = 0;
+    configPtr->kernel = BestKernel();
+    Tcl_SetAssocData(interp, "tclmeasure", FreeMeasConfig, configPtr);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::TrigTarg", (Tcl_ObjCmdProc2 *)TrigTargCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::FindDerivWhen", (Tcl_ObjCmdProc2 *)FindDerivWhenCmdProc2, configPtr,
+                          NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::WhenLevels", (Tcl_ObjCmdProc2 *)WhenLevelsCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::TrigTargLevels", (Tcl_ObjCmdProc2 *)TrigTargLevelsCmdProc2,
+                          configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::FindAt", (Tcl_ObjCmdProc2 *)FindAtCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::DerivAt", (Tcl_ObjCmdProc2 *)DerivAtCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Integ", (Tcl_ObjCmdProc2 *)IntegCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Avg", (Tcl_ObjCmdProc2 *)AvgCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Rms", (Tcl_ObjCmdProc2 *)RmsCmdProc2, configPtr, NULL);
     Tcl_CreateObjCommand2(interp, "::tclmeasure::MinMaxPPMinAtMaxAt", (Tcl_ObjCmdProc2 *)MinMaxPPMinAtMaxAtCmdProc2,
-                          NULL, NULL);
+                          configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Stats", (Tcl_ObjCmdProc2 *)StatsCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Columns", (Tcl_ObjCmdProc2 *)ColumnsCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::configure", (Tcl_ObjCmdProc2 *)ConfigureCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Stream", (Tcl_ObjCmdProc2 *)NewStreamCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::rawfile", (Tcl_ObjCmdProc2 *)RawfileCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::readtable", (Tcl_ObjCmdProc2 *)ReadTableCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::vector", (Tcl_ObjCmdProc2 *)VectorCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::dataset", (Tcl_ObjCmdProc2 *)DatasetCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::Sweep", (Tcl_ObjCmdProc2 *)SweepCmdProc2, configPtr, NULL);
+    Tcl_CreateObjCommand2(interp, "::tclmeasure::accumulator", (Tcl_ObjCmdProc2 *)AccumulatorCmdProc2, configPtr,
+                          NULL);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * CalcXBetween --
+ * FreeMeasConfig --
  *
- *      Compute the X-coordinate of a point lying on the line segment between (x1, y1) and (x2, y2),
- *      given a specific Y-coordinate (yBetween). This is a linear interpolation along the line.
+ *      Release the per-interpreter settings when the interpreter is deleted.
  *
  * Parameters:
- *      double x1         - input: X-coordinate of the first point
- *      double y1         - input: Y-coordinate of the first point
- *      double x2         - input: X-coordinate of the second point
- *      double y2         - input: Y-coordinate of the second point
- *      double yBetween   - input: Y value for which to compute the corresponding X on the line
+ *      void *clientData          - input: MeasConfig allocated in Tclmeasure_Init
+ *      Tcl_Interp *interp        - input: interpreter being deleted (unused)
  *
  * Results:
- *      Returns the interpolated X-coordinate such that (x, yBetween) lies on the line from (x1, y1) to (x2, y2)
+ *      None
  *
  * Side Effects:
- *      None
+ *      Frees the settings structure
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static inline double CalcXBetween(double x1, double y1, double x2, double y2, double yBetween) {
-    return (yBetween - y1) * (x2 - x1) / (y2 - y1) + x1;
+static void FreeMeasConfig(void *clientData, Tcl_Interp *interp) {
+    Tcl_Free((char *)clientData);
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * CalcYBetween --
+ * ConfigureCmdProc2 --
  *
- *      Compute the Y-coordinate of a point lying on the line segment between (x1, y1) and (x2, y2),
- *      given a specific X-coordinate (xBetween). This is a linear interpolation along the line.
+ *      Implements the `::tclmeasure::configure` command that queries or changes package settings of the interpreter.
  *
  * Parameters:
- *      double x1         - input: X-coordinate of the first point
- *      double y1         - input: Y-coordinate of the first point
- *      double x2         - input: X-coordinate of the second point
- *      double y2         - input: Y-coordinate of the second point
- *      double xBetween   - input: X value for which to compute the corresponding Y on the line
+ *      void *clientData              - input: MeasConfig of the interpreter
+ *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          (no arguments)            - return dictionary with all settings
+ *          option                    - return value of one setting
+ *          option value ?...?        - change settings
+ *
+ *      Supported options:
+ *          -checkx bool              - check that x vectors are strictly increasing before measurements, the result
+ *                                      of the check is cached in the vector
+ *          -threads count            - number of threads that share the reductions and crossing searches over long
+ *                                      ranges, 1 (default) runs everything in the calling thread
+ *          -reproducible bool        - sum integrals over fixed blocks combined pairwise, so Integ, Avg, Rms and Stats
+ *                                      give the same result for any number of threads
+ *          -cumulative bool          - compute Integ, Avg, Rms and the averages of Stats from cumulative integrals
+ *                                      built once per pair of x and y vectors and cached in the y vector
+ *          -binary bool              - return the vectors of -between, -cum and `all` crossings as bytearrays of
+ *                                      little-endian doubles (`binary format q*`) instead of lists, and read
+ *                                      bytearray arguments of whole doubles as such doubles instead of lists
+ *
+ *      Hidden option, not listed with the settings:
+ *          -kernel name              - implementation of the range scans and crossing masks in this interpreter:
+ *                                      auto (default, the fastest one the CPU supports), scalar, sse2 or avx2, used
+ *                                      by the tests
  *
  * Results:
- *      Returns the interpolated Y-coordinate such that (xBetween, y) lies on the line from (x1, y1) to (x2, y2)
+ *      TCL_OK with the requested settings or empty result after a change; TCL_ERROR on unknown option, bad value or
+ *      a kernel that the build or the CPU does not support
  *
  * Side Effects:
- *      None
+ *      Changes the settings used by subsequent measurements in this interpreter
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static inline double CalcYBetween(double x1, double y1, double x2, double y2, double xBetween) {
-    return (y2 - y1) / (x2 - x1) * (xBetween - x1) + y1;
+static int ConfigureCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    int option;
+    if (objc == 1) {
+        Tcl_Obj *result = Tcl_NewDictObj();
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("-checkx", -1), Tcl_NewBooleanObj(configPtr->checkX));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("-threads", -1), Tcl_NewIntObj(configPtr->threads));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("-reproducible", -1),
+                       Tcl_NewBooleanObj(configPtr->reproducible));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("-cumulative", -1), Tcl_NewBooleanObj(configPtr->cumulative));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("-binary", -1), Tcl_NewBooleanObj(configPtr->binary));
+        Tcl_SetObjResult(interp, result);
+        return TCL_OK;
+    }
+    if ((objc == 2) && (strcmp(Tcl_GetString(objv[1]), "-kernel") == 0)) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(MeasKernels[configPtr->kernel], -1));
+        return TCL_OK;
+    }
+    if (objc == 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[1], ConfigOptions, "option", 0, &option) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch ((enum ConfigOptions)option) {
+        case CONFIG_CHECKX:
+            Tcl_SetObjResult(interp, Tcl_NewBooleanObj(configPtr->checkX));
+            break;
+        case CONFIG_THREADS:
+            Tcl_SetObjResult(interp, Tcl_NewIntObj(configPtr->threads));
+            break;
+        case CONFIG_REPRODUCIBLE:
+            Tcl_SetObjResult(interp, Tcl_NewBooleanObj(configPtr->reproducible));
+            break;
+        case CONFIG_CUMULATIVE:
+            Tcl_SetObjResult(interp, Tcl_NewBooleanObj(configPtr->cumulative));
+            break;
+        case CONFIG_BINARY:
+            Tcl_SetObjResult(interp, Tcl_NewBooleanObj(configPtr->binary));
+            break;
+        };
+        return TCL_OK;
+    }
+    if (objc % 2 == 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?option? ?value option value ...?");
+        return TCL_ERROR;
+    }
+    for (Tcl_Size i = 1; i < objc; i += 2) {
+        if (strcmp(Tcl_GetString(objv[i]), "-kernel") == 0) {
+            int kernel;
+            if (Tcl_GetIndexFromObj(interp, objv[i + 1], MeasKernels, "kernel", 0, &kernel) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (kernel == KERNEL_AUTO) {
+                kernel = BestKernel();
+            } else if (!KernelSupported(kernel)) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Kernel '%s' is not supported by the build or the CPU",
+                                                       MeasKernels[kernel]));
+                return TCL_ERROR;
+            }
+            configPtr->kernel = kernel;
+            continue;
+        }
+        if (Tcl_GetIndexFromObj(interp, objv[i], ConfigOptions, "option", 0, &option) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch ((enum ConfigOptions)option) {
+        case CONFIG_CHECKX:
+            if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &configPtr->checkX) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        case CONFIG_THREADS: {
+            int threads;
+            if (Tcl_GetIntFromObj(interp, objv[i + 1], &threads) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if ((threads < 1) || (threads > MEAS_MAX_THREADS)) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Number of threads '%d' should be between 1 and %d", threads,
+                                                       MEAS_MAX_THREADS));
+                return TCL_ERROR;
+            }
+            configPtr->threads = threads;
+            break;
+        }
+        case CONFIG_REPRODUCIBLE:
+            if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &configPtr->reproducible) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        case CONFIG_CUMULATIVE:
+            if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &configPtr->cumulative) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        case CONFIG_BINARY:
+            if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &configPtr->binary) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        };
+    }
+    return TCL_OK;
 }
 
+/*
+ * Tcl_ObjType that caches numeric lists as packed arrays of doubles, so repeated measurements over the same vector
+ * skip the per-element conversion. On Tcl 9 the type is also an abstract list, so reading the vector as a list from
+ * scripts does not shimmer it back.
+ */
+static const Tcl_ObjType measVectorType = {
+    "measvector",
+    FreeMeasVectorInternalRep,
+    DupMeasVectorInternalRep,
+    UpdateStringOfMeasVector,
+    SetMeasVectorFromAny,
+#ifdef TCL_OBJTYPE_V2
+    TCL_OBJTYPE_V2(MeasVectorLength, MeasVectorIndex, NULL, NULL, MeasVectorGetElements, NULL, NULL, NULL)
+#endif
+};
+
+/*
+ * Id of the last created "measvector" representation. Ids are never reused, so data cached for a pair of vectors can
+ * refer to the other vector by its id without keeping it alive.
+ */
+TCL_DECLARE_MUTEX(vectorIdMutex)
+static Tcl_WideUInt lastVectorId = 0;
+
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * CalcCrossPoint --
+ * FreeMeasVectorInternalRep --
  *
- *      Compute the X-coordinate of the intersection point of two lines. Each line is defined by a pair of points:
- *      (x11, y11)-(x21, y21) for the first line, and (x12, y12)-(x22, y22) for the second line. The function assumes
- *      the lines are not parallel and that the denominators are non-zero.
+ *      Release the internal representation of a "measvector" object. The packed data is freed when the last object
+ *      that shares it is released.
  *
  * Parameters:
- *      double x11, y11   - input: coordinates of the first point on the first line
- *      double x21, y21   - input: coordinates of the second point on the first line
- *      double x12, y12   - input: coordinates of the first point on the second line
- *      double x22, y22   - input: coordinates of the second point on the second line
+ *      Tcl_Obj *objPtr           - input: object whose internal representation is released
  *
  * Results:
- *      Returns the X-coordinate of the intersection point of the two lines.
+ *      None
  *
  * Side Effects:
+ *      Decrements the reference count of the shared representation, frees it, its list or bytearray and the data
+ *      cached in it when it drops to zero, or releases the rawfile of a vector that was not read
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FreeMeasVectorInternalRep(Tcl_Obj *objPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    if (--repPtr->refCount <= 0) {
+        if (repPtr->listObj != NULL) {
+            Tcl_DecrRefCount(repPtr->listObj);
+        }
+        if (!repPtr->inPlace) {
+            if (repPtr->rawPtr != NULL) {
+                ReleaseRawFile(repPtr->rawPtr);
+            } else {
+                Tcl_Free((char *)repPtr->data);
+            }
+        }
+        if (repPtr->bytesObj != NULL) {
+            Tcl_DecrRefCount(repPtr->bytesObj);
+        }
+        if (repPtr->crossIndex != NULL) {
+            for (int k = 0; k < MEAS_CROSS_LEVELS; ++k) {
+                Tcl_Free((char *)repPtr->crossIndex[k].segs);
+                Tcl_Free((char *)repPtr->crossIndex[k].rises);
+            }
+            Tcl_Free((char *)repPtr->crossIndex);
+        }
+        if (repPtr->cumPtr != NULL) {
+            Tcl_Free((char *)repPtr->cumPtr->sum);
+            Tcl_Free((char *)repPtr->cumPtr->sumSq);
+            Tcl_Free((char *)repPtr->cumPtr);
+        }
+        if (repPtr->rangePtr != NULL) {
+            Tcl_Free((char *)repPtr->rangePtr->minIdx);
+            Tcl_Free((char *)repPtr->rangePtr->maxIdx);
+            Tcl_Free((char *)repPtr->rangePtr);
+        }
+        Tcl_Free((char *)repPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * DupMeasVectorInternalRep --
+ *
+ *      Copy the internal representation of a "measvector" object to a duplicate object. The packed data is shared,
+ *      not copied, because it is never modified after creation.
+ *
+ * Parameters:
+ *      Tcl_Obj *srcPtr           - input: object being duplicated
+ *      Tcl_Obj *dupPtr           - output: new object that receives the shared representation
+ *
+ * Results:
  *      None
  *
- * Notes:
- *      The function does not perform error checking for division by zero. It is the caller's responsibility to ensure
- *      the lines are not parallel (i.e., they have different slopes).
+ * Side Effects:
+ *      Increments the reference count of the shared representation
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static inline double CalcCrossPoint(double x11, double y11, double x21, double y21, double x12, double y12, double x22,
-                                    double y22) {
-    return (y12 - (y22 - y12) / (x22 - x12) * x12 - (y11 - (y21 - y11) / (x21 - x11) * x11)) /
-           ((y21 - y11) / (x21 - x11) - (y22 - y12) / (x22 - x12));
+static void DupMeasVectorInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *dupPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)srcPtr->internalRep.twoPtrValue.ptr1;
+    Tcl_ObjInternalRep ir;
+    repPtr->refCount++;
+    ir.twoPtrValue.ptr1 = repPtr;
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(dupPtr, &measVectorType, &ir);
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * DerivSelect --
+ * UpdateStringOfMeasVector --
  *
- *      Prepare a 3-point stencil for derivative or interpolation calculations based on a specified X-coordinate
- *      (`xwhen`) that lies between two adjacent sample points (xi and xip1). Depending on the location of `xwhen`
- *      relative to the segment and its position in the array, the function selects appropriate X and Y values from
- *      the input arrays `x` and `vec`, converts them to doubles, and writes them into the `out` buffer.
+ *      Generate the string representation of a "measvector" object from the bytearray it was built from, or from the
+ *      packed values for vectors returned by the commands. Vectors built from lists keep the string of the list.
  *
  * Parameters:
- *      Tcl_Interp *interp   - input: target interpreter used for Tcl_GetDoubleFromObj conversions
- *      Tcl_WideInt i        - input: current segment index (base point index in x/vec arrays)
- *      double xi            - input: X value at index `i`
- *      double xwhen         - input: target X value (interpolation/evaluation point)
- *      double xip1          - input: X value at index `i + 1`
- *      Tcl_WideInt xlen     - input: total number of elements in the `x` array
- *      Tcl_Obj **x          - input: array of Tcl_Obj pointers holding X values (at least x[i-1] to x[i+2])
- *      Tcl_Obj **vec        - input: array of Tcl_Obj pointers holding corresponding Y values
- *      double ywhen         - input: Y value at the point `xwhen` (for use in interpolation output)
- *      double *out          - output: pointer to a 6-element array to store the selected X and Y values
- *                                out[0..2] = selected X values (or interpolated positions)
- *                                out[3..5] = selected Y values (with ywhen at the center)
- *      int *pos             - output: index of the middle point in `out`, used to identify where `xwhen` fits:
- *                                -1 = unknown/middle is ywhen (e.g. edge case),
- *                                 0 = ywhen is second point in sequence (common case),
- *                                 1 = ywhen is last (used for final segment)
+ *      Tcl_Obj *objPtr           - input/output: object whose string representation is generated
  *
  * Results:
- *      Populates the `out` buffer with 3 X values and 3 corresponding Y values to form a stencil around `xwhen`.
- *      Uses Tcl_GetDoubleFromObj to safely convert the values. The result is intended for slope or interpolation use.
+ *      None
  *
  * Side Effects:
- *      May set error messages in the interpreter if Tcl_GetDoubleFromObj fails (typically not expected if inputs
- *      are known to be numeric).
+ *      Allocates the string representation of the object
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static void DerivSelect(Tcl_Interp *interp, Tcl_WideInt i, double xi, double xwhen, double xip1, Tcl_WideInt xlen,
-                        Tcl_Obj **x, Tcl_Obj **vec, double ywhen, double *out, int *pos) {
-    if (i == 0) {
-        if (xi == xwhen) {
-            out[0] = xwhen;
-            out[1] = xip1;
-            Tcl_GetDoubleFromObj(interp, x[i + 2], &out[2]);
-            out[3] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[4]);
-            Tcl_GetDoubleFromObj(interp, vec[i + 2], &out[5]);
-            *pos = -1;
-        } else if (xip1 == xwhen) {
-            out[0] = xi;
-            out[1] = xwhen;
-            Tcl_GetDoubleFromObj(interp, x[i + 2], &out[2]);
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 2], &out[5]);
-            *pos = 0;
-        } else {
-            out[0] = xi;
-            out[1] = xwhen;
-            out[2] = xip1;
-            Tcl_GetDoubleFromObj(interp, vec[i], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[5]);
-            *pos = -1;
-        }
-    } else if (i == (xlen - 2)) {
-        if (xip1 == xwhen) {
-            Tcl_GetDoubleFromObj(interp, x[i - 1], &out[0]);
-            out[1] = xi;
-            out[2] = xwhen;
-            Tcl_GetDoubleFromObj(interp, vec[i - 1], &out[3]);
-            Tcl_GetDoubleFromObj(interp, vec[i], &out[4]);
-            out[5] = ywhen;
-            *pos = 1;
-        } else {
-            out[0] = xi;
-            out[1] = xwhen;
-            out[2] = xip1;
-            Tcl_GetDoubleFromObj(interp, vec[i], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[5]);
-            *pos = 1;
-        }
-    } else {
-        if (xi == xwhen) {
-            Tcl_GetDoubleFromObj(interp, x[i - 1], &out[0]);
-            out[1] = xwhen;
-            out[2] = xip1;
-            Tcl_GetDoubleFromObj(interp, vec[i - 1], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[5]);
-            *pos = 0;
-        } else if (xip1 == xwhen) {
-            out[0] = xi;
-            out[1] = xwhen;
-            Tcl_GetDoubleFromObj(interp, x[i + 2], &out[2]);
-            Tcl_GetDoubleFromObj(interp, vec[i], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 2], &out[5]);
-            *pos = 0;
-        } else {
-            out[0] = xi;
-            out[1] = xwhen;
-            out[2] = xip1;
-            Tcl_GetDoubleFromObj(interp, vec[i], &out[3]);
-            out[4] = ywhen;
-            Tcl_GetDoubleFromObj(interp, vec[i + 1], &out[5]);
-            *pos = 0;
+static void UpdateStringOfMeasVector(Tcl_Obj *objPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    Tcl_Size length;
+    /* the list of a bytearray vector, made for list access, is not its value */
+    if (repPtr->bytesObj != NULL) {
+        const char *bytes = Tcl_GetStringFromObj(repPtr->bytesObj, &length);
+        Tcl_InitStringRep(objPtr, bytes, length);
+        return;
+    }
+    if (repPtr->rawPtr != NULL) {
+        ReadRawVector(repPtr);
+    }
+    Tcl_DString ds;
+    char buffer[TCL_DOUBLE_SPACE];
+    Tcl_DStringInit(&ds);
+    for (Tcl_Size i = 0; i < repPtr->len; ++i) {
+        Tcl_PrintDouble(NULL, repPtr->data[i], buffer);
+        if (i > 0) {
+            Tcl_DStringAppend(&ds, " ", 1);
         }
+        Tcl_DStringAppend(&ds, buffer, -1);
     }
-    return;
+    Tcl_InitStringRep(objPtr, Tcl_DStringValue(&ds), Tcl_DStringLength(&ds));
+    Tcl_DStringFree(&ds);
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * Deriv --
+ * SetMeasVectorFromAny --
  *
- *      Compute the numerical derivative at a point using a three-point stencil. The function supports three types of
- *      finite-difference approximations (centered, backward, and forward) depending on the `type` parameter.
- *      The input values represent three adjacent (x, y) points: (xim1, yim1), (xi, yi), and (xip1, yip1).
+ *      Convert an object holding a numeric list into a "measvector" object. Every element is converted to double once
+ *      and stored in a contiguous array, the element objects are released and only the string of the list is kept.
+ *      With `configure -binary` a bytearray of doubles, as made by `binary format d*`, is read in place instead (see
+ *      IsBinaryVector() and SetMeasVectorFromBytes()).
  *
  * Parameters:
- *      double xim1     - input: X value at i-1 (previous point)
- *      double xi       - input: X value at i (current point)
- *      double xip1     - input: X value at i+1 (next point)
- *      double yim1     - input: Y value at i-1
- *      double yi       - input: Y value at i
- *      double yip1     - input: Y value at i+1
- *      int type        - input: derivative type selector:
- *                           0  = centered difference (at xi)
- *                          -1  = backward-biased (at xi)
- *                           1  = forward-biased (at xi)
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting, may be NULL
+ *      Tcl_Obj *objPtr           - input/output: object to convert
  *
  * Results:
- *      Returns the estimated derivative at xi using the appropriate finite-difference formula based on `type`.
+ *      TCL_OK on success; TCL_ERROR if the object is not a list or any element is not a number
  *
  * Side Effects:
- *      None
+ *      Replaces the internal representation of the object, generates its string representation if it had none
  *
  * Notes:
- *      This method handles non-uniform spacing between X values. It assumes that h1 = xi - xim1 and h2 = xip1 - xi
- *      are both non-zero. If `type` is not -1, 0, or 1, the function returns 0.0 by default.
+ *      The string keeps the value of the list as it was written, "1" stays "1" instead of the "1.0" printed from the
+ *      packed value, and element access parses it again on demand (see GetMeasVectorList()). On Tcl 8.6, where the
+ *      type is not an abstract list, list access shimmers the object back to a list from that string.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static double Deriv(double xim1, double xi, double xip1, double yim1, double yi, double yip1, int type) {
-    double h1 = xi - xim1;
-    double h2 = xip1 - xi;
-    if (type == 0) {
-        return -h2 / (h1 * (h1 + h2)) * yim1 - (h1 - h2) / (h1 * h2) * yi + h1 / (h2 * (h1 + h2)) * yip1;
-    } else if (type == -1) {
-        return -(2 * h1 + h2) / (h1 * (h1 + h2)) * yim1 + (h1 + h2) / (h1 * h2) * yi - h1 / (h2 * (h1 + h2)) * yip1;
-    } else if (type == 1) {
-        return h2 / (h1 * (h1 + h2)) * yim1 - (h1 + h2) / (h1 * h2) * yi + (h1 + 2 * h2) / (h2 * (h1 + h2)) * yip1;
+static int SetMeasVectorFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr) {
+    Tcl_Size len;
+    Tcl_Obj **elems;
+    if (IsBinaryVector(interp, objPtr)) {
+        return SetMeasVectorFromBytes(interp, objPtr);
     }
-    return 0.0;
+    if (Tcl_ListObjGetElements(interp, objPtr, &len, &elems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double *data = (double *)Tcl_Alloc(sizeof(double) * (len > 0 ? len : 1));
+    for (Tcl_Size i = 0; i < len; ++i) {
+        if (Tcl_GetDoubleFromObj(interp, elems[i], &data[i]) != TCL_OK) {
+            Tcl_Free((char *)data);
+            return TCL_ERROR;
+        }
+    }
+    Tcl_ObjInternalRep ir;
+    Tcl_GetString(objPtr);
+    ir.twoPtrValue.ptr1 = NewMeasVectorRep(data, len);
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * TrigTargCmdProc2 --
+ * IsBinaryVector --
  *
- *      Tcl command implementation that analyzes two vector signals (trigVec and targVec) over a shared time base (x),
- *      detects specified edge transitions (rise, fall, or crossing) for each vector, and returns the time difference
- *      between the trigger and target events. The function supports both fixed occurrence counts and "last" mode to
- *      capture the final matching transition.
+ *      Tells whether an object holds doubles in binary form: a bytearray, as made by `binary format`, whose length is
+ *      a multiple of the size of a double, passed while `configure -binary` is set in the interpreter.
  *
  * Parameters:
- *      void *clientData              - input: optional client data (unused)
- *      Tcl_Interp *interp            - input/output: interpreter used for argument parsing and result/error reporting
- *      Tcl_Size objc                 - input: number of arguments passed to the command
- *      Tcl_Obj *const objv[]         - input: argument vector; expected format:
- *
- *              objv[1]  = x           - Tcl list of numeric X values (time base)
- *              objv[2]  = trigVec     - Tcl list of Y values for the trigger signal
- *              objv[3]  = val1        - trigger threshold value
- *              objv[4]  = targVec     - Tcl list of Y values for the target signal
- *              objv[5]  = val2        - target threshold value
- *              objv[6]  = trigCond    - trigger condition: "rise", "fall", or "cross"
- *              objv[7]  = trigCount   - trigger hit index to use (or "last")
- *              objv[8]  = targCond    - target condition: "rise", "fall", or "cross"
- *              objv[9]  = targCount   - target hit index to use (or "last")
- *              objv[10] = trigDelay   - minimum X value before trigger events are considered
- *              objv[11] = targDelay   - minimum X value before target events are considered
+ *      Tcl_Interp *interp        - input: interpreter whose settings are used, NULL reads every object as a list
+ *      Tcl_Obj *objPtr           - input: object to check
  *
  * Results:
- *      On success, returns a dictionary with the following keys:
- *          "xtrig"   => interpolated X value at which trigger condition was met
- *          "xtarg"   => interpolated X value at which target condition was met
- *          "xdelta"  => difference (xtarg - xtrig)
- *
- *      On failure, returns TCL_ERROR and sets an error message in the interpreter.
+ *      Nonzero if the object should be read as binary doubles
  *
  * Side Effects:
- *      Parses and converts lists to arrays, and individual values to doubles and integers.
- *      May allocate intermediate Tcl_Obj structures.
- *      Sets the interpreter result to either an error message or result dictionary.
+ *      None
  *
  * Notes:
- *      - Lists must be of equal length.
- *      - Events are detected using a two-point scan for each segment: (xi, xi+1), (vec[i], vec[i+1]).
- *      - Linear interpolation is used to estimate the exact X value where val1/val2 thresholds are crossed.
- *      - Condition counts are 1-based; use "last" to return the final matching transition.
- *      - If the requested condition is not found, a descriptive error is returned.
+ *      Binary input is always explicit: without `-binary` a bytearray is parsed as a list of numbers, so text read
+ *      from a channel in binary mode is measured as text. Vectors made by `::tclmeasure::vector` are read as doubles
+ *      in any mode, they are already of the "measvector" type.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int TrigTargCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
-    int trigVecCount = 0;
-    int targVecCount = 0;
-    int trigVecFoundFlag = 0;
-    int targVecFoundFlag = 0;
-    double lastTrigHit[4] = {0.0, 0.0, 0.0, 0.0};
-    int lastTrigHitSet = 0;
-    double lastTargHit[4] = {0.0, 0.0, 0.0, 0.0};
-    int lastTargHitSet = 0;
-    double xTrig, xTarg;
-    if (objc != 12) {
-        Tcl_WrongNumArgs(interp, 11, objv,
-                         "x trigVec val1 targVec val2 trigVecCond trigVecCondCount targVecCond targVecCondCount "
-                         "trigVecDelay targVecDelay");
+static int IsBinaryVector(Tcl_Interp *interp, Tcl_Obj *objPtr) {
+    const MeasConfig *configPtr = (interp != NULL) ? (MeasConfig *)Tcl_GetAssocData(interp, "tclmeasure", NULL) : NULL;
+    if ((configPtr == NULL) || !configPtr->binary) {
+        return 0;
+    }
+    const Tcl_ObjType *byteArrayType = Tcl_GetObjType("bytearray");
+    const Tcl_ObjType *properByteArrayType = Tcl_GetObjType("proper bytearray");
+    if (!((byteArrayType != NULL) && (Tcl_FetchInternalRep(objPtr, byteArrayType) != NULL)) &&
+        !((properByteArrayType != NULL) && (Tcl_FetchInternalRep(objPtr, properByteArrayType) != NULL))) {
+        return 0;
+    }
+    Tcl_Size size;
+    const unsigned char *bytes = Tcl_GetByteArrayFromObj(objPtr, &size);
+    return (bytes != NULL) && (size > 0) && (size % sizeof(double) == 0);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * SetMeasVectorFromBytes --
+ *
+ *      Convert a bytearray of little-endian doubles (`binary format q*`, or `d*` on little-endian machines) into a
+ *      "measvector" object. A private duplicate of the bytearray keeps the bytes for the string representation, and
+ *      the values are read from these bytes in place when they are aligned on a little endian machine. Otherwise they
+ *      are copied once into a packed array.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting, may be NULL
+ *      Tcl_Obj *objPtr           - input/output: object to convert
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the object is not a bytearray or its length is not a multiple of the size of
+ *      a double
+ *
+ * Side Effects:
+ *      Replaces the internal representation of the object
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int SetMeasVectorFromBytes(Tcl_Interp *interp, Tcl_Obj *objPtr) {
+    Tcl_Size size;
+    const unsigned char *bytes = Tcl_GetByteArrayFromObj(objPtr, &size);
+    if (bytes == NULL) {
+        if (interp != NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Vector is not a bytearray"));
+        }
         return TCL_ERROR;
     }
-    Tcl_Obj *xVec = objv[1];
-    Tcl_Obj *trigVec = objv[2];
-    double val1;
-    Tcl_GetDoubleFromObj(interp, objv[3], &val1);
-    Tcl_Obj *targVec = objv[4];
-    double val2;
-    Tcl_GetDoubleFromObj(interp, objv[5], &val2);
-    int trigVecCond;
-    if (!strcmp(Tcl_GetString(objv[6]), "rise")) {
-        trigVecCond = COND_RISE;
-    } else if (!strcmp(Tcl_GetString(objv[6]), "fall")) {
-        trigVecCond = COND_FALL;
-    } else {
-        trigVecCond = COND_CROSS;
+    if (size % sizeof(double) != 0) {
+        if (interp != NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Binary vector of %ld bytes does not hold whole doubles",
+                                                   (long)size));
+        }
+        return TCL_ERROR;
     }
-    Tcl_WideInt trigVecCondCount;
-    if (!strcmp(Tcl_GetString(objv[7]), "last")) {
-        trigVecCondCount = -1;
-    } else {
-        Tcl_GetWideIntFromObj(interp, objv[7], &trigVecCondCount);
+    /* a private duplicate keeps the bytes, objPtr keeps its string representation if it has one */
+    Tcl_Obj *bytesObj = Tcl_DuplicateObj(objPtr);
+    Tcl_IncrRefCount(bytesObj);
+    bytes = Tcl_GetByteArrayFromObj(bytesObj, &size);
+    Tcl_Size len = size / (Tcl_Size)sizeof(double);
+    MeasVectorRep *repPtr;
+#ifndef WORDS_BIGENDIAN
+    if ((size_t)bytes % sizeof(double) == 0) {
+        repPtr = NewMeasVectorRep((double *)bytes, len);
+        repPtr->inPlace = 1;
+    } else
+#endif
+    {
+        double *data = (double *)Tcl_Alloc(sizeof(double) * (len > 0 ? len : 1));
+        CopyLittleEndian(data, bytes, len);
+        repPtr = NewMeasVectorRep(data, len);
     }
-    int targVecCond;
-    if (!strcmp(Tcl_GetString(objv[8]), "rise")) {
-        targVecCond = COND_RISE;
-    } else if (!strcmp(Tcl_GetString(objv[8]), "fall")) {
-        targVecCond = COND_FALL;
-    } else {
-        targVecCond = COND_CROSS;
+    repPtr->bytesObj = bytesObj;
+    Tcl_ObjInternalRep ir;
+    ir.twoPtrValue.ptr1 = repPtr;
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_FreeInternalRep(objPtr);
+    Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CopyLittleEndian --
+ *
+ *      Copy doubles between the byte order of the machine and little-endian order, in either direction.
+ *
+ * Parameters:
+ *      void *dst                 - output: destination of len doubles
+ *      const void *src           - input: source of len doubles, may be unaligned
+ *      Tcl_Size len              - input: number of doubles
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void CopyLittleEndian(void *dst, const void *src, Tcl_Size len) {
+#ifdef WORDS_BIGENDIAN
+    unsigned char *to = (unsigned char *)dst;
+    const unsigned char *from = (const unsigned char *)src;
+    for (Tcl_Size i = 0; i < len; ++i) {
+        for (size_t b = 0; b < sizeof(double); ++b) {
+            to[i * sizeof(double) + b] = from[i * sizeof(double) + sizeof(double) - 1 - b];
+        }
     }
-    Tcl_WideInt targVecCondCount;
-    if (!strcmp(Tcl_GetString(objv[9]), "last")) {
-        targVecCondCount = -1;
-    } else {
-        Tcl_GetWideIntFromObj(interp, objv[9], &targVecCondCount);
+#else
+    memcpy(dst, src, sizeof(double) * (size_t)len);
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * NewMeasVectorRep --
+ *
+ *      Create the representation shared by "measvector" objects with the given packed values.
+ *
+ * Parameters:
+ *      double *data              - input: packed values allocated with Tcl_Alloc, owned by the representation
+ *      Tcl_Size len              - input: number of values
+ *
+ * Results:
+ *      New representation with a reference count of 1 and no cached data
+ *
+ * Side Effects:
+ *      Takes a new vector id
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static MeasVectorRep *NewMeasVectorRep(double *data, Tcl_Size len) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)Tcl_Alloc(sizeof(MeasVectorRep));
+    repPtr->refCount = 1;
+    repPtr->len = len;
+    repPtr->data = data;
+    repPtr->listObj = NULL;
+    repPtr->bytesObj = NULL;
+    repPtr->inPlace = 0;
+    repPtr->order = ORDER_UNKNOWN;
+    repPtr->orderIdx = -1;
+    repPtr->crossIndex = NULL;
+    repPtr->crossNext = 0;
+    Tcl_MutexLock(&vectorIdMutex);
+    repPtr->id = ++lastVectorId;
+    Tcl_MutexUnlock(&vectorIdMutex);
+    repPtr->cumPtr = NULL;
+    repPtr->rangePtr = NULL;
+    repPtr->rangeQueries = 0;
+    repPtr->grid = GRID_UNKNOWN;
+    repPtr->rawPtr = NULL;
+    repPtr->rawVar = 0;
+    return repPtr;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * NewMeasVectorObj --
+ *
+ *      Create the object for a vector returned by a command from its packed values. With MEAS_PACKED_RESULTS the
+ *      values are kept as they are in a "measvector" object: passing the result to another command reads them
+ *      directly, and list access from scripts goes through the abstract list interface, so no Tcl_Obj per element is
+ *      created unless a script asks for all of them. Otherwise the result is a list of doubles. With `configure
+ *      -binary` set the result is a bytearray of little-endian doubles, which commands read in place.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter
+ *      double *data              - input: values allocated with Tcl_Alloc, ownership passes to the function
+ *      Tcl_Size len              - input: number of values
+ *
+ * Results:
+ *      New object with a reference count of 0
+ *
+ * Side Effects:
+ *      Frees data for bytearray results and without MEAS_PACKED_RESULTS
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Obj *NewMeasVectorObj(const MeasConfig *configPtr, double *data, Tcl_Size len) {
+    if (configPtr->binary) {
+        Tcl_Obj *objPtr = Tcl_NewByteArrayObj(NULL, 0);
+        CopyLittleEndian(Tcl_SetByteArrayLength(objPtr, len * (Tcl_Size)sizeof(double)), data, len);
+        Tcl_Free((char *)data);
+        return objPtr;
     }
-    double trigVecDelay;
-    Tcl_GetDoubleFromObj(interp, objv[10], &trigVecDelay);
-    double targVecDelay;
-    Tcl_GetDoubleFromObj(interp, objv[11], &targVecDelay);
+#ifdef MEAS_PACKED_RESULTS
+    Tcl_Obj *objPtr = Tcl_NewObj();
+    Tcl_ObjInternalRep ir;
+    Tcl_InvalidateStringRep(objPtr);
+    ir.twoPtrValue.ptr1 = NewMeasVectorRep(data, len);
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+    return objPtr;
+#else
+    Tcl_Obj *objPtr = Tcl_NewListObj(len, NULL);
+    for (Tcl_Size i = 0; i < len; ++i) {
+        Tcl_ListObjAppendElement(NULL, objPtr, Tcl_NewDoubleObj(data[i]));
+    }
+    Tcl_Free((char *)data);
+    return objPtr;
+#endif
+}
 
-    Tcl_Size xLen, trigVecLen, targVecLen;
-    Tcl_Obj **xVecElems, **trigVecElems, **targVecElems;
-    if (Tcl_ListObjGetElements(interp, xVec, &xLen, &xVecElems) == TCL_ERROR) {
-        return TCL_ERROR;
+#ifdef TCL_OBJTYPE_V2
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetMeasVectorList --
+ *
+ *      Get the list of the values of a "measvector" object, parsing it again from the string of the object, or
+ *      creating it from the packed values for bytearray vectors and vectors without a string.
+ *
+ * Parameters:
+ *      Tcl_Obj *objPtr           - input: "measvector" object
+ *
+ * Results:
+ *      List object owned by the representation
+ *
+ * Side Effects:
+ *      May create the list and one object per value, kept until the representation is freed
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Obj *GetMeasVectorList(Tcl_Obj *objPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    if (repPtr->listObj == NULL) {
+        Tcl_Size length;
+        if ((repPtr->bytesObj == NULL) && Tcl_HasStringRep(objPtr)) {
+            const char *bytes = Tcl_GetStringFromObj(objPtr, &length);
+            repPtr->listObj = Tcl_NewStringObj(bytes, length);
+            Tcl_ListObjLength(NULL, repPtr->listObj, &length);
+        } else {
+            if (repPtr->rawPtr != NULL) {
+                ReadRawVector(repPtr);
+            }
+            repPtr->listObj = Tcl_NewListObj(repPtr->len, NULL);
+            for (Tcl_Size i = 0; i < repPtr->len; ++i) {
+                Tcl_ListObjAppendElement(NULL, repPtr->listObj, Tcl_NewDoubleObj(repPtr->data[i]));
+            }
+        }
+        Tcl_IncrRefCount(repPtr->listObj);
+    }
+    return repPtr->listObj;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * MeasVectorLength, MeasVectorIndex, MeasVectorGetElements --
+ *
+ *      Abstract list interface of the "measvector" type, answers list queries without converting the object back to
+ *      a list. Elements are parsed from the string of the object on demand, single elements of vectors without a
+ *      string or built from a bytearray are created from the packed values.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size MeasVectorLength(Tcl_Obj *objPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    return repPtr->len;
+}
+
+static int MeasVectorIndex(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size index, Tcl_Obj **elemObjPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    if ((index < 0) || (index >= repPtr->len)) {
+        *elemObjPtr = NULL;
+        return TCL_OK;
+    }
+    if ((repPtr->listObj == NULL) && ((repPtr->bytesObj != NULL) || !Tcl_HasStringRep(objPtr))) {
+        if (repPtr->rawPtr != NULL) {
+            ReadRawVector(repPtr);
+        }
+        *elemObjPtr = Tcl_NewDoubleObj(repPtr->data[index]);
+        return TCL_OK;
+    }
+    return Tcl_ListObjIndex(interp, GetMeasVectorList(objPtr), index, elemObjPtr);
+}
+
+static int MeasVectorGetElements(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size *objcPtr, Tcl_Obj ***objvPtr) {
+    MeasVectorRep *repPtr = (MeasVectorRep *)objPtr->internalRep.twoPtrValue.ptr1;
+    return Tcl_ListObjGetElements(interp, GetMeasVectorList(objPtr), objcPtr, objvPtr);
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetMeasVectorFromObj --
+ *
+ *      Get the packed double values of a vector object, converting it to the "measvector" type on the first use.
+ *      Later calls on the same object read the cached array directly. Vectors of a rawfile are read from the mapped
+ *      file on the first use.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      Tcl_Obj *objPtr           - input: numeric list object
+ *      MeasVector *vecPtr        - output: view of the packed values, valid while objPtr keeps its representation
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the object can't be converted
+ *
+ * Side Effects:
+ *      May replace the internal representation of the object
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetMeasVectorFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr, MeasVector *vecPtr) {
+    const Tcl_ObjInternalRep *irPtr = Tcl_FetchInternalRep(objPtr, &measVectorType);
+    if (irPtr == NULL) {
+        if (SetMeasVectorFromAny(interp, objPtr) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        irPtr = Tcl_FetchInternalRep(objPtr, &measVectorType);
+    }
+    MeasVectorRep *repPtr = (MeasVectorRep *)irPtr->twoPtrValue.ptr1;
+    if (repPtr->rawPtr != NULL) {
+        ReadRawVector(repPtr);
     }
-    if (Tcl_ListObjGetElements(interp, trigVec, &trigVecLen, &trigVecElems) == TCL_ERROR) {
+    vecPtr->len = repPtr->len;
+    vecPtr->data = repPtr->data;
+    vecPtr->repPtr = repPtr;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetMeasVectorElements --
+ *
+ *      Counterpart of Tcl_ListObjGetElements for numeric vectors: returns the length and the packed double values of
+ *      a vector object (see GetMeasVectorFromObj).
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      Tcl_Obj *objPtr           - input: numeric list object
+ *      Tcl_Size *lenPtr          - output: number of elements
+ *      const double **elemsPtr   - output: pointer to the packed values, valid while objPtr keeps its representation
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the object can't be converted
+ *
+ * Side Effects:
+ *      May replace the internal representation of the object
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetMeasVectorElements(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size *lenPtr, const double **elemsPtr) {
+    MeasVector vec;
+    if (GetMeasVectorFromObj(interp, objPtr, &vec) != TCL_OK) {
         return TCL_ERROR;
     }
-    if (Tcl_ListObjGetElements(interp, targVec, &targVecLen, &targVecElems) == TCL_ERROR) {
+    *lenPtr = vec.len;
+    *elemsPtr = vec.data;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetMeasXElements --
+ *
+ *      Same as GetMeasVectorElements, but for vectors used as the x axis: if `-checkx` is enabled, verifies that the
+ *      values are strictly increasing. The verdict is cached in the vector, so the check is done once per vector.
+ *      Also tells whether the values lie on a uniform grid (see GetMeasGrid()).
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasConfig *configPtr     - input: settings of the interpreter
+ *      Tcl_Obj *objPtr           - input: numeric list object
+ *      Tcl_Size *lenPtr          - output: number of elements
+ *      const double **elemsPtr   - output: pointer to the packed values
+ *      const MeasGrid **gridPtrPtr - output: uniform grid of the values, NULL if they are not on one
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the object can't be converted or the check fails
+ *
+ * Side Effects:
+ *      May replace the internal representation of the object
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetMeasXElements(Tcl_Interp *interp, MeasConfig *configPtr, Tcl_Obj *objPtr, Tcl_Size *lenPtr,
+                            const double **elemsPtr, const MeasGrid **gridPtrPtr) {
+    MeasVector vec;
+    if (GetMeasVectorFromObj(interp, objPtr, &vec) != TCL_OK) {
         return TCL_ERROR;
     }
-    if (xLen != trigVecLen) {
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of trigVec '%ld'", xLen, trigVecLen);
-        Tcl_SetObjResult(interp, errorMsg);
+    *gridPtrPtr = GetMeasGrid(vec.repPtr);
+    if (configPtr->checkX && (CheckIncreasing(interp, vec.repPtr) != TCL_OK)) {
         return TCL_ERROR;
-    } else if (trigVecLen != targVecLen) {
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("Length of trigVec '%ld' is not equal to length of targVec '%ld'", trigVecLen, targVecLen);
+    }
+    *lenPtr = vec.len;
+    *elemsPtr = vec.data;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CheckIncreasing --
+ *
+ *      Verifies that the values of a vector are strictly increasing, as required for an x axis. The verdict is cached
+ *      in the vector, so the values are scanned once.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasVectorRep *repPtr     - input/output: representation of the vector, gets its order
+ *
+ * Results:
+ *      TCL_OK if the values are strictly increasing; TCL_ERROR otherwise
+ *
+ * Side Effects:
+ *      Sets the order of the vector
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int CheckIncreasing(Tcl_Interp *interp, MeasVectorRep *repPtr) {
+    if (repPtr->order == ORDER_UNKNOWN) {
+        repPtr->order = ORDER_INCREASING;
+        for (Tcl_Size i = 1; i < repPtr->len; ++i) {
+            if (!(repPtr->data[i] > repPtr->data[i - 1])) {
+                repPtr->order = ORDER_UNORDERED;
+                repPtr->orderIdx = i;
+                break;
+            }
+        }
+    }
+    if (repPtr->order == ORDER_UNORDERED) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("x values must be strictly increasing, value '%f' at index '%ld' is not "
+                                          "greater than the previous one",
+                                          repPtr->data[repPtr->orderIdx], repPtr->orderIdx);
         Tcl_SetObjResult(interp, errorMsg);
         return TCL_ERROR;
     }
-    for (Tcl_Size i = 0; i < trigVecLen - 1; ++i) {
-        double xi;
-        Tcl_GetDoubleFromObj(interp, xVecElems[i], &xi);
-        if ((xi < trigVecDelay) && (xi < targVecDelay)) {
-            continue;
-        }
-        double xip1, trigVecI, trigVecIp1, targVecI, targVecIp1;
-        Tcl_GetDoubleFromObj(interp, xVecElems[i + 1], &xip1);
-        Tcl_GetDoubleFromObj(interp, trigVecElems[i], &trigVecI);
-        Tcl_GetDoubleFromObj(interp, trigVecElems[i + 1], &trigVecIp1);
-        Tcl_GetDoubleFromObj(interp, targVecElems[i], &targVecI);
-        Tcl_GetDoubleFromObj(interp, targVecElems[i + 1], &targVecIp1);
-        if (!trigVecFoundFlag && (xi >= trigVecDelay)) {
-            int result;
-            switch ((enum Conditions)trigVecCond) {
-            case COND_RISE:
-                if ((trigVecI <= val1) && (trigVecIp1 > val1)) {
-                    result = 1;
-                } else {
-                    result = 0;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetMeasGrid --
+ *
+ *      Tells whether the values of a vector lie on a uniform grid, x[i] = x0 + i*dx within MEAS_GRID_TOL steps, as
+ *      for fixed-step simulations or resampled data. The check is done on the first call and cached in the vector.
+ *
+ * Parameters:
+ *      MeasVectorRep *repPtr     - input/output: representation of the vector
+ *
+ * Results:
+ *      Origin and step of the grid, NULL if the values are not on a uniform grid
+ *
+ * Side Effects:
+ *      Sets the grid state of the vector, and its order when the values are on a grid
+ *
+ * Notes:
+ *      A grid is strictly increasing, since every point is much closer to its own grid point than to the next one.
+ *      Searches still compare the values near the computed index (see LowerBound()), so the tolerance only bounds
+ *      the number of compared points, results are the same as with a binary search.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static const MeasGrid *GetMeasGrid(MeasVectorRep *repPtr) {
+    if (repPtr->grid == GRID_UNKNOWN) {
+        const double *x = repPtr->data;
+        Tcl_Size len = repPtr->len;
+        repPtr->grid = GRID_IRREGULAR;
+        if (len >= 2) {
+            double x0 = x[0];
+            double dx = (x[len - 1] - x0) / (double)(len - 1);
+            double tol = MEAS_GRID_TOL * dx;
+            Tcl_Size i = 1;
+            if ((dx > 0.0) && isfinite(dx)) {
+                while ((i < len - 1) && (fabs(x[i] - (x0 + (double)i * dx)) <= tol)) {
+                    ++i;
                 }
-                break;
-            case COND_FALL:
-                if ((trigVecI >= val1) && (trigVecIp1 < val1)) {
-                    result = 1;
-                } else {
-                    result = 0;
-                }
-                break;
-            case COND_CROSS:
-                if (((trigVecI <= val1) && (trigVecIp1 > val1)) || ((trigVecI >= val1) && (trigVecIp1 < val1))) {
-                    result = 1;
-                } else {
-                    result = 0;
-                }
-                break;
-            };
-            if (result) {
-                trigVecCount++;
-                if (trigVecCondCount == -1) {
-                    lastTrigHit[0] = xi;
-                    lastTrigHit[1] = trigVecI;
-                    lastTrigHit[2] = xip1;
-                    lastTrigHit[3] = trigVecIp1;
-                    lastTrigHitSet = 1;
+                if (i == len - 1) {
+                    repPtr->grid = GRID_UNIFORM;
+                    repPtr->step.x0 = x0;
+                    repPtr->step.dx = dx;
+                    repPtr->order = ORDER_INCREASING;
                 }
             }
         }
-        if (!targVecFoundFlag && (xi >= targVecDelay)) {
-            int result;
-            switch ((enum Conditions)targVecCond) {
-            case COND_RISE:
-                if ((targVecI <= val2) && (targVecIp1 > val2)) {
-                    result = 1;
-                } else {
-                    result = 0;
+    }
+    return (repPtr->grid == GRID_UNIFORM) ? &repPtr->step : NULL;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetBoundFromObj --
+ *
+ *      Reads the start or the end of an interval along the x axis. An empty string selects the first or the last x
+ *      value, which lets the Tcl layer leave the bound unset without reading the x list.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      Tcl_Obj *objPtr           - input: double value or empty string
+ *      const double *x           - input: x values
+ *      Tcl_Size len              - input: number of x values
+ *      int atEnd                 - input: if non-zero the default is the last x value, the first one otherwise
+ *      double *valuePtr          - output: value of the bound
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the object is neither a double nor an empty string
+ *
+ * Side Effects:
+ *      May replace the internal representation of the object
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetBoundFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr, const double *x, Tcl_Size len, int atEnd,
+                           double *valuePtr) {
+    if (Tcl_GetDoubleFromObj(NULL, objPtr, valuePtr) == TCL_OK) {
+        return TCL_OK;
+    }
+    Tcl_Size strLen;
+    Tcl_GetStringFromObj(objPtr, &strLen);
+    if ((strLen == 0) && (len > 0)) {
+        *valuePtr = atEnd ? x[len - 1] : x[0];
+        return TCL_OK;
+    }
+    return Tcl_GetDoubleFromObj(interp, objPtr, valuePtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * LowerBound --
+ *
+ *      Binary search of the first element of an increasing array that is not less than `val`. On a uniform grid
+ *      the index is computed from `val` and moved to the exact answer by comparing the points next to it.
+ *
+ * Parameters:
+ *      const double *x           - input: increasing array of values
+ *      const MeasGrid *gridPtr   - input: uniform grid of the array (see GetMeasGrid()), NULL to search it
+ *      Tcl_Size first            - input: first index of the searched range (inclusive)
+ *      Tcl_Size last             - input: last index of the searched range (exclusive)
+ *      double val                - input: value to search
+ *
+ * Results:
+ *      Index of the first element in [first, last) with x[i] >= val, or `last` if there is no such element
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size LowerBound(const double *x, const MeasGrid *gridPtr, Tcl_Size first, Tcl_Size last, double val) {
+    if (gridPtr != NULL) {
+        /* compared as doubles first, the position may be out of range, infinite or NaN */
+        double pos = ceil((val - gridPtr->x0) / gridPtr->dx);
+        Tcl_Size i = (pos > (double)first) ? ((pos < (double)last) ? (Tcl_Size)pos : last) : first;
+        while ((i > first) && !(x[i - 1] < val)) {
+            --i;
+        }
+        while ((i < last) && (x[i] < val)) {
+            ++i;
+        }
+        return i;
+    }
+    Tcl_Size count = last - first;
+    while (count > 0) {
+        Tcl_Size step = count / 2;
+        Tcl_Size mid = first + step;
+        if (x[mid] < val) {
+            first = mid + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindSegment --
+ *
+ *      Find the segment [x[i], x[i+1]] of an increasing array that brackets `val`, in O(log n), or O(1) on a uniform
+ *      grid. Gives the same segment as a linear scan from index `from` that stops at the first segment with
+ *      x[i] <= val <= x[i+1].
+ *
+ * Parameters:
+ *      const double *x           - input: increasing array of values
+ *      const MeasGrid *gridPtr   - input: uniform grid of the array (see GetMeasGrid()), NULL to search it
+ *      Tcl_Size len              - input: number of elements in the array
+ *      double val                - input: value to bracket
+ *      Tcl_Size from             - input: index of the first segment to consider
+ *
+ * Results:
+ *      Index `i` of the bracketing segment, or -1 if `val` lies outside [x[from], x[len-1]]
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size FindSegment(const double *x, const MeasGrid *gridPtr, Tcl_Size len, double val, Tcl_Size from) {
+    if ((from < 0) || (from > len - 2)) {
+        return -1;
+    }
+    Tcl_Size j = LowerBound(x, gridPtr, from + 1, len, val);
+    if ((j == len) || (x[j - 1] > val)) {
+        return -1;
+    }
+    return j - 1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * SplitRange --
+ *
+ *      Splits the items [first, end) into chunks for the threads configured in the interpreter. Each chunk holds at
+ *      least `minLen` items, so short ranges are not split at all.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, NULL to never split
+ *      Tcl_Size first               - input: index of the first item, segment or block of segments
+ *      Tcl_Size end                 - input: index past the last item
+ *      Tcl_Size minLen              - input: smallest number of items worth a chunk
+ *      Tcl_Size *bounds             - output: chunk c holds items [bounds[c], bounds[c+1]), at least
+ *                                     MEAS_MAX_THREADS + 1 elements
+ *
+ * Results:
+ *      Number of chunks, 1 if the range should be processed by the calling thread alone
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int SplitRange(const MeasConfig *configPtr, Tcl_Size first, Tcl_Size end, Tcl_Size minLen,
+                      Tcl_Size *bounds) {
+    Tcl_Size len = (end > first) ? (end - first) : 0;
+    int chunks = (configPtr != NULL) ? configPtr->threads : 1;
+    if (len / minLen < chunks) {
+        chunks = (int)(len / minLen);
+    }
+    if (chunks < 1) {
+        chunks = 1;
+    }
+    for (int c = 0; c <= chunks; ++c) {
+        bounds[c] = first + (Tcl_Size)((Tcl_WideInt)len * c / chunks);
+    }
+    return chunks;
+}
+
+#ifdef TCL_THREADS
+/*
+ * Worker pool shared by all interpreters of the process, see RunChunks(). Workers are started on demand and stopped
+ * by PoolExitHandler() when Tcl is finalized.
+ */
+static MeasPool pool;
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * PoolWorker --
+ *
+ *      Main loop of a worker thread: takes chunks of the current job until the pool is stopped.
+ *
+ * Parameters:
+ *      void *clientData          - input: unused
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Runs the chunk procedures of the jobs submitted with RunChunks()
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_ThreadCreateType PoolWorker(void *clientData) {
+    Tcl_MutexLock(&pool.mutex);
+    while (!pool.shutdown) {
+        if (pool.next < pool.chunks) {
+            int chunk = pool.next++;
+            Tcl_MutexUnlock(&pool.mutex);
+            pool.proc(pool.clientData, chunk);
+            Tcl_MutexLock(&pool.mutex);
+            if (--pool.pending == 0) {
+                Tcl_ConditionNotify(&pool.doneCond);
+            }
+        } else {
+            Tcl_ConditionWait(&pool.workCond, &pool.mutex, NULL);
+        }
+    }
+    Tcl_MutexUnlock(&pool.mutex);
+    TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * PoolExitHandler --
+ *
+ *      Stops and joins the worker threads, registered with Tcl_CreateExitHandler when the first worker starts.
+ *
+ * Parameters:
+ *      void *clientData          - input: unused
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Empties the pool, a later RunChunks() starts new workers
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void PoolExitHandler(void *clientData) {
+    Tcl_MutexLock(&pool.mutex);
+    pool.shutdown = 1;
+    Tcl_ConditionNotify(&pool.workCond);
+    Tcl_MutexUnlock(&pool.mutex);
+    for (int i = 0; i < pool.size; ++i) {
+        int state;
+        Tcl_JoinThread(pool.threads[i], &state);
+    }
+    pool.size = 0;
+    pool.shutdown = 0;
+}
+#endif /* TCL_THREADS */
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * RunChunks --
+ *
+ *      Calls `proc` for chunks 0..chunks-1 in parallel on the worker pool and returns when all of them are done. The
+ *      calling thread processes chunks too, so the job finishes even if no worker thread can be started. Without
+ *      thread support in the build all chunks run in the calling thread.
+ *
+ * Parameters:
+ *      int chunks                - input: number of chunks, at most MEAS_MAX_THREADS
+ *      MeasChunkProc *proc       - input: procedure called once for every chunk, must not use the Tcl API
+ *      void *clientData          - input: data passed to `proc`
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Starts up to chunks-1 worker threads on the first use. Jobs from different threads run one after another.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void RunChunks(int chunks, MeasChunkProc *proc, void *clientData) {
+#ifndef TCL_THREADS
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        proc(clientData, chunk);
+    }
+#else
+    Tcl_MutexLock(&pool.jobMutex);
+    Tcl_MutexLock(&pool.mutex);
+    while (pool.size < chunks - 1) {
+        if (Tcl_CreateThread(&pool.threads[pool.size], PoolWorker, NULL, TCL_THREAD_STACK_DEFAULT,
+                             TCL_THREAD_JOINABLE) != TCL_OK) {
+            break;
+        }
+        if (pool.size++ == 0) {
+            Tcl_CreateExitHandler(PoolExitHandler, NULL);
+        }
+    }
+    pool.proc = proc;
+    pool.clientData = clientData;
+    pool.chunks = chunks;
+    pool.next = 0;
+    pool.pending = chunks;
+    Tcl_ConditionNotify(&pool.workCond);
+    while (pool.next < pool.chunks) {
+        int chunk = pool.next++;
+        Tcl_MutexUnlock(&pool.mutex);
+        proc(clientData, chunk);
+        Tcl_MutexLock(&pool.mutex);
+        pool.pending--;
+    }
+    while (pool.pending > 0) {
+        Tcl_ConditionWait(&pool.doneCond, &pool.mutex, NULL);
+    }
+    pool.chunks = 0;
+    Tcl_MutexUnlock(&pool.mutex);
+    Tcl_MutexUnlock(&pool.jobMutex);
+#endif /* TCL_THREADS */
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanRangeScalar --
+ *
+ *      Portable implementation of ScanRange(): a single pass over the points y[first..last] that finds the extrema and
+ *      accumulates the trapezoidal sums over the segments between them.
+ *
+ * Parameters:
+ *      const double *x           - input: x values, may be NULL if `flags` has no SCAN_SUMS bits
+ *      const double *y           - input: y values
+ *      Tcl_Size first            - input: index of the first point
+ *      Tcl_Size last             - input: index of the last point, the range is empty if it is less than `first`
+ *      int flags                 - input: SCAN_* bits that select what to compute
+ *      RangeScan *scanPtr        - input/output: start values of the extrema on input, results on output
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      Segment k = i - first is accumulated into lane k % 4 and the lanes are added as (l0 + l1) + (l2 + l3), the
+ *      SIMD implementations use the same lanes, so all implementations give bit-identical sums.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanRangeScalar(const double *x, const double *y, Tcl_Size first, Tcl_Size last, int flags,
+                            RangeScan *scanPtr) {
+    double min = scanPtr->min, max = scanPtr->max;
+    Tcl_Size minIdx = -1, maxIdx = -1;
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    double accSq[4] = {0.0, 0.0, 0.0, 0.0};
+    int extrema = flags & SCAN_EXTREMA;
+    int sums = flags & SCAN_SUMS;
+    if (last >= first) {
+        if (extrema) {
+            if (y[first] < min) {
+                min = y[first];
+                minIdx = first;
+            }
+            if (y[first] > max) {
+                max = y[first];
+                maxIdx = first;
+            }
+        }
+        for (Tcl_Size i = first; i < last; ++i) {
+            double y0 = y[i], y1 = y[i + 1];
+            if (sums) {
+                double dx = x[i + 1] - x[i];
+                acc[(i - first) & 3] += (y0 + y1) * dx;
+                accSq[(i - first) & 3] += (y0 * y0 + y1 * y1) * dx;
+            }
+            if (extrema) {
+                if (y1 < min) {
+                    min = y1;
+                    minIdx = i + 1;
                 }
-                break;
-            case COND_FALL:
-                if ((targVecI >= val2) && (targVecIp1 < val2)) {
-                    result = 1;
-                } else {
-                    result = 0;
+                if (y1 > max) {
+                    max = y1;
+                    maxIdx = i + 1;
                 }
-                break;
-            case COND_CROSS:
-                if (((targVecI <= val2) && (targVecIp1 > val2)) || ((targVecI >= val2) && (targVecIp1 < val2))) {
-                    result = 1;
-                } else {
-                    result = 0;
+            }
+        }
+    }
+    scanPtr->min = min;
+    scanPtr->max = max;
+    scanPtr->minIdx = minIdx;
+    scanPtr->maxIdx = maxIdx;
+    scanPtr->sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    scanPtr->sumSq = (accSq[0] + accSq[1]) + (accSq[2] + accSq[3]);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanRangeLanes --
+ *
+ *      Merges the per-lane extrema found by a SIMD implementation of ScanRange() and finishes the segments that did not
+ *      fill a whole vector with scalar code.
+ *
+ * Parameters:
+ *      const double *x           - input: x values, may be NULL if `flags` has no SCAN_SUMS bits
+ *      const double *y           - input: y values
+ *      Tcl_Size first            - input: index of the first point of the range
+ *      Tcl_Size done             - input: number of segments already processed by the SIMD loop, a multiple of 4
+ *      Tcl_Size last             - input: index of the last point of the range
+ *      int flags                 - input: SCAN_* bits that select what to compute
+ *      const double *laneMin     - input: minimum of each of the 4 lanes
+ *      const double *laneMinIdx  - input: index of the minimum of each lane, negative if the lane was not updated
+ *      const double *laneMax     - input: maximum of each of the 4 lanes
+ *      const double *laneMaxIdx  - input: index of the maximum of each lane, negative if the lane was not updated
+ *      double *acc               - input/output: 4 lanes of the sum of (y[i] + y[i+1]) * dx
+ *      double *accSq             - input/output: 4 lanes of the sum of (y[i]^2 + y[i+1]^2) * dx
+ *      double min, max           - input: extrema found before the SIMD loop
+ *      Tcl_Size minIdx, maxIdx   - input: their indices, -1 if the start values were not improved
+ *      RangeScan *scanPtr        - output: results
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      Every lane keeps the first index of its own extremum, so taking the smallest value and, for equal values, the
+ *      smallest index gives the same point as the sequential scan.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanRangeLanes(const double *x, const double *y, Tcl_Size first, Tcl_Size done, Tcl_Size last, int flags,
+                           const double *laneMin, const double *laneMinIdx, const double *laneMax,
+                           const double *laneMaxIdx, double *acc, double *accSq, double min, double max,
+                           Tcl_Size minIdx, Tcl_Size maxIdx, RangeScan *scanPtr) {
+    int extrema = flags & SCAN_EXTREMA;
+    int sums = flags & SCAN_SUMS;
+    if (extrema) {
+        for (int l = 0; l < 4; ++l) {
+            if (laneMinIdx[l] >= 0.0) {
+                Tcl_Size idx = (Tcl_Size)laneMinIdx[l];
+                if ((laneMin[l] < min) || ((laneMin[l] == min) && (idx < minIdx))) {
+                    min = laneMin[l];
+                    minIdx = idx;
                 }
-                break;
-            };
-            if (result) {
-                targVecCount++;
-                if (targVecCondCount == -1) {
-                    lastTargHit[0] = xi;
-                    lastTargHit[1] = targVecI;
-                    lastTargHit[2] = xip1;
-                    lastTargHit[3] = targVecIp1;
-                    lastTargHitSet = 1;
+            }
+            if (laneMaxIdx[l] >= 0.0) {
+                Tcl_Size idx = (Tcl_Size)laneMaxIdx[l];
+                if ((laneMax[l] > max) || ((laneMax[l] == max) && (idx < maxIdx))) {
+                    max = laneMax[l];
+                    maxIdx = idx;
                 }
             }
         }
-        if (trigVecCondCount != -1) {
-            if ((trigVecCount == trigVecCondCount) && !trigVecFoundFlag) {
-                trigVecFoundFlag = 1;
-                xTrig = CalcXBetween(xi, trigVecI, xip1, trigVecIp1, val1);
+    }
+    for (Tcl_Size i = first + done; i < last; ++i) {
+        double y0 = y[i], y1 = y[i + 1];
+        if (sums) {
+            double dx = x[i + 1] - x[i];
+            acc[(i - first) & 3] += (y0 + y1) * dx;
+            accSq[(i - first) & 3] += (y0 * y0 + y1 * y1) * dx;
+        }
+        if (extrema) {
+            if (y1 < min) {
+                min = y1;
+                minIdx = i + 1;
+            }
+            if (y1 > max) {
+                max = y1;
+                maxIdx = i + 1;
             }
         }
-        if (targVecCondCount != -1) {
-            if ((targVecCount == targVecCondCount) && !targVecFoundFlag) {
-                targVecFoundFlag = 1;
-                xTarg = CalcXBetween(xi, targVecI, xip1, targVecIp1, val2);
+    }
+    scanPtr->min = min;
+    scanPtr->max = max;
+    scanPtr->minIdx = minIdx;
+    scanPtr->maxIdx = maxIdx;
+    scanPtr->sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    scanPtr->sumSq = (accSq[0] + accSq[1]) + (accSq[2] + accSq[3]);
+}
+
+#ifdef MEAS_HAVE_SSE2
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanRangeSse2 --
+ *
+ *      SSE2 implementation of ScanRange(), processes 4 segments per iteration with two 2-lane registers. See
+ *      ScanRangeScalar() for the parameters.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanRangeSse2(const double *x, const double *y, Tcl_Size first, Tcl_Size last, int flags,
+                          RangeScan *scanPtr) {
+    double min = scanPtr->min, max = scanPtr->max;
+    Tcl_Size minIdx = -1, maxIdx = -1;
+    int extrema = flags & SCAN_EXTREMA;
+    int sums = flags & SCAN_SUMS;
+    if (last < first) {
+        ScanRangeScalar(x, y, first, last, flags, scanPtr);
+        return;
+    }
+    if (extrema) {
+        if (y[first] < min) {
+            min = y[first];
+            minIdx = first;
+        }
+        if (y[first] > max) {
+            max = y[first];
+            maxIdx = first;
+        }
+    }
+    Tcl_Size done = (last - first) & ~(Tcl_Size)3;
+    __m128d acc01 = _mm_setzero_pd(), acc23 = _mm_setzero_pd();
+    __m128d accSq01 = _mm_setzero_pd(), accSq23 = _mm_setzero_pd();
+    __m128d min01 = _mm_set1_pd(min), min23 = min01, max01 = _mm_set1_pd(max), max23 = max01;
+    __m128d minIdx01 = _mm_set1_pd(-1.0), minIdx23 = minIdx01, maxIdx01 = minIdx01, maxIdx23 = minIdx01;
+    __m128d idx01 = _mm_setr_pd((double)(first + 1), (double)(first + 2));
+    __m128d idx23 = _mm_setr_pd((double)(first + 3), (double)(first + 4));
+    __m128d four = _mm_set1_pd(4.0);
+    for (Tcl_Size k = 0; k < done; k += 4) {
+        const double *yi = y + first + k;
+        __m128d y1lo = _mm_loadu_pd(yi + 1), y1hi = _mm_loadu_pd(yi + 3);
+        if (sums) {
+            const double *xi = x + first + k;
+            __m128d y0lo = _mm_loadu_pd(yi), y0hi = _mm_loadu_pd(yi + 2);
+            __m128d dxlo = _mm_sub_pd(_mm_loadu_pd(xi + 1), _mm_loadu_pd(xi));
+            __m128d dxhi = _mm_sub_pd(_mm_loadu_pd(xi + 3), _mm_loadu_pd(xi + 2));
+            acc01 = _mm_add_pd(acc01, _mm_mul_pd(_mm_add_pd(y0lo, y1lo), dxlo));
+            acc23 = _mm_add_pd(acc23, _mm_mul_pd(_mm_add_pd(y0hi, y1hi), dxhi));
+            accSq01 = _mm_add_pd(accSq01,
+                                 _mm_mul_pd(_mm_add_pd(_mm_mul_pd(y0lo, y0lo), _mm_mul_pd(y1lo, y1lo)), dxlo));
+            accSq23 = _mm_add_pd(accSq23,
+                                 _mm_mul_pd(_mm_add_pd(_mm_mul_pd(y0hi, y0hi), _mm_mul_pd(y1hi, y1hi)), dxhi));
+        }
+        if (extrema) {
+            __m128d mask = _mm_cmplt_pd(y1lo, min01);
+            min01 = _mm_or_pd(_mm_and_pd(mask, y1lo), _mm_andnot_pd(mask, min01));
+            minIdx01 = _mm_or_pd(_mm_and_pd(mask, idx01), _mm_andnot_pd(mask, minIdx01));
+            mask = _mm_cmplt_pd(y1hi, min23);
+            min23 = _mm_or_pd(_mm_and_pd(mask, y1hi), _mm_andnot_pd(mask, min23));
+            minIdx23 = _mm_or_pd(_mm_and_pd(mask, idx23), _mm_andnot_pd(mask, minIdx23));
+            mask = _mm_cmpgt_pd(y1lo, max01);
+            max01 = _mm_or_pd(_mm_and_pd(mask, y1lo), _mm_andnot_pd(mask, max01));
+            maxIdx01 = _mm_or_pd(_mm_and_pd(mask, idx01), _mm_andnot_pd(mask, maxIdx01));
+            mask = _mm_cmpgt_pd(y1hi, max23);
+            max23 = _mm_or_pd(_mm_and_pd(mask, y1hi), _mm_andnot_pd(mask, max23));
+            maxIdx23 = _mm_or_pd(_mm_and_pd(mask, idx23), _mm_andnot_pd(mask, maxIdx23));
+            idx01 = _mm_add_pd(idx01, four);
+            idx23 = _mm_add_pd(idx23, four);
+        }
+    }
+    double acc[4], accSq[4], laneMin[4], laneMinIdx[4], laneMax[4], laneMaxIdx[4];
+    _mm_storeu_pd(acc, acc01);
+    _mm_storeu_pd(acc + 2, acc23);
+    _mm_storeu_pd(accSq, accSq01);
+    _mm_storeu_pd(accSq + 2, accSq23);
+    _mm_storeu_pd(laneMin, min01);
+    _mm_storeu_pd(laneMin + 2, min23);
+    _mm_storeu_pd(laneMinIdx, minIdx01);
+    _mm_storeu_pd(laneMinIdx + 2, minIdx23);
+    _mm_storeu_pd(laneMax, max01);
+    _mm_storeu_pd(laneMax + 2, max23);
+    _mm_storeu_pd(laneMaxIdx, maxIdx01);
+    _mm_storeu_pd(laneMaxIdx + 2, maxIdx23);
+    ScanRangeLanes(x, y, first, done, last, flags, laneMin, laneMinIdx, laneMax, laneMaxIdx, acc, accSq, min, max,
+                   minIdx, maxIdx, scanPtr);
+}
+#endif /* MEAS_HAVE_SSE2 */
+
+#ifdef MEAS_HAVE_AVX2
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanRangeAvx2 --
+ *
+ *      AVX2 implementation of ScanRange(), processes 4 segments per iteration with one 4-lane register. Compiled for
+ *      AVX2 with a target attribute and only called if the CPU supports it. See ScanRangeScalar() for the parameters.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+__attribute__((target("avx2"))) static void ScanRangeAvx2(const double *x, const double *y, Tcl_Size first,
+                                                          Tcl_Size last, int flags, RangeScan *scanPtr) {
+    double min = scanPtr->min, max = scanPtr->max;
+    Tcl_Size minIdx = -1, maxIdx = -1;
+    int extrema = flags & SCAN_EXTREMA;
+    int sums = flags & SCAN_SUMS;
+    if (last < first) {
+        ScanRangeScalar(x, y, first, last, flags, scanPtr);
+        return;
+    }
+    if (extrema) {
+        if (y[first] < min) {
+            min = y[first];
+            minIdx = first;
+        }
+        if (y[first] > max) {
+            max = y[first];
+            maxIdx = first;
+        }
+    }
+    Tcl_Size done = (last - first) & ~(Tcl_Size)3;
+    __m256d vacc = _mm256_setzero_pd(), vaccSq = _mm256_setzero_pd();
+    __m256d vmin = _mm256_set1_pd(min), vmax = _mm256_set1_pd(max);
+    __m256d vminIdx = _mm256_set1_pd(-1.0), vmaxIdx = vminIdx;
+    __m256d idx = _mm256_setr_pd((double)(first + 1), (double)(first + 2), (double)(first + 3), (double)(first + 4));
+    __m256d four = _mm256_set1_pd(4.0);
+    for (Tcl_Size k = 0; k < done; k += 4) {
+        const double *yi = y + first + k;
+        __m256d y1 = _mm256_loadu_pd(yi + 1);
+        if (sums) {
+            const double *xi = x + first + k;
+            __m256d y0 = _mm256_loadu_pd(yi);
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xi + 1), _mm256_loadu_pd(xi));
+            vacc = _mm256_add_pd(vacc, _mm256_mul_pd(_mm256_add_pd(y0, y1), dx));
+            vaccSq = _mm256_add_pd(vaccSq,
+                                   _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(y0, y0), _mm256_mul_pd(y1, y1)), dx));
+        }
+        if (extrema) {
+            __m256d mask = _mm256_cmp_pd(y1, vmin, _CMP_LT_OQ);
+            vmin = _mm256_blendv_pd(vmin, y1, mask);
+            vminIdx = _mm256_blendv_pd(vminIdx, idx, mask);
+            mask = _mm256_cmp_pd(y1, vmax, _CMP_GT_OQ);
+            vmax = _mm256_blendv_pd(vmax, y1, mask);
+            vmaxIdx = _mm256_blendv_pd(vmaxIdx, idx, mask);
+            idx = _mm256_add_pd(idx, four);
+        }
+    }
+    double acc[4], accSq[4], laneMin[4], laneMinIdx[4], laneMax[4], laneMaxIdx[4];
+    _mm256_storeu_pd(acc, vacc);
+    _mm256_storeu_pd(accSq, vaccSq);
+    _mm256_storeu_pd(laneMin, vmin);
+    _mm256_storeu_pd(laneMinIdx, vminIdx);
+    _mm256_storeu_pd(laneMax, vmax);
+    _mm256_storeu_pd(laneMaxIdx, vmaxIdx);
+    ScanRangeLanes(x, y, first, done, last, flags, laneMin, laneMinIdx, laneMax, laneMaxIdx, acc, accSq, min, max,
+                   minIdx, maxIdx, scanPtr);
+}
+#endif /* MEAS_HAVE_AVX2 */
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * BitCount64, LowestBit64, HighestBit64 --
+ *
+ *      Number of set bits, index of the lowest set bit and index of the highest set bit of a non-zero 64-bit mask.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline int BitCount64(Tcl_WideUInt mask) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+static inline int LowestBit64(Tcl_WideUInt mask) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static inline int HighestBit64(Tcl_WideUInt mask) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(mask);
+#else
+    int bit = 0;
+    while (mask >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CrossAt --
+ *
+ *      Checks if segment [i, i+1] holds a crossing described by `searchPtr`.
+ *
+ * Parameters:
+ *      const CrossSearch *searchPtr - input: vectors, level and condition of the search
+ *      Tcl_Size i                   - input: index of the segment
+ *
+ * Results:
+ *      1 if the segment holds a crossing, 0 otherwise
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      Crossing of a level: rise is y[i] <= val < y[i+1], fall is y[i] >= val > y[i+1], cross is any of them.
+ *      Crossing of two vectors: the segments touch or intersect, rise and fall then require y[i] < y[i+1] and
+ *      y[i] > y[i+1], cross accepts any crossing.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline int CrossAt(const CrossSearch *searchPtr, Tcl_Size i) {
+    double a = searchPtr->y[i], b = searchPtr->y[i + 1];
+    if (searchPtr->y2 == NULL) {
+        double val = searchPtr->val;
+        switch ((enum Conditions)searchPtr->cond) {
+        case COND_RISE:
+            return (a <= val) && (b > val);
+        case COND_FALL:
+            return (a >= val) && (b < val);
+        case COND_CROSS:
+            return ((a <= val) && (b > val)) || ((a >= val) && (b < val));
+        }
+        return 0;
+    }
+    double c = searchPtr->y2[i], d = searchPtr->y2[i + 1];
+    if (!(((a >= c) && (b <= d)) || ((a <= c) && (b >= d)))) {
+        return 0;
+    }
+    switch ((enum Conditions)searchPtr->cond) {
+    case COND_RISE:
+        return a < b;
+    case COND_FALL:
+        return a > b;
+    case COND_CROSS:
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CrossMaskScalar --
+ *
+ *      Portable implementation of the crossing mask: checks `n` consecutive segments with CrossAt().
+ *
+ * Parameters:
+ *      const CrossSearch *searchPtr - input: vectors, level and condition of the search
+ *      Tcl_Size i                   - input: index of the first segment
+ *      int n                        - input: number of segments, 1 to 64
+ *
+ * Results:
+ *      Mask with bit k set if segment i+k holds a crossing
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_WideUInt CrossMaskScalar(const CrossSearch *searchPtr, Tcl_Size i, int n) {
+    Tcl_WideUInt mask = 0;
+    for (int k = 0; k < n; ++k) {
+        if (CrossAt(searchPtr, i + k)) {
+            mask |= (Tcl_WideUInt)1 << k;
+        }
+    }
+    return mask;
+}
+
+#ifdef MEAS_HAVE_SSE2
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CrossMaskSse2 --
+ *
+ *      SSE2 implementation of the crossing mask, compares 2 segments per instruction. See CrossMaskScalar().
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_WideUInt CrossMaskSse2(const CrossSearch *searchPtr, Tcl_Size i, int n) {
+    const double *y = searchPtr->y + i;
+    const double *y2 = (searchPtr->y2 != NULL) ? searchPtr->y2 + i : NULL;
+    int cond = searchPtr->cond;
+    __m128d val = _mm_set1_pd(searchPtr->val);
+    Tcl_WideUInt mask = 0;
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        __m128d a = _mm_loadu_pd(y + k), b = _mm_loadu_pd(y + k + 1);
+        __m128d hit;
+        if (y2 == NULL) {
+            __m128d rise = _mm_and_pd(_mm_cmple_pd(a, val), _mm_cmpgt_pd(b, val));
+            __m128d fall = _mm_and_pd(_mm_cmpge_pd(a, val), _mm_cmplt_pd(b, val));
+            hit = (cond == COND_RISE) ? rise : (cond == COND_FALL) ? fall : _mm_or_pd(rise, fall);
+        } else {
+            __m128d c = _mm_loadu_pd(y2 + k), d = _mm_loadu_pd(y2 + k + 1);
+            hit = _mm_or_pd(_mm_and_pd(_mm_cmpge_pd(a, c), _mm_cmple_pd(b, d)),
+                            _mm_and_pd(_mm_cmple_pd(a, c), _mm_cmpge_pd(b, d)));
+            if (cond == COND_RISE) {
+                hit = _mm_and_pd(hit, _mm_cmplt_pd(a, b));
+            } else if (cond == COND_FALL) {
+                hit = _mm_and_pd(hit, _mm_cmpgt_pd(a, b));
+            }
+        }
+        mask |= (Tcl_WideUInt)_mm_movemask_pd(hit) << k;
+    }
+    for (; k < n; ++k) {
+        if (CrossAt(searchPtr, i + k)) {
+            mask |= (Tcl_WideUInt)1 << k;
+        }
+    }
+    return mask;
+}
+#endif /* MEAS_HAVE_SSE2 */
+
+#ifdef MEAS_HAVE_AVX2
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CrossMaskAvx2 --
+ *
+ *      AVX2 implementation of the crossing mask, compares 4 segments per instruction. See CrossMaskScalar().
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+__attribute__((target("avx2"))) static Tcl_WideUInt CrossMaskAvx2(const CrossSearch *searchPtr, Tcl_Size i, int n) {
+    const double *y = searchPtr->y + i;
+    const double *y2 = (searchPtr->y2 != NULL) ? searchPtr->y2 + i : NULL;
+    int cond = searchPtr->cond;
+    __m256d val = _mm256_set1_pd(searchPtr->val);
+    Tcl_WideUInt mask = 0;
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d a = _mm256_loadu_pd(y + k), b = _mm256_loadu_pd(y + k + 1);
+        __m256d hit;
+        if (y2 == NULL) {
+            __m256d rise = _mm256_and_pd(_mm256_cmp_pd(a, val, _CMP_LE_OQ), _mm256_cmp_pd(b, val, _CMP_GT_OQ));
+            __m256d fall = _mm256_and_pd(_mm256_cmp_pd(a, val, _CMP_GE_OQ), _mm256_cmp_pd(b, val, _CMP_LT_OQ));
+            hit = (cond == COND_RISE) ? rise : (cond == COND_FALL) ? fall : _mm256_or_pd(rise, fall);
+        } else {
+            __m256d c = _mm256_loadu_pd(y2 + k), d = _mm256_loadu_pd(y2 + k + 1);
+            hit = _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(a, c, _CMP_GE_OQ), _mm256_cmp_pd(b, d, _CMP_LE_OQ)),
+                               _mm256_and_pd(_mm256_cmp_pd(a, c, _CMP_LE_OQ), _mm256_cmp_pd(b, d, _CMP_GE_OQ)));
+            if (cond == COND_RISE) {
+                hit = _mm256_and_pd(hit, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+            } else if (cond == COND_FALL) {
+                hit = _mm256_and_pd(hit, _mm256_cmp_pd(a, b, _CMP_GT_OQ));
+            }
+        }
+        mask |= (Tcl_WideUInt)_mm256_movemask_pd(hit) << k;
+    }
+    for (; k < n; ++k) {
+        if (CrossAt(searchPtr, i + k)) {
+            mask |= (Tcl_WideUInt)1 << k;
+        }
+    }
+    return mask;
+}
+#endif /* MEAS_HAVE_AVX2 */
+
+/*
+ * Implementations of ScanRange() and of the crossing mask indexed by enum MeasKernels, NULL where they are not built.
+ */
+static const MeasKernel measKernels[] = {
+    {NULL, NULL},
+    {ScanRangeScalar, CrossMaskScalar},
+#ifdef MEAS_HAVE_SSE2
+    {ScanRangeSse2, CrossMaskSse2},
+#else
+    {NULL, NULL},
+#endif
+#ifdef MEAS_HAVE_AVX2
+    {ScanRangeAvx2, CrossMaskAvx2},
+#else
+    {NULL, NULL},
+#endif
+};
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * KernelSupported --
+ *
+ *      Tells whether the implementations of ScanRange() and of the crossing mask for an instruction set are built and
+ *      can run on the CPU.
+ *
+ * Parameters:
+ *      int kernel             - input: one of KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2
+ *
+ * Results:
+ *      Nonzero if the kernel can be used
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int KernelSupported(int kernel) {
+    if ((kernel <= KERNEL_AUTO) || (kernel > KERNEL_AVX2) || (measKernels[kernel].scanRange == NULL)) {
+        return 0;
+    }
+#ifdef MEAS_HAVE_AVX2
+    if (kernel == KERNEL_AVX2) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * BestKernel --
+ *
+ *      Selects the fastest implementations of ScanRange() and of the crossing mask supported by the CPU.
+ *
+ * Parameters:
+ *      None
+ *
+ * Results:
+ *      KERNEL_AVX2, KERNEL_SSE2 or KERNEL_SCALAR
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int BestKernel(void) {
+    int kernel = KERNEL_AVX2;
+    while ((kernel > KERNEL_SCALAR) && !KernelSupported(kernel)) {
+        kernel--;
+    }
+    return kernel;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetKernel --
+ *
+ *      Returns the implementations of ScanRange() and of the crossing mask used by an interpreter.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr - input: settings of the interpreter, NULL for the fastest implementations
+ *
+ * Results:
+ *      Entry of measKernels
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      The kernel is part of the settings of each interpreter and is passed along with the scans and the searches,
+ *      so pinning it with `configure -kernel` never changes the kernels used by other interpreters or running jobs.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static const MeasKernel *GetKernel(const MeasConfig *configPtr) {
+    return &measKernels[(configPtr != NULL) ? configPtr->kernel : BestKernel()];
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanBlocks --
+ *
+ *      Scans blocks [blockFirst, blockEnd) of MEAS_SUM_BLOCK segments of the range y[first..last], block k starts at
+ *      point first + k * MEAS_SUM_BLOCK. The sums of every block are stored separately for PairwiseSum().
+ *
+ * Parameters:
+ *      const ScanChunks *jobPtr     - input: vectors, whole range, SCAN_* flags and kernel of the scan
+ *      Tcl_Size blockFirst          - input: index of the first block to scan
+ *      Tcl_Size blockEnd            - input: index past the last block to scan
+ *      double *blockSums            - output: sum of block k at index k
+ *      double *blockSumsSq          - output: sum of squares of block k at index k
+ *      RangeScan *scanPtr           - input/output: start values of the extrema, extrema of the scanned blocks, the
+ *                                     sums are left at zero
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanBlocks(const ScanChunks *jobPtr, Tcl_Size blockFirst, Tcl_Size blockEnd, double *blockSums,
+                       double *blockSumsSq, RangeScan *scanPtr) {
+    RangeScan block;
+    block.min = scanPtr->min;
+    block.max = scanPtr->max;
+    scanPtr->minIdx = scanPtr->maxIdx = -1;
+    for (Tcl_Size k = blockFirst; k < blockEnd; ++k) {
+        Tcl_Size start = jobPtr->first + k * MEAS_SUM_BLOCK;
+        Tcl_Size end = (jobPtr->last - start > MEAS_SUM_BLOCK) ? (start + MEAS_SUM_BLOCK) : jobPtr->last;
+        jobPtr->scanRange(jobPtr->x, jobPtr->y, start, end, jobPtr->flags, &block);
+        if (block.minIdx >= 0) {
+            scanPtr->minIdx = block.minIdx;
+        }
+        if (block.maxIdx >= 0) {
+            scanPtr->maxIdx = block.maxIdx;
+        }
+        blockSums[k] = block.sum;
+        blockSumsSq[k] = block.sumSq;
+    }
+    scanPtr->min = block.min;
+    scanPtr->max = block.max;
+    scanPtr->sum = scanPtr->sumSq = 0.0;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * PairwiseSum --
+ *
+ *      Sums `len` values by splitting them in halves recursively. The order of additions depends only on `len`, and
+ *      the rounding error grows with log2(len) instead of len.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static double PairwiseSum(const double *values, Tcl_Size len) {
+    if (len <= 2) {
+        return (len == 2) ? (values[0] + values[1]) : (len == 1) ? values[0] : 0.0;
+    }
+    Tcl_Size half = len / 2;
+    return PairwiseSum(values, half) + PairwiseSum(values + half, len - half);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanChunkProc --
+ *
+ *      Chunk procedure of ScanRange(): scans the points, or the blocks of segments for reproducible sums, of one chunk
+ *      with the kernel of the interpreter.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanChunkProc(void *clientData, int chunk) {
+    ScanChunks *jobPtr = (ScanChunks *)clientData;
+    if (jobPtr->blockSums != NULL) {
+        ScanBlocks(jobPtr, jobPtr->bounds[chunk], jobPtr->bounds[chunk + 1], jobPtr->blockSums,
+                   jobPtr->blockSums + jobPtr->blocks, &jobPtr->scans[chunk]);
+    } else {
+        jobPtr->scanRange(jobPtr->x, jobPtr->y, jobPtr->bounds[chunk], jobPtr->bounds[chunk + 1], jobPtr->flags,
+                          &jobPtr->scans[chunk]);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanRange --
+ *
+ *      Scans the points y[first..last] once and computes, depending on `flags`:
+ *          SCAN_EXTREMA - the smallest value below scanPtr->min and the largest value above scanPtr->max, with the
+ *                         index of their first occurrence (strict comparisons, so NaN values are never selected)
+ *          SCAN_SUMS    - sum of (y[i] + y[i+1]) * (x[i+1] - x[i]) and of (y[i]^2 + y[i+1]^2) * (x[i+1] - x[i]) over
+ *                         the segments between the points, twice the trapezoidal integrals of y and y^2
+ *      Dispatches to the SIMD implementation of the interpreter settings. Long ranges are split into chunks that are
+ *      scanned on the worker pool when the interpreter is configured with more than one thread.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr - input: settings of the interpreter, NULL to scan in the calling thread with the
+ *                                    fastest implementation
+ *      Other parameters            - see ScanRangeScalar()
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      Chunks are merged in order: extrema keep the first occurrence and sums are added chunk by chunk, so the sums
+ *      depend on the number of chunks. In reproducible mode (configure -reproducible) the sums are computed over
+ *      fixed blocks of MEAS_SUM_BLOCK segments counted from `first` and the block sums are added with PairwiseSum(),
+ *      so the result does not depend on the number of threads or on the SIMD implementation. Chunks then hold whole
+ *      blocks.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanRange(const MeasConfig *configPtr, const double *x, const double *y, Tcl_Size first, Tcl_Size last,
+                      int flags, RangeScan *scanPtr) {
+    ScanChunks job;
+    int chunks;
+    job.scanRange = GetKernel(configPtr)->scanRange;
+    job.blockSums = NULL;
+    if ((configPtr != NULL) && configPtr->reproducible && (flags & SCAN_SUMS) && (last - first > MEAS_SUM_BLOCK)) {
+        job.blocks = (last - first + MEAS_SUM_BLOCK - 1) / MEAS_SUM_BLOCK;
+        job.blockSums = (double *)Tcl_Alloc(sizeof(double) * 2 * job.blocks);
+        chunks = SplitRange(configPtr, 0, job.blocks, MEAS_CHUNK_MIN / MEAS_SUM_BLOCK, job.bounds);
+    } else {
+        chunks = SplitRange(configPtr, first, last, MEAS_CHUNK_MIN, job.bounds);
+        if (chunks == 1) {
+            job.scanRange(x, y, first, last, flags, scanPtr);
+            return;
+        }
+    }
+    job.x = x;
+    job.y = y;
+    job.first = first;
+    job.last = last;
+    job.flags = flags;
+    for (int c = 0; c < chunks; ++c) {
+        job.scans[c].min = scanPtr->min;
+        job.scans[c].max = scanPtr->max;
+    }
+    if (chunks == 1) {
+        ScanChunkProc(&job, 0);
+    } else {
+        RunChunks(chunks, ScanChunkProc, &job);
+    }
+    scanPtr->minIdx = scanPtr->maxIdx = -1;
+    scanPtr->sum = scanPtr->sumSq = 0.0;
+    for (int c = 0; c < chunks; ++c) {
+        if ((job.scans[c].minIdx >= 0) && (job.scans[c].min < scanPtr->min)) {
+            scanPtr->min = job.scans[c].min;
+            scanPtr->minIdx = job.scans[c].minIdx;
+        }
+        if ((job.scans[c].maxIdx >= 0) && (job.scans[c].max > scanPtr->max)) {
+            scanPtr->max = job.scans[c].max;
+            scanPtr->maxIdx = job.scans[c].maxIdx;
+        }
+        scanPtr->sum += job.scans[c].sum;
+        scanPtr->sumSq += job.scans[c].sumSq;
+    }
+    if (job.blockSums != NULL) {
+        scanPtr->sum = PairwiseSum(job.blockSums, job.blocks);
+        scanPtr->sumSq = PairwiseSum(job.blockSums + job.blocks, job.blocks);
+        Tcl_Free((char *)job.blockSums);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * SearchCrossing --
+ *
+ *      Finds the *countPtr-th crossing among segments [first, end) in the calling thread, checking blocks of 64
+ *      segments with the crossing mask kernel of the search.
+ *
+ * Parameters:
+ *      const CrossSearch *searchPtr - input: vectors, level and condition of the search
+ *      Tcl_Size first               - input: index of the first segment to check
+ *      Tcl_Size end                 - input: index past the last segment to check
+ *      Tcl_WideInt *countPtr        - input/output: 1-based number of the crossing, on return decreased by the number
+ *                                     of crossings passed
+ *
+ * Results:
+ *      Index of the segment, or -1 if the range holds fewer crossings
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size SearchCrossing(const CrossSearch *searchPtr, Tcl_Size first, Tcl_Size end, Tcl_WideInt *countPtr) {
+    for (Tcl_Size blockStart = first; blockStart < end; blockStart += 64) {
+        int n = (end - blockStart > 64) ? 64 : (int)(end - blockStart);
+        Tcl_WideUInt mask = searchPtr->crossMask(searchPtr, blockStart, n);
+        int bits = BitCount64(mask);
+        if (*countPtr <= bits) {
+            while (--*countPtr > 0) {
+                mask &= mask - 1;
+            }
+            return blockStart + LowestBit64(mask);
+        }
+        *countPtr -= bits;
+    }
+    return -1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CountCrossingsProc, FillCrossingsProc --
+ *
+ *      Chunk procedures of FindCrossing() and CollectCrossings(): count the crossings of one chunk, and store the
+ *      segments of the crossings of one chunk at the chunk offset in the hits array.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void CountCrossingsProc(void *clientData, int chunk) {
+    CrossChunks *jobPtr = (CrossChunks *)clientData;
+    Tcl_WideInt count = 0;
+    for (Tcl_Size blockStart = jobPtr->bounds[chunk]; blockStart < jobPtr->bounds[chunk + 1]; blockStart += 64) {
+        Tcl_Size left = jobPtr->bounds[chunk + 1] - blockStart;
+        count += BitCount64(jobPtr->searchPtr->crossMask(jobPtr->searchPtr, blockStart, (left > 64) ? 64 : (int)left));
+    }
+    jobPtr->counts[chunk] = count;
+}
+
+static void FillCrossingsProc(void *clientData, int chunk) {
+    CrossChunks *jobPtr = (CrossChunks *)clientData;
+    Tcl_Size *hits = jobPtr->hits + jobPtr->offsets[chunk];
+    for (Tcl_Size blockStart = jobPtr->bounds[chunk]; blockStart < jobPtr->bounds[chunk + 1]; blockStart += 64) {
+        Tcl_Size left = jobPtr->bounds[chunk + 1] - blockStart;
+        Tcl_WideUInt mask = jobPtr->searchPtr->crossMask(jobPtr->searchPtr, blockStart, (left > 64) ? 64 : (int)left);
+        for (; mask; mask &= mask - 1) {
+            *hits++ = blockStart + LowestBit64(mask);
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * IndexBound, IndexRank --
+ *
+ *      Lookups in a crossing index: position of the first indexed crossing at or after segment `seg`, and number of
+ *      crossings of kind `cond` among the first k+1 indexed crossings (0 for k = -1). The rank grows exactly at the
+ *      crossings of kind `cond`, so binary searches over it find the n-th crossing of that kind.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size IndexBound(const CrossIndex *indexPtr, Tcl_Size seg) {
+    Tcl_Size lo = 0, hi = indexPtr->count;
+    while (lo < hi) {
+        Tcl_Size mid = lo + (hi - lo) / 2;
+        if (indexPtr->segs[mid] < seg) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static Tcl_Size IndexRank(const CrossIndex *indexPtr, int cond, Tcl_Size k) {
+    if (k < 0) {
+        return 0;
+    }
+    switch ((enum Conditions)cond) {
+    case COND_RISE:
+        return indexPtr->rises[k];
+    case COND_FALL:
+        return k + 1 - indexPtr->rises[k];
+    case COND_CROSS:
+        break;
+    }
+    return k + 1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindCrossing --
+ *
+ *      Finds the segment that holds the requested crossing among segments [first, end). The segments are checked in
+ *      blocks of 64 with the crossing mask kernel of the search, so only the blocks that contain the
+ *      requested crossing are looked at bit by bit.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, NULL to search in the calling thread
+ *      const CrossSearch *searchPtr - input: vectors, level and condition of the search
+ *      Tcl_Size first               - input: index of the first segment to check
+ *      Tcl_Size end                 - input: index past the last segment to check
+ *      Tcl_WideInt count            - input: 1-based number of the crossing, or -1 for the last one
+ *
+ * Results:
+ *      Index of the segment, or -1 if there is no such crossing
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      If the search has a crossing index, the crossing is found with binary searches in the index. Otherwise the
+ *      last crossing is searched from the end of the range backwards. When the range is split for several threads,
+ *      the first chunk is searched alone since early crossings are the common case, then the crossings of the other
+ *      chunks are counted in parallel and only the chunk that holds the requested one is searched.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size FindCrossing(const MeasConfig *configPtr, const CrossSearch *searchPtr, Tcl_Size first, Tcl_Size end,
+                             Tcl_WideInt count) {
+    const CrossIndex *indexPtr = searchPtr->indexPtr;
+    if (indexPtr != NULL) {
+        Tcl_Size lo = IndexBound(indexPtr, first);
+        Tcl_Size hi = IndexBound(indexPtr, end);
+        Tcl_Size before = IndexRank(indexPtr, searchPtr->cond, lo - 1);
+        Tcl_Size total = IndexRank(indexPtr, searchPtr->cond, hi - 1) - before;
+        if (count == -1) {
+            count = total;
+        }
+        if ((count < 1) || (count > total)) {
+            return -1;
+        }
+        while (lo < hi) {
+            Tcl_Size mid = lo + (hi - lo) / 2;
+            if (IndexRank(indexPtr, searchPtr->cond, mid) - before < count) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return indexPtr->segs[lo];
+    }
+    if (count == -1) {
+        for (Tcl_Size blockEnd = end; blockEnd > first;) {
+            Tcl_Size blockStart = (blockEnd - first > 64) ? (blockEnd - 64) : first;
+            Tcl_WideUInt mask = searchPtr->crossMask(searchPtr, blockStart, (int)(blockEnd - blockStart));
+            if (mask) {
+                return blockStart + HighestBit64(mask);
+            }
+            blockEnd = blockStart;
+        }
+        return -1;
+    }
+    if (count < 1) {
+        return -1;
+    }
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1];
+    int chunks = SplitRange(configPtr, first, end, MEAS_CHUNK_MIN, bounds);
+    Tcl_Size i = SearchCrossing(searchPtr, bounds[0], bounds[1], &count);
+    if ((i >= 0) || (chunks == 1)) {
+        return i;
+    }
+    CrossChunks job;
+    job.searchPtr = searchPtr;
+    job.bounds = bounds + 1;
+    RunChunks(chunks - 1, CountCrossingsProc, &job);
+    for (int c = 0; c < chunks - 1; ++c) {
+        if (count <= job.counts[c]) {
+            return SearchCrossing(searchPtr, job.bounds[c], job.bounds[c + 1], &count);
+        }
+        count -= job.counts[c];
+    }
+    return -1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CollectCrossings --
+ *
+ *      Finds all crossings among segments [first, end). If the search has a crossing index, the crossings are copied
+ *      from it. Otherwise the crossings of each chunk are counted first, then every chunk stores its segments at its
+ *      offset in the result, both passes run on the worker pool for long ranges.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, NULL to search in the calling thread
+ *      const CrossSearch *searchPtr - input: vectors, level and condition of the search
+ *      Tcl_Size first               - input: index of the first segment to check
+ *      Tcl_Size end                 - input: index past the last segment to check
+ *      Tcl_Size *countPtr           - output: number of crossings
+ *
+ * Results:
+ *      Increasing indices of the segments allocated with Tcl_Alloc, NULL if there are no crossings
+ *
+ * Side Effects:
+ *      The caller frees the result with Tcl_Free
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Size *CollectCrossings(const MeasConfig *configPtr, const CrossSearch *searchPtr, Tcl_Size first,
+                                  Tcl_Size end, Tcl_Size *countPtr) {
+    const CrossIndex *indexPtr = searchPtr->indexPtr;
+    if (indexPtr != NULL) {
+        Tcl_Size lo = IndexBound(indexPtr, first);
+        Tcl_Size hi = IndexBound(indexPtr, end);
+        Tcl_Size total = IndexRank(indexPtr, searchPtr->cond, hi - 1) - IndexRank(indexPtr, searchPtr->cond, lo - 1);
+        *countPtr = (total > 0) ? total : 0;
+        if (total <= 0) {
+            return NULL;
+        }
+        Tcl_Size *hits = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * total);
+        for (Tcl_Size k = lo, n = 0; k < hi; ++k) {
+            if (IndexRank(indexPtr, searchPtr->cond, k) != IndexRank(indexPtr, searchPtr->cond, k - 1)) {
+                hits[n++] = indexPtr->segs[k];
+            }
+        }
+        return hits;
+    }
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1];
+    CrossChunks job;
+    int chunks = SplitRange(configPtr, first, end, MEAS_CHUNK_MIN, bounds);
+    job.searchPtr = searchPtr;
+    job.bounds = bounds;
+    if (chunks == 1) {
+        CountCrossingsProc(&job, 0);
+    } else {
+        RunChunks(chunks, CountCrossingsProc, &job);
+    }
+    Tcl_Size total = 0;
+    for (int c = 0; c < chunks; ++c) {
+        job.offsets[c] = total;
+        total += (Tcl_Size)job.counts[c];
+    }
+    *countPtr = total;
+    if (total == 0) {
+        return NULL;
+    }
+    job.hits = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * total);
+    if (chunks == 1) {
+        FillCrossingsProc(&job, 0);
+    } else {
+        RunChunks(chunks, FillCrossingsProc, &job);
+    }
+    return job.hits;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindLevels --
+ *
+ *      Finds the count-th crossing of each of several levels by the same vector among segments [first, end) in a
+ *      single pass: every block of 64 segments is checked for all levels that are still searched before the next
+ *      block is read.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, NULL to search in the calling thread
+ *      const CrossSearch *searches  - input: search of each level, same vector and condition, without crossing index
+ *      int levels                   - input: number of levels
+ *      Tcl_Size first               - input: index of the first segment to check
+ *      Tcl_Size end                 - input: index past the last segment to check
+ *      Tcl_WideInt count            - input: 1-based number of the crossing, -1 for the last one
+ *      Tcl_Size *hits               - output: index of the segment of each level, -1 for the levels with fewer
+ *                                     crossings
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      The scan stops as soon as every level is found. As in FindCrossing(), the first chunk of a long range is
+ *      searched by the calling thread, then the crossings of the levels left are counted in the other chunks by the
+ *      worker pool and only the chunk of each crossing is searched again. The last crossings are searched backwards
+ *      from `end` by the calling thread. Crossing indices are neither used nor built, so the levels get the same
+ *      segments FindCrossing() finds without touching the index of the vector.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FindLevels(const MeasConfig *configPtr, const CrossSearch *searches, int levels, Tcl_Size first,
+                       Tcl_Size end, Tcl_WideInt count, Tcl_Size *hits) {
+    int left = levels;
+    for (int l = 0; l < levels; ++l) {
+        hits[l] = -1;
+    }
+    if (count == -1) {
+        for (Tcl_Size blockEnd = end; (blockEnd > first) && (left > 0);) {
+            Tcl_Size blockStart = (blockEnd - first > 64) ? (blockEnd - 64) : first;
+            for (int l = 0; l < levels; ++l) {
+                if (hits[l] >= 0) {
+                    continue;
+                }
+                Tcl_WideUInt mask = searches[l].crossMask(&searches[l], blockStart, (int)(blockEnd - blockStart));
+                if (mask) {
+                    hits[l] = blockStart + HighestBit64(mask);
+                    left--;
+                }
+            }
+            blockEnd = blockStart;
+        }
+        return;
+    }
+    if (count < 1) {
+        return;
+    }
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1];
+    int chunks = SplitRange(configPtr, first, end, MEAS_CHUNK_MIN, bounds);
+    Tcl_WideInt *counts = (Tcl_WideInt *)Tcl_Alloc(sizeof(Tcl_WideInt) * levels * chunks);
+    for (int l = 0; l < levels; ++l) {
+        counts[l] = count;
+    }
+    for (Tcl_Size blockStart = bounds[0]; (blockStart < bounds[1]) && (left > 0); blockStart += 64) {
+        int n = (bounds[1] - blockStart > 64) ? 64 : (int)(bounds[1] - blockStart);
+        for (int l = 0; l < levels; ++l) {
+            if (hits[l] >= 0) {
+                continue;
+            }
+            Tcl_WideUInt mask = searches[l].crossMask(&searches[l], blockStart, n);
+            int bits = BitCount64(mask);
+            if (counts[l] <= bits) {
+                while (--counts[l] > 0) {
+                    mask &= mask - 1;
+                }
+                hits[l] = blockStart + LowestBit64(mask);
+                left--;
+            } else {
+                counts[l] -= bits;
+            }
+        }
+    }
+    if ((left > 0) && (chunks > 1)) {
+        LevelChunks job;
+        job.searches = searches;
+        job.levels = levels;
+        job.bounds = bounds + 1;
+        job.hits = hits;
+        job.counts = counts + levels;
+        RunChunks(chunks - 1, CountLevelsProc, &job);
+        for (int l = 0; l < levels; ++l) {
+            if (hits[l] >= 0) {
+                continue;
+            }
+            for (int c = 0; c < chunks - 1; ++c) {
+                Tcl_WideInt chunkCount = job.counts[c * levels + l];
+                if (counts[l] <= chunkCount) {
+                    hits[l] = SearchCrossing(&searches[l], job.bounds[c], job.bounds[c + 1], &counts[l]);
+                    break;
+                }
+                counts[l] -= chunkCount;
+            }
+        }
+    }
+    Tcl_Free((char *)counts);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CountLevelsProc --
+ *
+ *      Chunk procedure of FindLevels(): counts the crossings of the levels that are still searched in one chunk,
+ *      checking every block of the chunk for all of them before the next block.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void CountLevelsProc(void *clientData, int chunk) {
+    LevelChunks *jobPtr = (LevelChunks *)clientData;
+    Tcl_WideInt *counts = jobPtr->counts + chunk * jobPtr->levels;
+    for (int l = 0; l < jobPtr->levels; ++l) {
+        counts[l] = 0;
+    }
+    for (Tcl_Size blockStart = jobPtr->bounds[chunk]; blockStart < jobPtr->bounds[chunk + 1]; blockStart += 64) {
+        Tcl_Size left = jobPtr->bounds[chunk + 1] - blockStart;
+        for (int l = 0; l < jobPtr->levels; ++l) {
+            if (jobPtr->hits[l] < 0) {
+                const CrossSearch *searchPtr = &jobPtr->searches[l];
+                counts[l] += BitCount64(searchPtr->crossMask(searchPtr, blockStart, (left > 64) ? 64 : (int)left));
+            }
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetCrossIndex --
+ *
+ *      Gets the index of all crossings of level `val` by a vector for FindCrossing() and CollectCrossings(). The
+ *      first search of a level only records it, the index is built by the second search of the same level, so
+ *      single searches keep stopping at their crossing instead of scanning the whole vector.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, used to build the index
+ *      MeasVectorRep *repPtr        - input/output: representation of the vector that crosses the level
+ *      double val                   - input: crossed level
+ *
+ * Results:
+ *      Built index, or NULL if the level is searched for the first time
+ *
+ * Side Effects:
+ *      Records the level in the vector representation, replacing the oldest of MEAS_CROSS_LEVELS levels, and may
+ *      allocate the index
+ *
+ * Notes:
+ *      The index holds the segments of all crossings in increasing order and the running count of rising ones, rise
+ *      and fall are exclusive and cross is any of them, so one index answers every condition, count, delay and
+ *      range with binary searches. It is valid as long as the representation, whose values never change.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static CrossIndex *GetCrossIndex(const MeasConfig *configPtr, MeasVectorRep *repPtr, double val) {
+    if (isnan(val) || (repPtr->len < 2)) {
+        return NULL;
+    }
+    if (repPtr->crossIndex == NULL) {
+        repPtr->crossIndex = (CrossIndex *)Tcl_Alloc(sizeof(CrossIndex) * MEAS_CROSS_LEVELS);
+        for (int k = 0; k < MEAS_CROSS_LEVELS; ++k) {
+            repPtr->crossIndex[k].val = NAN;
+            repPtr->crossIndex[k].count = -1;
+            repPtr->crossIndex[k].segs = NULL;
+            repPtr->crossIndex[k].rises = NULL;
+        }
+    }
+    CrossIndex *indexPtr;
+    for (int k = 0; k < MEAS_CROSS_LEVELS; ++k) {
+        indexPtr = &repPtr->crossIndex[k];
+        if (indexPtr->val != val) {
+            continue;
+        }
+        if (indexPtr->count < 0) {
+            CrossSearch search = {repPtr->data, NULL, val, COND_CROSS, NULL, GetKernel(configPtr)->crossMask};
+            Tcl_Size count;
+            indexPtr->segs = CollectCrossings(configPtr, &search, 0, repPtr->len - 1, &count);
+            indexPtr->rises = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * (count > 0 ? count : 1));
+            Tcl_Size rises = 0;
+            for (Tcl_Size i = 0; i < count; ++i) {
+                rises += repPtr->data[indexPtr->segs[i] + 1] > val;
+                indexPtr->rises[i] = rises;
+            }
+            indexPtr->count = count;
+        }
+        return indexPtr;
+    }
+    indexPtr = &repPtr->crossIndex[repPtr->crossNext];
+    repPtr->crossNext = (repPtr->crossNext + 1) % MEAS_CROSS_LEVELS;
+    Tcl_Free((char *)indexPtr->segs);
+    Tcl_Free((char *)indexPtr->rises);
+    indexPtr->val = val;
+    indexPtr->count = -1;
+    indexPtr->segs = NULL;
+    indexPtr->rises = NULL;
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CalcXBetween --
+ *
+ *      Compute the X-coordinate of a point lying on the line segment between (x1, y1) and (x2, y2),
+ *      given a specific Y-coordinate (yBetween). This is a linear interpolation along the line.
+ *
+ * Parameters:
+ *      double x1         - input: X-coordinate of the first point
+ *      double y1         - input: Y-coordinate of the first point
+ *      double x2         - input: X-coordinate of the second point
+ *      double y2         - input: Y-coordinate of the second point
+ *      double yBetween   - input: Y value for which to compute the corresponding X on the line
+ *
+ * Results:
+ *      Returns the interpolated X-coordinate such that (x, yBetween) lies on the line from (x1, y1) to (x2, y2)
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline double CalcXBetween(double x1, double y1, double x2, double y2, double yBetween) {
+    return (yBetween - y1) * (x2 - x1) / (y2 - y1) + x1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CalcYBetween --
+ *
+ *      Compute the Y-coordinate of a point lying on the line segment between (x1, y1) and (x2, y2),
+ *      given a specific X-coordinate (xBetween). This is a linear interpolation along the line.
+ *
+ * Parameters:
+ *      double x1         - input: X-coordinate of the first point
+ *      double y1         - input: Y-coordinate of the first point
+ *      double x2         - input: X-coordinate of the second point
+ *      double y2         - input: Y-coordinate of the second point
+ *      double xBetween   - input: X value for which to compute the corresponding Y on the line
+ *
+ * Results:
+ *      Returns the interpolated Y-coordinate such that (xBetween, y) lies on the line from (x1, y1) to (x2, y2)
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline double CalcYBetween(double x1, double y1, double x2, double y2, double xBetween) {
+    return (y2 - y1) / (x2 - x1) * (xBetween - x1) + y1;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CalcCrossPoint --
+ *
+ *      Compute the X-coordinate of the intersection point of two lines. Each line is defined by a pair of points:
+ *      (x11, y11)-(x21, y21) for the first line, and (x12, y12)-(x22, y22) for the second line. The function assumes
+ *      the lines are not parallel and that the denominators are non-zero.
+ *
+ * Parameters:
+ *      double x11, y11   - input: coordinates of the first point on the first line
+ *      double x21, y21   - input: coordinates of the second point on the first line
+ *      double x12, y12   - input: coordinates of the first point on the second line
+ *      double x22, y22   - input: coordinates of the second point on the second line
+ *
+ * Results:
+ *      Returns the X-coordinate of the intersection point of the two lines.
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      The function does not perform error checking for division by zero. It is the caller's responsibility to ensure
+ *      the lines are not parallel (i.e., they have different slopes).
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline double CalcCrossPoint(double x11, double y11, double x21, double y21, double x12, double y12, double x22,
+                                    double y22) {
+    return (y12 - (y22 - y12) / (x22 - x12) * x12 - (y11 - (y21 - y11) / (x21 - x11) * x11)) /
+           ((y21 - y11) / (x21 - x11) - (y22 - y12) / (x22 - x12));
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * DerivSelect --
+ *
+ *      Prepare a 3-point stencil for derivative or interpolation calculations based on a specified X-coordinate
+ *      (`xwhen`) that lies between two adjacent sample points (xi and xip1). Depending on the location of `xwhen`
+ *      relative to the segment and its position in the array, the function selects appropriate X and Y values from
+ *      the input arrays `x` and `vec` and writes them into the `out` buffer.
+ *
+ * Parameters:
+ *      Tcl_WideInt i        - input: current segment index (base point index in x/vec arrays)
+ *      double xi            - input: X value at index `i`
+ *      double xwhen         - input: target X value (interpolation/evaluation point)
+ *      double xip1          - input: X value at index `i + 1`
+ *      Tcl_WideInt xlen     - input: total number of elements in the `x` array
+ *      const double *x      - input: array of X values (at least x[i-1] to x[i+2])
+ *      const double *vec    - input: array of corresponding Y values
+ *      double ywhen         - input: Y value at the point `xwhen` (for use in interpolation output)
+ *      double *out          - output: pointer to a 6-element array to store the selected X and Y values
+ *                                out[0..2] = selected X values (or interpolated positions)
+ *                                out[3..5] = selected Y values (with ywhen at the center)
+ *      int *pos             - output: index of the middle point in `out`, used to identify where `xwhen` fits:
+ *                                -1 = unknown/middle is ywhen (e.g. edge case),
+ *                                 0 = ywhen is second point in sequence (common case),
+ *                                 1 = ywhen is last (used for final segment)
+ *
+ * Results:
+ *      Populates the `out` buffer with 3 X values and 3 corresponding Y values to form a stencil around `xwhen`.
+ *      The result is intended for slope or interpolation use.
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void DerivSelect(Tcl_WideInt i, double xi, double xwhen, double xip1, Tcl_WideInt xlen, const double *x,
+                        const double *vec, double ywhen, double *out, int *pos) {
+    if (i == 0) {
+        if (xi == xwhen) {
+            out[0] = xwhen;
+            out[1] = xip1;
+            out[2] = x[i + 2];
+            out[3] = ywhen;
+            out[4] = vec[i + 1];
+            out[5] = vec[i + 2];
+            *pos = -1;
+        } else if (xip1 == xwhen) {
+            out[0] = xi;
+            out[1] = xwhen;
+            out[2] = x[i + 2];
+            out[3] = vec[i + 1];
+            out[4] = ywhen;
+            out[5] = vec[i + 2];
+            *pos = 0;
+        } else {
+            out[0] = xi;
+            out[1] = xwhen;
+            out[2] = xip1;
+            out[3] = vec[i];
+            out[4] = ywhen;
+            out[5] = vec[i + 1];
+            *pos = -1;
+        }
+    } else if (i == (xlen - 2)) {
+        if (xip1 == xwhen) {
+            out[0] = x[i - 1];
+            out[1] = xi;
+            out[2] = xwhen;
+            out[3] = vec[i - 1];
+            out[4] = vec[i];
+            out[5] = ywhen;
+            *pos = 1;
+        } else {
+            out[0] = xi;
+            out[1] = xwhen;
+            out[2] = xip1;
+            out[3] = vec[i];
+            out[4] = ywhen;
+            out[5] = vec[i + 1];
+            *pos = 1;
+        }
+    } else {
+        if (xi == xwhen) {
+            out[0] = x[i - 1];
+            out[1] = xwhen;
+            out[2] = xip1;
+            out[3] = vec[i - 1];
+            out[4] = ywhen;
+            out[5] = vec[i + 1];
+            *pos = 0;
+        } else if (xip1 == xwhen) {
+            out[0] = xi;
+            out[1] = xwhen;
+            out[2] = x[i + 2];
+            out[3] = vec[i];
+            out[4] = ywhen;
+            out[5] = vec[i + 2];
+            *pos = 0;
+        } else {
+            out[0] = xi;
+            out[1] = xwhen;
+            out[2] = xip1;
+            out[3] = vec[i];
+            out[4] = ywhen;
+            out[5] = vec[i + 1];
+            *pos = 0;
+        }
+    }
+    return;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * Deriv --
+ *
+ *      Compute the numerical derivative at a point using a three-point stencil. The function supports three types of
+ *      finite-difference approximations (centered, backward, and forward) depending on the `type` parameter.
+ *      The input values represent three adjacent (x, y) points: (xim1, yim1), (xi, yi), and (xip1, yip1).
+ *
+ * Parameters:
+ *      double xim1     - input: X value at i-1 (previous point)
+ *      double xi       - input: X value at i (current point)
+ *      double xip1     - input: X value at i+1 (next point)
+ *      double yim1     - input: Y value at i-1
+ *      double yi       - input: Y value at i
+ *      double yip1     - input: Y value at i+1
+ *      int type        - input: derivative type selector:
+ *                           0  = centered difference (at xi)
+ *                          -1  = backward-biased (at xi)
+ *                           1  = forward-biased (at xi)
+ *
+ * Results:
+ *      Returns the estimated derivative at xi using the appropriate finite-difference formula based on `type`.
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      This method handles non-uniform spacing between X values. It assumes that h1 = xi - xim1 and h2 = xip1 - xi
+ *      are both non-zero. If `type` is not -1, 0, or 1, the function returns 0.0 by default.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static double Deriv(double xim1, double xi, double xip1, double yim1, double yi, double yip1, int type) {
+    double h1 = xi - xim1;
+    double h2 = xip1 - xi;
+    if (type == 0) {
+        return -h2 / (h1 * (h1 + h2)) * yim1 - (h1 - h2) / (h1 * h2) * yi + h1 / (h2 * (h1 + h2)) * yip1;
+    } else if (type == -1) {
+        return -(2 * h1 + h2) / (h1 * (h1 + h2)) * yim1 + (h1 + h2) / (h1 * h2) * yi - h1 / (h2 * (h1 + h2)) * yip1;
+    } else if (type == 1) {
+        return h2 / (h1 * (h1 + h2)) * yim1 - (h1 + h2) / (h1 * h2) * yi + (h1 + 2 * h2) / (h2 * (h1 + h2)) * yip1;
+    }
+    return 0.0;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindDerivValue --
+ *
+ *      Computes the result of a Find-When or Deriv-When measurement at a crossing: the value of `findVec` or its
+ *      derivative at xWhen.
+ *
+ * Parameters:
+ *      const double *x         - input: strictly increasing x values
+ *      Tcl_Size len            - input: number of x values
+ *      const double *findVec   - input: values of the found vector, same length as `x`
+ *      Tcl_Size i              - input: segment of the crossing
+ *      double xWhen            - input: x of the crossing, within segment `i`
+ *      int derivMode           - input: nonzero for the derivative, zero for the value
+ *
+ * Results:
+ *      Value interpolated with CalcYBetween(), or derivative estimated with DerivSelect() and Deriv()
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static double FindDerivValue(const double *x, Tcl_Size len, const double *findVec, Tcl_Size i, double xWhen,
+                             int derivMode) {
+    double xi = x[i];
+    double xip1 = x[i + 1];
+    double value = CalcYBetween(xi, findVec[i], xip1, findVec[i + 1], xWhen);
+    if (derivMode) {
+        double derivData[6];
+        int derivPos;
+        DerivSelect(i, xi, xWhen, xip1, len, x, findVec, value, derivData, &derivPos);
+        value = Deriv(derivData[0], derivData[1], derivData[2], derivData[3], derivData[4], derivData[5], derivPos);
+    }
+    return value;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * TrigTargCmdProc2 --
+ *
+ *      Tcl command implementation that analyzes two vector signals (trigVec and targVec) over a shared time base (x),
+ *      detects specified edge transitions (rise, fall, or crossing) for each vector, and returns the time difference
+ *      between the trigger and target events. The function supports both fixed occurrence counts and "last" mode to
+ *      capture the final matching transition.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional client data (unused)
+ *      Tcl_Interp *interp            - input/output: interpreter used for argument parsing and result/error reporting
+ *      Tcl_Size objc                 - input: number of arguments passed to the command
+ *      Tcl_Obj *const objv[]         - input: argument vector; expected format:
+ *
+ *              objv[1]  = x           - Tcl list of numeric X values (time base)
+ *              objv[2]  = trigVec     - Tcl list of Y values for the trigger signal
+ *              objv[3]  = val1        - trigger threshold value
+ *              objv[4]  = targVec     - Tcl list of Y values for the target signal
+ *              objv[5]  = val2        - target threshold value
+ *              objv[6]  = trigCond    - trigger condition: "rise", "fall", or "cross"
+ *              objv[7]  = trigCount   - trigger hit index to use (or "last")
+ *              objv[8]  = targCond    - target condition: "rise", "fall", or "cross"
+ *              objv[9]  = targCount   - target hit index to use (or "last")
+ *              objv[10] = trigDelay   - minimum X value before trigger events are considered
+ *              objv[11] = targDelay   - minimum X value before target events are considered
+ *
+ * Results:
+ *      On success, returns a dictionary with the following keys:
+ *          "xtrig"   => interpolated X value at which trigger condition was met
+ *          "xtarg"   => interpolated X value at which target condition was met
+ *          "xdelta"  => difference (xtarg - xtrig)
+ *
+ *      On failure, returns TCL_ERROR and sets an error message in the interpreter.
+ *
+ * Side Effects:
+ *      Parses and converts lists to arrays, and individual values to doubles and integers.
+ *      May allocate intermediate Tcl_Obj structures.
+ *      Sets the interpreter result to either an error message or result dictionary.
+ *
+ * Notes:
+ *      - Lists must be of equal length.
+ *      - Events are detected on each segment (xi, xi+1), (vec[i], vec[i+1]) by FindCrossing(), which checks blocks of
+ *        64 segments at once and counts the crossings in a block with its bit mask. A level searched again on the
+ *        same vector is looked up in the crossing index of the vector (see GetCrossIndex()).
+ *      - Linear interpolation is used to estimate the exact X value where val1/val2 thresholds are crossed.
+ *      - Condition counts are 1-based; use "last" to return the final matching transition.
+ *      - If the requested condition is not found, a descriptive error is returned.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int TrigTargCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    int trigVecFoundFlag = 0;
+    int targVecFoundFlag = 0;
+    double xTrig = 0.0, xTarg = 0.0;
+    if (objc != 12) {
+        Tcl_WrongNumArgs(interp, 11, objv,
+                         "x trigVec val1 targVec val2 trigVecCond trigVecCondCount targVecCond targVecCondCount "
+                         "trigVecDelay targVecDelay");
+        return TCL_ERROR;
+    }
+    Tcl_Obj *xVec = objv[1];
+    Tcl_Obj *trigVec = objv[2];
+    double val1;
+    Tcl_GetDoubleFromObj(interp, objv[3], &val1);
+    Tcl_Obj *targVec = objv[4];
+    double val2;
+    Tcl_GetDoubleFromObj(interp, objv[5], &val2);
+    int trigVecCond;
+    if (!strcmp(Tcl_GetString(objv[6]), "rise")) {
+        trigVecCond = COND_RISE;
+    } else if (!strcmp(Tcl_GetString(objv[6]), "fall")) {
+        trigVecCond = COND_FALL;
+    } else {
+        trigVecCond = COND_CROSS;
+    }
+    Tcl_WideInt trigVecCondCount;
+    if (!strcmp(Tcl_GetString(objv[7]), "last")) {
+        trigVecCondCount = -1;
+    } else {
+        Tcl_GetWideIntFromObj(interp, objv[7], &trigVecCondCount);
+    }
+    int targVecCond;
+    if (!strcmp(Tcl_GetString(objv[8]), "rise")) {
+        targVecCond = COND_RISE;
+    } else if (!strcmp(Tcl_GetString(objv[8]), "fall")) {
+        targVecCond = COND_FALL;
+    } else {
+        targVecCond = COND_CROSS;
+    }
+    Tcl_WideInt targVecCondCount;
+    if (!strcmp(Tcl_GetString(objv[9]), "last")) {
+        targVecCondCount = -1;
+    } else {
+        Tcl_GetWideIntFromObj(interp, objv[9], &targVecCondCount);
+    }
+    double trigVecDelay;
+    Tcl_GetDoubleFromObj(interp, objv[10], &trigVecDelay);
+    double targVecDelay;
+    Tcl_GetDoubleFromObj(interp, objv[11], &targVecDelay);
+
+    Tcl_Size xLen;
+    const double *xVecElems;
+    const MeasGrid *xGrid;
+    MeasVector trig, targ;
+    if (GetMeasXElements(interp, configPtr, xVec, &xLen, &xVecElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorFromObj(interp, trigVec, &trig) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorFromObj(interp, targVec, &targ) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Size trigVecLen = trig.len, targVecLen = targ.len;
+    const double *trigVecElems = trig.data, *targVecElems = targ.data;
+    if (xLen != trigVecLen) {
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of trigVec '%ld'", xLen, trigVecLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (trigVecLen != targVecLen) {
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Length of trigVec '%ld' is not equal to length of targVec '%ld'", trigVecLen, targVecLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    /* the first segment of each search starts at or after its delay, x is increasing */
+    /* each search runs before the next GetCrossIndex(), which may replace its index when both use the same vector */
+    CrossSearch trigSearch = {trigVecElems, NULL, val1, trigVecCond, GetCrossIndex(configPtr, trig.repPtr, val1),
+                              GetKernel(configPtr)->crossMask};
+    Tcl_Size iTrig = FindCrossing(configPtr, &trigSearch, LowerBound(xVecElems, xGrid, 0, xLen, trigVecDelay), xLen - 1,
+                                  trigVecCondCount);
+    CrossSearch targSearch = {targVecElems, NULL, val2, targVecCond, GetCrossIndex(configPtr, targ.repPtr, val2),
+                              GetKernel(configPtr)->crossMask};
+    Tcl_Size iTarg = FindCrossing(configPtr, &targSearch, LowerBound(xVecElems, xGrid, 0, xLen, targVecDelay), xLen - 1,
+                                  targVecCondCount);
+    if (iTrig >= 0) {
+        trigVecFoundFlag = 1;
+        xTrig =
+            CalcXBetween(xVecElems[iTrig], trigVecElems[iTrig], xVecElems[iTrig + 1], trigVecElems[iTrig + 1], val1);
+    }
+    if (iTarg >= 0) {
+        targVecFoundFlag = 1;
+        xTarg =
+            CalcXBetween(xVecElems[iTarg], targVecElems[iTarg], xVecElems[iTarg + 1], targVecElems[iTarg + 1], val2);
+    }
+    if (!trigVecFoundFlag) {
+        const char *condition;
+        const char *vecCondCount;
+        switch ((enum Conditions)trigVecCond) {
+        case COND_RISE:
+            condition = "rise";
+            break;
+        case COND_FALL:
+            condition = "fall";
+            break;
+        case COND_CROSS:
+            condition = "cross";
+            break;
+        };
+        if (trigVecCondCount == -1) {
+            vecCondCount = "last";
+        } else {
+            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(trigVecCondCount));
+        }
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Trig value '%f' with conditions '%s %s delay=%f' was not found", val1,
+                                          condition, vecCondCount, trigVecDelay);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (!targVecFoundFlag) {
+        const char *condition;
+        const char *vecCondCount;
+        switch ((enum Conditions)targVecCond) {
+        case COND_RISE:
+            condition = "rise";
+            break;
+        case COND_FALL:
+            condition = "fall";
+            break;
+        case COND_CROSS:
+            condition = "cross";
+            break;
+        };
+        if (targVecCondCount == -1) {
+            vecCondCount = "last";
+        } else {
+            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(targVecCondCount));
+        }
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Targ value '%f' with conditions '%s %s delay=%f' was not found", val2,
+                                          condition, vecCondCount, targVecDelay);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    Tcl_Obj *result = Tcl_NewDictObj();
+    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtrig", -1), Tcl_NewDoubleObj(xTrig));
+    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtarg", -1), Tcl_NewDoubleObj(xTarg));
+    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xdelta", -1), Tcl_NewDoubleObj(xTarg - xTrig));
+    Tcl_SetObjResult(interp, result);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindDerivWhenCmdProc2 --
+ *
+ *      Implements a Tcl command to evaluate time-domain vector conditions (rise/fall/crossing) over one or more
+ *      time-aligned signals. Depending on the selected mode, it returns either the time (`xWhen`) of a matching
+ *      condition, the corresponding value from a secondary signal (`yFind`), or the derivative at the matched time.
+ *      The function supports flexible condition targeting via explicit index, "last", or "all" modes.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional user data (unused)
+ *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1]  = x              - list of X (time) values
+ *          objv[2]  = mode           - one of: when, wheneq, findwhen, findwheneq, derivwhen, derivwheneq
+ *          objv[3]  = findVec        - list of values used for yFind or derivative computations
+ *          objv[4]  = whenVecLS      - left-side comparison signal for condition detection
+ *          objv[5]  = val            - scalar threshold for single-vector comparisons
+ *          objv[6]  = whenVecRS      - right-side signal (used for equality/cross-vector mode)
+ *          objv[7]  = whenVecCond    - condition: "rise", "fall", or "cross"
+ *          objv[8]  = whenVecCondCount - index (1-based), "last", or "all" occurrence of condition to use
+ *          objv[9]  = delay          - minimum X before any condition is considered
+ *          objv[10] = from           - inclusive range start for evaluation, empty for the first x value
+ *          objv[11] = to             - inclusive range end for evaluation, empty for the last x value
+ *
+ * Results:
+ *      TCL_OK on success, with interpreter result set to:
+ *        - list of xWhen values       (mode: "when", "wheneq")
+ *        - list of interpolated yFind (mode: "findwhen", "findwheneq")
+ *        - list of derivatives        (mode: "derivwhen", "derivwheneq")
+ *
+ *      TCL_ERROR on failure (e.g. invalid arguments, mismatched vector lengths, no match found).
+ *
+ * Side Effects:
+ *      Allocates the result list on the first matching event.
+ *      Sets interpreter result to descriptive error messages if validation or detection fails.
+ *
+ * Notes:
+ *      - Matching is performed on (x, value) pairs from `whenVecLS` and optionally `whenVecRS`.
+ *      - Linear interpolation is used to find exact crossing points (`CalcXBetween`, `CalcCrossPoint`).
+ *      - Derivative estimation uses 3-point stencil via `DerivSelect()` and `Deriv()` with positional logic.
+ *      - Matching segments are found with FindCrossing(), "last" searches backwards from `to`, "all" collects every
+ *        matching segment with CollectCrossings(). Levels searched again on the same `whenVecLS` are looked up in its
+ *        crossing index (see GetCrossIndex()).
+ *      - For `wheneq`, a cross-condition between `whenVecLS` and `whenVecRS` is evaluated.
+ *      - Derivative results are aligned with crossing points and interpolated values.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int FindDerivWhenCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 12) {
+        Tcl_WrongNumArgs(interp, 11, objv,
+                         "x mode findVec whenVecLS val whenVecRS whenVecCond whenVecCondCount delay from to");
+        return TCL_ERROR;
+    }
+    Tcl_Obj *xVec = objv[1];
+    int mode;
+    if (Tcl_GetIndexFromObj(NULL, objv[2], FindDerivWhenSwitches, "mode", 0, &mode) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Obj *findVec = objv[3];
+    Tcl_Obj *whenVecLS = objv[4];
+    double val;
+    Tcl_GetDoubleFromObj(interp, objv[5], &val);
+    Tcl_Obj *whenVecRS = objv[6];
+    int whenVecCond;
+    if (!strcmp(Tcl_GetString(objv[7]), "rise")) {
+        whenVecCond = COND_RISE;
+    } else if (!strcmp(Tcl_GetString(objv[7]), "fall")) {
+        whenVecCond = COND_FALL;
+    } else {
+        whenVecCond = COND_CROSS;
+    }
+    Tcl_WideInt whenVecCondCount;
+    if (!strcmp(Tcl_GetString(objv[8]), "last")) {
+        whenVecCondCount = -1;
+    } else if (!strcmp(Tcl_GetString(objv[8]), "all")) {
+        whenVecCondCount = -2;
+    } else {
+        Tcl_GetWideIntFromObj(interp, objv[8], &whenVecCondCount);
+    }
+    double delay;
+    Tcl_GetDoubleFromObj(interp, objv[9], &delay);
+
+    Tcl_Size xLen, findVecLen, whenVecRSLen;
+    const double *xVecElems, *findVecElems, *whenVecRSElems;
+    const MeasGrid *xGrid;
+    MeasVector whenLS;
+    if (GetMeasXElements(interp, configPtr, xVec, &xLen, &xVecElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double from, to;
+    if (GetBoundFromObj(interp, objv[10], xVecElems, xLen, 0, &from) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[11], xVecElems, xLen, 1, &to) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, findVec, &findVecLen, &findVecElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorFromObj(interp, whenVecLS, &whenLS) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Size whenVecLSLen = whenLS.len;
+    const double *whenVecLSElems = whenLS.data;
+    if (GetMeasVectorElements(interp, whenVecRS, &whenVecRSLen, &whenVecRSElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    int eqMode = (mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHENEQ) || (mode == FDW_SWITCH_DERIVWHENEQ);
+    int findMode = (mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_FINDWHENEQ);
+    int derivMode = (mode == FDW_SWITCH_DERIVWHEN) || (mode == FDW_SWITCH_DERIVWHENEQ);
+    if (xLen != whenVecLSLen) {
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of whenVecLS '%ld'", xLen, whenVecLSLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    if (eqMode) {
+        if (xLen != whenVecRSLen) {
+            Tcl_Obj *errorMsg =
+                Tcl_ObjPrintf("Length of x '%ld' is not equal to length of whenVecRS '%ld'", xLen, whenVecRSLen);
+            Tcl_SetObjResult(interp, errorMsg);
+            return TCL_ERROR;
+        }
+    }
+    if (findMode || derivMode) {
+        if (xLen != findVecLen) {
+            Tcl_Obj *errorMsg =
+                Tcl_ObjPrintf("Length of x '%ld' is not equal to length of findVec '%ld'", xLen, findVecLen);
+            Tcl_SetObjResult(interp, errorMsg);
+            return TCL_ERROR;
+        }
+    }
+    /* segments start at or after from+delay and not after to, x is increasing */
+    Tcl_Size iFrom = LowerBound(xVecElems, xGrid, 0, xLen, from + delay);
+    Tcl_Size iEnd = LowerBound(xVecElems, xGrid, iFrom, xLen, to);
+    while ((iEnd < xLen) && (xVecElems[iEnd] <= to)) {
+        iEnd++;
+    }
+    if (iEnd > xLen - 1) {
+        iEnd = xLen - 1;
+    }
+    CrossSearch search = {whenVecLSElems, eqMode ? whenVecRSElems : NULL, val, whenVecCond,
+                          eqMode ? NULL : GetCrossIndex(configPtr, whenLS.repPtr, val),
+                          GetKernel(configPtr)->crossMask};
+    Tcl_Obj *resultObj = NULL;
+    Tcl_Size hitCount = 0;
+    Tcl_Size hit, *hits = &hit;
+    double *values = NULL;
+    if (whenVecCondCount == -2) {
+        hits = CollectCrossings(configPtr, &search, iFrom, iEnd, &hitCount);
+        if (configPtr->binary && (hitCount > 0)) {
+            values = (double *)Tcl_Alloc(sizeof(double) * hitCount);
+        }
+    } else {
+        hit = FindCrossing(configPtr, &search, iFrom, iEnd, whenVecCondCount);
+        hitCount = (hit >= 0) ? 1 : 0;
+    }
+    for (Tcl_Size h = 0; h < hitCount; ++h) {
+        Tcl_Size i = hits[h];
+        double xi = xVecElems[i];
+        double xip1 = xVecElems[i + 1];
+        double xWhen, value;
+        if (eqMode) {
+            xWhen = CalcCrossPoint(xi, whenVecLSElems[i], xip1, whenVecLSElems[i + 1], xi, whenVecRSElems[i], xip1,
+                                   whenVecRSElems[i + 1]);
+        } else {
+            xWhen = CalcXBetween(xi, whenVecLSElems[i], xip1, whenVecLSElems[i + 1], val);
+        }
+        if (findMode || derivMode) {
+            value = FindDerivValue(xVecElems, xLen, findVecElems, i, xWhen, derivMode);
+        } else {
+            value = xWhen;
+        }
+        if (values != NULL) {
+            values[h] = value;
+            continue;
+        }
+        if (resultObj == NULL) {
+            resultObj = Tcl_NewListObj(hitCount, NULL);
+        }
+        Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewDoubleObj(value));
+    }
+    if (values != NULL) {
+        resultObj = NewMeasVectorObj(configPtr, values, hitCount);
+    }
+    if (hits != &hit) {
+        Tcl_Free((char *)hits);
+    }
+    if (!eqMode && (resultObj == NULL)) {
+        const char *condition;
+        const char *vecCondCount;
+        switch ((enum Conditions)whenVecCond) {
+        case COND_RISE:
+            condition = "rise";
+            break;
+        case COND_FALL:
+            condition = "fall";
+            break;
+        case COND_CROSS:
+            condition = "cross";
+            break;
+        };
+        if (whenVecCondCount == -2) {
+            vecCondCount = "all";
+        } else if (whenVecCondCount == -1) {
+            vecCondCount = "last";
+        } else {
+            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(whenVecCondCount));
+        }
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("When value '%f' with conditions '%s %s delay=%f from=%f to=%f' was not found", val,
+                          condition, vecCondCount, delay, from, to);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (resultObj == NULL) {
+        const char *condition;
+        const char *vecCondCount;
+        switch ((enum Conditions)whenVecCond) {
+        case COND_RISE:
+            condition = "rise";
+            break;
+        case COND_FALL:
+            condition = "fall";
+            break;
+        case COND_CROSS:
+            condition = "cross";
+            break;
+        };
+        if (whenVecCondCount == -2) {
+            vecCondCount = "all";
+        } else if (whenVecCondCount == -1) {
+            vecCondCount = "last";
+        } else {
+            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(whenVecCondCount));
+        }
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Cross between vectors with conditions '%s %s delay=%f from=%f to=%f' was not found",
+                          condition, vecCondCount, delay, from, to);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetLevelsFromObj --
+ *
+ *      Converts the list of levels of a multi-level crossing search into the searches of FindLevels().
+ *
+ * Parameters:
+ *      Tcl_Interp *interp            - input/output: interpreter for error reporting
+ *      const MeasConfig *configPtr   - input: settings of the interpreter, selects the crossing mask kernel
+ *      Tcl_Obj *objPtr               - input: non-empty list of levels
+ *      const double *y               - input: values of the searched vector
+ *      int cond                      - input: kind of crossing, one of enum Conditions
+ *      int *levelsPtr                - output: number of levels
+ *
+ * Results:
+ *      Search of each level allocated with Tcl_Alloc, or NULL with an error message in the interpreter if the list is
+ *      empty or a level is not a number
+ *
+ * Side Effects:
+ *      The caller frees the result with Tcl_Free
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static CrossSearch *GetLevelsFromObj(Tcl_Interp *interp, const MeasConfig *configPtr, Tcl_Obj *objPtr,
+                                     const double *y, int cond, int *levelsPtr) {
+    Tcl_Size levels;
+    Tcl_Obj **levelObjs;
+    if (Tcl_ListObjGetElements(interp, objPtr, &levels, &levelObjs) != TCL_OK) {
+        return NULL;
+    }
+    if (levels == 0) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj("List of levels is empty", -1));
+        return NULL;
+    }
+    CrossSearch *searches = (CrossSearch *)Tcl_Alloc(sizeof(CrossSearch) * levels);
+    for (Tcl_Size l = 0; l < levels; ++l) {
+        searches[l].y = y;
+        searches[l].y2 = NULL;
+        searches[l].cond = cond;
+        searches[l].indexPtr = NULL;
+        searches[l].crossMask = GetKernel(configPtr)->crossMask;
+        if (Tcl_GetDoubleFromObj(interp, levelObjs[l], &searches[l].val) != TCL_OK) {
+            Tcl_Free((char *)searches);
+            return NULL;
+        }
+    }
+    *levelsPtr = (int)levels;
+    return searches;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetCondFromObjs --
+ *
+ *      Converts the condition and the count of a multi-level crossing search.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp            - input/output: interpreter for error reporting
+ *      Tcl_Obj *condObj              - input: "rise", "fall" or "cross"
+ *      Tcl_Obj *countObj             - input: 1-based number of the crossing, or "last"
+ *      int *condPtr                  - output: one of enum Conditions
+ *      Tcl_WideInt *countPtr         - output: number of the crossing, -1 for "last"
+ *
+ * Results:
+ *      TCL_OK, or TCL_ERROR with an error message in the interpreter
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetCondFromObjs(Tcl_Interp *interp, Tcl_Obj *condObj, Tcl_Obj *countObj, int *condPtr,
+                           Tcl_WideInt *countPtr) {
+    static const char *const conditions[] = {"rise", "fall", "cross", NULL};
+    if (Tcl_GetIndexFromObjStruct(interp, condObj, conditions, sizeof(char *), "condition", TCL_EXACT, condPtr) !=
+        TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (!strcmp(Tcl_GetString(countObj), "last")) {
+        *countPtr = -1;
+        return TCL_OK;
+    }
+    return Tcl_GetWideIntFromObj(interp, countObj, countPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * WhenLevelsCmdProc2 --
+ *
+ *      Implements `::tclmeasure::WhenLevels x mode findVec whenVec vals whenVecCond whenVecCondCount delay from to`,
+ *      the Find-When, Deriv-When or When measurement of several levels of the same vector, done with a single pass
+ *      over the data by FindLevels().
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1]  = x              - list of X (time) values
+ *          objv[2]  = mode           - one of: when, findwhen, derivwhen
+ *          objv[3]  = findVec        - list of values used for yFind or derivative computations, unused for when
+ *          objv[4]  = whenVec        - signal that crosses the levels
+ *          objv[5]  = vals           - list of the levels
+ *          objv[6]  = whenVecCond    - condition: "rise", "fall", or "cross"
+ *          objv[7]  = whenVecCondCount - index (1-based) or "last" occurrence of condition to use
+ *          objv[8]  = delay          - minimum X before any condition is considered
+ *          objv[9]  = from           - inclusive range start for evaluation, empty for the first x value
+ *          objv[10] = to             - inclusive range end for evaluation, empty for the last x value
+ *
+ * Results:
+ *      TCL_OK with the list of xWhen, yFind or derivative values in the interpreter result, one for each level in the
+ *      order of `vals`.
+ *      TCL_ERROR on invalid arguments or mismatched lengths, or if a level is not crossed, with the message
+ *      FindDerivWhenCmdProc2 gives for the first such level.
+ *
+ * Side Effects:
+ *      None.
+ *
+ * Notes:
+ *      Each level gets the value FindDerivWhenCmdProc2 returns for it alone in the same mode.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int WhenLevelsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    static const char *const modes[] = {"when", "findwhen", "derivwhen", NULL};
+    enum LevelModes { LEVELS_WHEN, LEVELS_FINDWHEN, LEVELS_DERIVWHEN };
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 11) {
+        Tcl_WrongNumArgs(interp, 1, objv, "x mode findVec whenVec vals whenVecCond whenVecCondCount delay from to");
+        return TCL_ERROR;
+    }
+    int mode, cond;
+    Tcl_WideInt count;
+    double delay;
+    if (Tcl_GetIndexFromObjStruct(interp, objv[2], modes, sizeof(char *), "mode", TCL_EXACT, &mode) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetCondFromObjs(interp, objv[6], objv[7], &cond, &count) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (Tcl_GetDoubleFromObj(interp, objv[8], &delay) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, whenLen, findLen = 0;
+    const double *xElems, *whenElems, *findElems = NULL;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double from, to;
+    if (GetBoundFromObj(interp, objv[9], xElems, xLen, 0, &from) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[10], xElems, xLen, 1, &to) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, objv[4], &whenLen, &whenElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (xLen != whenLen) {
+        Tcl_SetObjResult(interp,
+                         Tcl_ObjPrintf("Length of x '%ld' is not equal to length of whenVec '%ld'", xLen, whenLen));
+        return TCL_ERROR;
+    }
+    if (mode != LEVELS_WHEN) {
+        if (GetMeasVectorElements(interp, objv[3], &findLen, &findElems) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (xLen != findLen) {
+            Tcl_SetObjResult(interp,
+                             Tcl_ObjPrintf("Length of x '%ld' is not equal to length of findVec '%ld'", xLen, findLen));
+            return TCL_ERROR;
+        }
+    }
+    int levels;
+    CrossSearch *searches = GetLevelsFromObj(interp, configPtr, objv[5], whenElems, cond, &levels);
+    if (searches == NULL) {
+        return TCL_ERROR;
+    }
+    /* the same segments as FindDerivWhenCmdProc2: at or after from+delay and not after to */
+    Tcl_Size iFrom = LowerBound(xElems, xGrid, 0, xLen, from + delay);
+    Tcl_Size iEnd = LowerBound(xElems, xGrid, iFrom, xLen, to);
+    while ((iEnd < xLen) && (xElems[iEnd] <= to)) {
+        iEnd++;
+    }
+    if (iEnd > xLen - 1) {
+        iEnd = xLen - 1;
+    }
+    Tcl_Size *hits = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * levels);
+    FindLevels(configPtr, searches, levels, iFrom, iEnd, count, hits);
+    Tcl_Obj *resultObj = Tcl_NewListObj(levels, NULL);
+    for (int l = 0; l < levels; ++l) {
+        Tcl_Size i = hits[l];
+        double val = searches[l].val;
+        if (i < 0) {
+            Tcl_DecrRefCount(resultObj);
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("When value '%f' with conditions '%s %s delay=%f from=%f to=%f' "
+                                                   "was not found",
+                                                   val, Tcl_GetString(objv[6]), Tcl_GetString(objv[7]), delay,
+                                                   from, to));
+            Tcl_Free((char *)hits);
+            Tcl_Free((char *)searches);
+            return TCL_ERROR;
+        }
+        double value = CalcXBetween(xElems[i], whenElems[i], xElems[i + 1], whenElems[i + 1], val);
+        if (mode != LEVELS_WHEN) {
+            value = FindDerivValue(xElems, xLen, findElems, i, value, mode == LEVELS_DERIVWHEN);
+        }
+        Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewDoubleObj(value));
+    }
+    Tcl_Free((char *)hits);
+    Tcl_Free((char *)searches);
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * TrigTargLevelsCmdProc2 --
+ *
+ *      Implements `::tclmeasure::TrigTargLevels x trigVec vals1 targVec vals2 trigVecCond trigVecCondCount targVecCond
+ *      targVecCondCount trigVecDelay targVecDelay`, the Trigger-Target measurement of several pairs of levels, as
+ *      rise and fall times between 10% and 90% or delays at several levels. The trigger levels and the target levels
+ *      are each found with a single pass over the data by FindLevels().
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: arguments of TrigTargCmdProc2, except that vals1 and vals2 are lists of
+ *                                      levels; a list of a single level is paired with every level of the other one,
+ *                                      longer lists must have the same length and are paired by position
+ *
+ * Results:
+ *      TCL_OK with the list of the dictionaries TrigTargCmdProc2 returns, one for each pair of levels.
+ *      TCL_ERROR on invalid arguments, mismatched lengths or a level that is not crossed, with the messages of
+ *      TrigTargCmdProc2 for the first such level.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int TrigTargLevelsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 12) {
+        Tcl_WrongNumArgs(interp, 1, objv,
+                         "x trigVec vals1 targVec vals2 trigVecCond trigVecCondCount targVecCond targVecCondCount "
+                         "trigVecDelay targVecDelay");
+        return TCL_ERROR;
+    }
+    int conds[2];
+    Tcl_WideInt counts[2];
+    double delays[2];
+    for (int k = 0; k < 2; ++k) {
+        if (GetCondFromObjs(interp, objv[6 + 2 * k], objv[7 + 2 * k], &conds[k], &counts[k]) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (Tcl_GetDoubleFromObj(interp, objv[10 + k], &delays[k]) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    }
+    Tcl_Size xLen;
+    const double *xElems;
+    const MeasGrid *xGrid;
+    MeasVector vecs[2];
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if ((GetMeasVectorFromObj(interp, objv[2], &vecs[0]) != TCL_OK) ||
+        (GetMeasVectorFromObj(interp, objv[4], &vecs[1]) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+    if (xLen != vecs[0].len) {
+        Tcl_SetObjResult(interp,
+                         Tcl_ObjPrintf("Length of x '%ld' is not equal to length of trigVec '%ld'", xLen, vecs[0].len));
+        return TCL_ERROR;
+    } else if (vecs[0].len != vecs[1].len) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Length of trigVec '%ld' is not equal to length of targVec '%ld'",
+                                               vecs[0].len, vecs[1].len));
+        return TCL_ERROR;
+    }
+    int levels[2];
+    CrossSearch *searches[2];
+    searches[0] = GetLevelsFromObj(interp, configPtr, objv[3], vecs[0].data, conds[0], &levels[0]);
+    if (searches[0] == NULL) {
+        return TCL_ERROR;
+    }
+    searches[1] = GetLevelsFromObj(interp, configPtr, objv[5], vecs[1].data, conds[1], &levels[1]);
+    if (searches[1] == NULL) {
+        Tcl_Free((char *)searches[0]);
+        return TCL_ERROR;
+    }
+    int pairs = (levels[0] > levels[1]) ? levels[0] : levels[1];
+    if ((levels[0] != levels[1]) && (levels[0] != 1) && (levels[1] != 1)) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Number of trig levels '%d' is not equal to number of targ levels '%d'",
+                                               levels[0], levels[1]));
+        Tcl_Free((char *)searches[0]);
+        Tcl_Free((char *)searches[1]);
+        return TCL_ERROR;
+    }
+    Tcl_Size *hits[2];
+    double *xs[2];
+    int missing[2] = {-1, -1};
+    for (int k = 0; k < 2; ++k) {
+        /* the first segment of each search starts at or after its delay, as in TrigTargCmdProc2 */
+        hits[k] = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * levels[k]);
+        xs[k] = (double *)Tcl_Alloc(sizeof(double) * levels[k]);
+        FindLevels(configPtr, searches[k], levels[k], LowerBound(xElems, xGrid, 0, xLen, delays[k]), xLen - 1,
+                   counts[k], hits[k]);
+        for (int l = 0; l < levels[k]; ++l) {
+            Tcl_Size i = hits[k][l];
+            if (i < 0) {
+                if (missing[k] < 0) {
+                    missing[k] = l;
+                }
+                continue;
+            }
+            const double *y = vecs[k].data;
+            xs[k][l] = CalcXBetween(xElems[i], y[i], xElems[i + 1], y[i + 1], searches[k][l].val);
+        }
+    }
+    int code = TCL_OK;
+    if ((missing[0] >= 0) || (missing[1] >= 0)) {
+        int k = (missing[0] >= 0) ? 0 : 1;
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s value '%f' with conditions '%s %s delay=%f' was not found",
+                                               (k == 0) ? "Trig" : "Targ", searches[k][missing[k]].val,
+                                               Tcl_GetString(objv[6 + 2 * k]), Tcl_GetString(objv[7 + 2 * k]),
+                                               delays[k]));
+        code = TCL_ERROR;
+    } else {
+        Tcl_Obj *resultObj = Tcl_NewListObj(pairs, NULL);
+        for (int p = 0; p < pairs; ++p) {
+            double xTrig = xs[0][(levels[0] == 1) ? 0 : p];
+            double xTarg = xs[1][(levels[1] == 1) ? 0 : p];
+            Tcl_Obj *pairObj = Tcl_NewDictObj();
+            Tcl_DictObjPut(NULL, pairObj, Tcl_NewStringObj("xtrig", -1), Tcl_NewDoubleObj(xTrig));
+            Tcl_DictObjPut(NULL, pairObj, Tcl_NewStringObj("xtarg", -1), Tcl_NewDoubleObj(xTarg));
+            Tcl_DictObjPut(NULL, pairObj, Tcl_NewStringObj("xdelta", -1), Tcl_NewDoubleObj(xTarg - xTrig));
+            Tcl_ListObjAppendElement(NULL, resultObj, pairObj);
+        }
+        Tcl_SetObjResult(interp, resultObj);
+    }
+    for (int k = 0; k < 2; ++k) {
+        Tcl_Free((char *)searches[k]);
+        Tcl_Free((char *)hits[k]);
+        Tcl_Free((char *)xs[k]);
+    }
+    return code;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindAtCmdProc2 --
+ *
+ *      Implements a Tcl command that performs linear interpolation on a time-aligned signal. Given a scalar X value,
+ *      this command scans a sequence of (x, y) points and returns the interpolated Y value at the specified X.
+ *      The interpolation uses the segment between two bounding X values that bracket the input X.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional user data (unused)
+ *      Tcl_Interp *interp            - input/output: interpreter used for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X (time) values
+ *          objv[2] = val      - scalar X value to look up
+ *          objv[3] = findVec  - list of Y values aligned with `x`
+ *
+ * Results:
+ *      TCL_OK if `val` is within a segment in `x`; the corresponding interpolated Y value is returned via interpreter.
+ *      TCL_ERROR if:
+ *          - the number of arguments is invalid,
+ *          - any list parsing fails,
+ *          - list lengths mismatch,
+ *          - `val` lies outside all segment ranges in `x`
+ *
+ * Side Effects:
+ *      Sets interpreter result to the computed Y value or an error message on failure.
+ *
+ * Notes:
+ *      - The function assumes `x` is sorted in ascending order, the segment is found with binary search.
+ *      - Only the first matching segment where `xi <= val <= xi+1` is used.
+ *      - Uses `CalcYBetween` to interpolate linearly between two Y values.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int FindAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    if (objc != 4) {
+        Tcl_WrongNumArgs(interp, 3, objv, "x val findVec");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, findVecLen;
+    const double *xVecElems, *findVecElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, (MeasConfig *)clientData, objv[1], &xLen, &xVecElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double val;
+    Tcl_GetDoubleFromObj(interp, objv[2], &val);
+    if (GetMeasVectorElements(interp, objv[3], &findVecLen, &findVecElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (xLen != findVecLen) {
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of findVec '%ld'", xLen, findVecLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    double yFind;
+    int foundFlag = 0;
+    Tcl_Size i = FindSegment(xVecElems, xGrid, xLen, val, 0);
+    if (i >= 0) {
+        yFind = CalcYBetween(xVecElems[i], findVecElems[i], xVecElems[i + 1], findVecElems[i + 1], val);
+        foundFlag = 1;
+    }
+    if (!foundFlag) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Value of the vector at '%f' was not found", val);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else {
+        Tcl_SetObjResult(interp, Tcl_NewDoubleObj(yFind));
+        return TCL_OK;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * DerivAtCmdProc2 --
+ *
+ *      Implements a Tcl command that computes the numerical derivative of a signal vector at a specified X position.
+ *      The derivative is estimated using a 3-point stencil around the interpolation point. The function searches for
+ *      a segment [xi, xi+1] that brackets the given value and uses neighboring data (when available) for accuracy.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional user data (unused)
+ *      Tcl_Interp *interp            - input/output: interpreter for result or error message
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x           - list of X (independent) values
+ *          objv[2] = val         - scalar X value where derivative should be evaluated
+ *          objv[3] = derivVec    - list of Y (dependent) values aligned with `x`
+ *
+ * Results:
+ *      TCL_OK on success, with interpreter result set to a double representing the estimated derivative.
+ *      TCL_ERROR on:
+ *          - wrong number of arguments,
+ *          - list extraction failure,
+ *          - mismatched vector lengths,
+ *          - val lying outside the data range
+ *
+ * Side Effects:
+ *      Uses `DerivSelect()` to extract the proper 3-point stencil and compute the interpolated derivative using `Deriv()`.
+ *      Sets the interpreter result to either a floating-point derivative or a descriptive error message.
+ *
+ * Notes:
+ *      - The segment that brackets `val` is found with binary search, `x` must be increasing.
+ *      - Linear interpolation is used to estimate the Y value at `val`, then finite-difference is applied.
+ *      - The method adapts to edges (beginning or end of the dataset) using forward/backward biased stencils.
+ *      - Requires at least 3 points in `x` and `derivVec` to compute valid derivatives.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int DerivAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    if (objc != 4) {
+        Tcl_WrongNumArgs(interp, 3, objv, "x val derivVec");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, derivVecLen;
+    const double *xVecElems, *derivVecElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, (MeasConfig *)clientData, objv[1], &xLen, &xVecElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double val;
+    Tcl_GetDoubleFromObj(interp, objv[2], &val);
+    if (GetMeasVectorElements(interp, objv[3], &derivVecLen, &derivVecElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (xLen != derivVecLen) {
+        Tcl_Obj *errorMsg =
+            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of derivVec '%ld'", xLen, derivVecLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    double yDeriv, derY;
+    int foundFlag = 0;
+    Tcl_Size i = FindSegment(xVecElems, xGrid, xLen, val, 0);
+    if (i >= 0) {
+        double xi = xVecElems[i];
+        double xip1 = xVecElems[i + 1];
+        double derivDataTemp[6];
+        int derivPosTemp;
+        yDeriv = CalcYBetween(xi, derivVecElems[i], xip1, derivVecElems[i + 1], val);
+        DerivSelect(i, xi, val, xip1, xLen, xVecElems, derivVecElems, yDeriv, derivDataTemp, &derivPosTemp);
+        derY = Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2], derivDataTemp[3], derivDataTemp[4],
+                     derivDataTemp[5], derivPosTemp);
+        foundFlag = 1;
+    }
+    if (!foundFlag) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Derivative of the vector at '%f' was not found", val);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else {
+        Tcl_SetObjResult(interp, Tcl_NewDoubleObj(derY));
+        return TCL_OK;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * IntegSegments --
+ *
+ *      Validates an integration interval against the x vector and locates the segments that contain its ends.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp            - input/output: interpreter for error reporting
+ *      const double *x               - input: strictly increasing x values
+ *      const MeasGrid *gridPtr       - input: uniform grid of the x values, NULL if they are not on one
+ *      Tcl_Size len                  - input: number of x values
+ *      double xstart                 - input: start of the interval
+ *      double xend                   - input: end of the interval
+ *      Tcl_Size *istartPtr           - output: index of the segment that contains `xstart`
+ *      Tcl_Size *iendPtr             - output: index of the segment that contains `xend`
+ *
+ * Results:
+ *      TCL_OK if both segments were found, TCL_ERROR otherwise with an error message in the interpreter result.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int IntegSegments(Tcl_Interp *interp, const double *x, const MeasGrid *gridPtr, Tcl_Size len, double xstart,
+                         double xend, Tcl_Size *istartPtr, Tcl_Size *iendPtr) {
+    if (xstart < x[0]) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Start of integration interval '%f' is outside the x values range", xstart);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (xend > x[len - 1]) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("End of integration interval '%f' is outside the x values range", xend);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (xstart >= xend) {
+        Tcl_SetObjResult(
+            interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the integration", -1));
+        return TCL_ERROR;
+    }
+    Tcl_Size istart = FindSegment(x, gridPtr, len, xstart, 0);
+    Tcl_Size iend = FindSegment(x, gridPtr, len, xend, istart);
+    if ((istart < 0) || (iend < 0)) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj("Integration interval was not found in the x values", -1));
+        return TCL_ERROR;
+    }
+    *istartPtr = istart;
+    *iendPtr = iend;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetCumIntegral --
+ *
+ *      Gets the cumulative integrals of a y vector over an x vector when `-cumulative` is enabled, building them on
+ *      the first use of the pair. They are cached in the representation of y and rebuilt when y is integrated over
+ *      another x vector.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr   - input: settings of the interpreter
+ *      Tcl_Obj *xObj                 - input: x vector, already converted by GetMeasXElements()
+ *      Tcl_Obj *yObj                 - input: y vector of the same length, already converted by GetMeasVectorElements()
+ *
+ * Results:
+ *      Cumulative integrals, or NULL if `-cumulative` is disabled
+ *
+ * Side Effects:
+ *      May allocate the cumulative integrals of y and free the previous ones
+ *
+ * Notes:
+ *      The segment terms are the ones ScanRange() sums, accumulated with compensated summation, so every entry is
+ *      within one rounding of the exact prefix sum. The integral over a window is a difference of two entries, its
+ *      absolute error is a few roundings of the cumulative integral at the end of the window, rather than of the
+ *      window integral itself.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static const CumIntegral *GetCumIntegral(const MeasConfig *configPtr, Tcl_Obj *xObj, Tcl_Obj *yObj) {
+    if (!configPtr->cumulative) {
+        return NULL;
+    }
+    const Tcl_ObjInternalRep *xIrPtr = Tcl_FetchInternalRep(xObj, &measVectorType);
+    const Tcl_ObjInternalRep *yIrPtr = Tcl_FetchInternalRep(yObj, &measVectorType);
+    if ((xIrPtr == NULL) || (yIrPtr == NULL)) {
+        return NULL;
+    }
+    const MeasVectorRep *xRepPtr = (const MeasVectorRep *)xIrPtr->twoPtrValue.ptr1;
+    MeasVectorRep *yRepPtr = (MeasVectorRep *)yIrPtr->twoPtrValue.ptr1;
+    CumIntegral *cumPtr = yRepPtr->cumPtr;
+    if ((cumPtr != NULL) && (cumPtr->xId == xRepPtr->id)) {
+        return cumPtr;
+    }
+    if (cumPtr == NULL) {
+        cumPtr = (CumIntegral *)Tcl_Alloc(sizeof(CumIntegral));
+        yRepPtr->cumPtr = cumPtr;
+    } else {
+        Tcl_Free((char *)cumPtr->sum);
+        Tcl_Free((char *)cumPtr->sumSq);
+    }
+    const double *x = xRepPtr->data, *y = yRepPtr->data;
+    Tcl_Size len = yRepPtr->len;
+    cumPtr->xId = xRepPtr->id;
+    cumPtr->sum = (double *)Tcl_Alloc(sizeof(double) * (len > 0 ? len : 1));
+    cumPtr->sumSq = (double *)Tcl_Alloc(sizeof(double) * (len > 0 ? len : 1));
+    cumPtr->sum[0] = cumPtr->sumSq[0] = 0.0;
+    double sum = 0.0, comp = 0.0, sumSq = 0.0, compSq = 0.0;
+    for (Tcl_Size i = 0; i + 1 < len; ++i) {
+        double y0 = y[i], y1 = y[i + 1];
+        double dx = x[i + 1] - x[i];
+        double term = (y0 + y1) * dx, termSq = (y0 * y0 + y1 * y1) * dx;
+        /* Neumaier summation, keeps the low order bits lost by each addition in comp */
+        double t = sum + term;
+        comp += (fabs(sum) >= fabs(term)) ? ((sum - t) + term) : ((term - t) + sum);
+        sum = t;
+        t = sumSq + termSq;
+        compSq += (fabs(sumSq) >= fabs(termSq)) ? ((sumSq - t) + termSq) : ((termSq - t) + sumSq);
+        sumSq = t;
+        cumPtr->sum[i + 1] = sum + comp;
+        cumPtr->sumSq[i + 1] = sumSq + compSq;
+    }
+    return cumPtr;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * IntegTrapz --
+ *
+ *      Integrates y (or y squared) over [xstart, xend] with the trapezoidal rule in a single pass over the samples.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr   - input: settings of the interpreter
+ *      const CumIntegral *cumPtr     - input: cumulative integrals of y from GetCumIntegral(), NULL to sum the samples
+ *      const double *x               - input: strictly increasing x values
+ *      const double *y               - input: y values, same length as `x`
+ *      Tcl_Size istart               - input: segment that contains `xstart`, as returned by IntegSegments()
+ *      Tcl_Size iend                 - input: segment that contains `xend`, as returned by IntegSegments()
+ *      double xstart                 - input: start of the interval
+ *      double xend                   - input: end of the interval
+ *      int squared                   - input: if non-zero, integrate y*y instead of y
+ *
+ * Results:
+ *      Value of the integral.
+ *
+ * Side Effects:
+ *      None.
+ *
+ * Notes:
+ *      When `squared` is set the values at `xstart` and `xend` are interpolated linearly between the squared samples,
+ *      which is what integrating a squared copy of the vector would give, so no temporary vector is needed.
+ *      The segments between the end segments are summed by ScanRange(), or taken as a difference of cumulative
+ *      integrals, WindowStats() does the same so both give bit-identical integrals.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static double IntegTrapz(const MeasConfig *configPtr, const CumIntegral *cumPtr, const double *x, const double *y,
+                         Tcl_Size istart, Tcl_Size iend, double xstart, double xend, int squared) {
+    double yis = y[istart], yisp1 = y[istart + 1];
+    double yie = y[iend], yiep1 = y[iend + 1];
+    if (squared) {
+        yis *= yis;
+        yisp1 *= yisp1;
+        yie *= yie;
+        yiep1 *= yiep1;
+    }
+    double ystart = CalcYBetween(x[istart], yis, x[istart + 1], yisp1, xstart);
+    double yend = CalcYBetween(x[iend], yie, x[iend + 1], yiep1, xend);
+    if (istart == iend) {
+        return (yend + ystart) / 2.0 * (xend - xstart);
+    }
+    RangeScan scan;
+    if (cumPtr != NULL) {
+        scan.sum = cumPtr->sum[iend] - cumPtr->sum[istart + 1];
+        scan.sumSq = fmax(cumPtr->sumSq[iend] - cumPtr->sumSq[istart + 1], 0.0);
+    } else {
+        ScanRange(configPtr, x, y, istart + 1, iend, SCAN_SUMS, &scan);
+    }
+    double result = (yisp1 + ystart) / 2.0 * (x[istart + 1] - xstart);
+    result = result + (squared ? scan.sumSq : scan.sum) / 2.0;
+    return result + (yend + yie) / 2.0 * (xend - x[iend]);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * IntegCmdProc2 --
+ *
+ *      Implements a Tcl command that numerically integrates a Y vector over a given interval in X using the trapezoidal
+ *      rule. Supports optional output of cumulative integral values over the integration domain.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional user data (unused)
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X values (time domain)
+ *          objv[2] = y        - list of Y values (to integrate over X)
+ *          objv[3] = xstart   - start of the integration interval (must lie within `x`), empty for the first x value
+ *          objv[4] = xend     - end of the integration interval (must lie within `x`), empty for the last x value
+ *          objv[5] = cum      - boolean flag; if true, return cumulative integral series as dict with "x" and "y" keys
+ *
+ * Results:
+ *      TCL_OK on success:
+ *          - If `cum` is false: interpreter result is the total integral (double)
+ *          - If `cum` is true: result is a dict with keys:
+ *              "x" => list of X values from the integration path
+ *              "y" => list of cumulative integral values
+ *
+ *      TCL_ERROR on:
+ *          - invalid argument count
+ *          - non-numeric or non-list inputs
+ *          - mismatched lengths between `x` and `y`
+ *          - `xstart`/`xend` outside the `x` domain
+ *          - `xstart >= xend`
+ *
+ * Side Effects:
+ *      Finds the segments that contain `xstart` and `xend` with binary search.
+ *      Uses `CalcYBetween()` to interpolate values at exact `xstart` and `xend` positions for accurate integration.
+ *      Accumulates the integral using trapezoidal rule:
+ *          ∫(a to b) y dx ≈ Σ [(yi + yi+1)/2] * (xi+1 - xi)
+ *      When `cum` is enabled, fills packed arrays of the known length for the cumulative output and returns them as
+ *      vectors (see NewMeasVectorObj()).
+ *
+ * Notes:
+ *      - Assumes `x` is monotonically increasing.
+ *      - All interpolation and accumulation is performed in double precision.
+ *      - Caller is responsible for ensuring signal alignment and sampling accuracy.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int IntegCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 6) {
+        Tcl_WrongNumArgs(interp, 5, objv, "x y xstart xend cum");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, yLen;
+    const double *xElems, *yElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, objv[2], &yLen, &yElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double xstart, xend;
+    if (GetBoundFromObj(interp, objv[3], xElems, xLen, 0, &xstart) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[4], xElems, xLen, 1, &xend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    int cumFlag;
+    Tcl_GetBooleanFromObj(interp, objv[5], &cumFlag);
+    if (xLen != yLen) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    Tcl_Size istart, iend;
+    if (IntegSegments(interp, xElems, xGrid, xLen, xstart, xend, &istart, &iend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (!cumFlag) {
+        const CumIntegral *cumPtr = GetCumIntegral(configPtr, objv[1], objv[2]);
+        Tcl_SetObjResult(
+            interp, Tcl_NewDoubleObj(IntegTrapz(configPtr, cumPtr, xElems, yElems, istart, iend, xstart, xend, 0)));
+        return TCL_OK;
+    }
+    Tcl_Size count = (istart == iend) ? 2 : iend - istart + 1;
+    double *xCum = (double *)Tcl_Alloc(sizeof(double) * count);
+    double *yCum = (double *)Tcl_Alloc(sizeof(double) * count);
+    double ystart = CalcYBetween(xElems[istart], yElems[istart], xElems[istart + 1], yElems[istart + 1], xstart);
+    double yend = CalcYBetween(xElems[iend], yElems[iend], xElems[iend + 1], yElems[iend + 1], xend);
+    double result = 0.0;
+    Tcl_Size k = 0;
+    if (istart == iend) {
+        result = (yend + ystart) / 2.0 * (xend - xstart);
+        xCum[k] = xstart;
+        yCum[k++] = result;
+    } else {
+        result = (yElems[istart + 1] + ystart) / 2.0 * (xElems[istart + 1] - xstart);
+        xCum[k] = xstart;
+        yCum[k++] = result;
+        for (Tcl_Size i = istart + 1; i < iend; ++i) {
+            result = result + (yElems[i + 1] + yElems[i]) / 2.0 * (xElems[i + 1] - xElems[i]);
+            xCum[k] = xElems[i];
+            yCum[k++] = result;
+        }
+        result = result + (yend + yElems[iend]) / 2.0 * (xend - xElems[iend]);
+    }
+    xCum[k] = xend;
+    yCum[k] = result;
+    Tcl_Obj *resultDict = Tcl_NewDictObj();
+    Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("x", -1), NewMeasVectorObj(configPtr, xCum, count));
+    Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("y", -1), NewMeasVectorObj(configPtr, yCum, count));
+    Tcl_SetObjResult(interp, resultDict);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * AvgRms --
+ *
+ *      Common implementation of the Avg and Rms commands: computes the mean (or the root mean square) of a Y vector
+ *      over a given interval in X.
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X values
+ *          objv[2] = y        - list of Y values
+ *          objv[3] = xstart   - start of the interval (must lie within `x`), empty for the first x value
+ *          objv[4] = xend     - end of the interval (must lie within `x`), empty for the last x value
+ *
+ *      int squared                   - input: if non-zero, compute the root mean square instead of the mean
+ *
+ * Results:
+ *      TCL_OK with the resulting value in the interpreter result, TCL_ERROR with the same error messages as
+ *      IntegCmdProc2 on invalid input.
+ *
+ * Side Effects:
+ *      None, the vector is integrated in place without building a squared copy.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int AvgRms(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[], int squared) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "x y xstart xend");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, yLen;
+    const double *xElems, *yElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, objv[2], &yLen, &yElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double xstart, xend;
+    if (GetBoundFromObj(interp, objv[3], xElems, xLen, 0, &xstart) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[4], xElems, xLen, 1, &xend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (xLen != yLen) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    Tcl_Size istart, iend;
+    if (IntegSegments(interp, xElems, xGrid, xLen, xstart, xend, &istart, &iend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    const CumIntegral *cumPtr = GetCumIntegral(configPtr, objv[1], objv[2]);
+    double result =
+        IntegTrapz(configPtr, cumPtr, xElems, yElems, istart, iend, xstart, xend, squared) / (xend - xstart);
+    if (squared) {
+        result = sqrt(result);
+    }
+    Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * AvgCmdProc2 --
+ *
+ *      Implements `::tclmeasure::Avg x y xstart xend`, the average of `y` over [xstart, xend]. See AvgRms().
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int AvgCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    return AvgRms(clientData, interp, objc, objv, 0);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * RmsCmdProc2 --
+ *
+ *      Implements `::tclmeasure::Rms x y xstart xend`, the root mean square of `y` over [xstart, xend]. See AvgRms().
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int RmsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    return AvgRms(clientData, interp, objc, objv, 1);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetRangeIndex --
+ *
+ *      Gets the range extrema index of a vector for windowed minimum and maximum queries. The first query of a vector
+ *      only counts, the index is built by the second one, so a single query keeps its plain scan.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr   - input: settings of the interpreter
+ *      Tcl_Obj *yObj                 - input: vector, already converted by GetMeasVectorElements()
+ *
+ * Results:
+ *      Built index, or NULL if the vector was not queried before or is too short to need one
+ *
+ * Side Effects:
+ *      May allocate the index in the representation of the vector
+ *
+ * Notes:
+ *      Every block is scanned with ScanRange() from its first value that is not NaN, so the block extrema are the ones
+ *      of a sequential scan. A level combines two halves and keeps the left one unless the right one is strictly
+ *      better or the left one is NaN, so the first point of the extremum is kept.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static const RangeIndex *GetRangeIndex(const MeasConfig *configPtr, Tcl_Obj *yObj) {
+    const Tcl_ObjInternalRep *irPtr = Tcl_FetchInternalRep(yObj, &measVectorType);
+    if (irPtr == NULL) {
+        return NULL;
+    }
+    MeasVectorRep *repPtr = (MeasVectorRep *)irPtr->twoPtrValue.ptr1;
+    if ((repPtr->rangePtr != NULL) || (repPtr->len < 4 * MEAS_RANGE_BLOCK)) {
+        return repPtr->rangePtr;
+    }
+    if (++repPtr->rangeQueries < 2) {
+        return NULL;
+    }
+    const double *y = repPtr->data;
+    Tcl_Size blocks = repPtr->len / MEAS_RANGE_BLOCK;
+    int levels = HighestBit64((Tcl_WideUInt)blocks) + 1;
+    RangeIndex *rangePtr = (RangeIndex *)Tcl_Alloc(sizeof(RangeIndex));
+    rangePtr->blocks = blocks;
+    rangePtr->levels = levels;
+    rangePtr->minIdx = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * blocks * levels);
+    rangePtr->maxIdx = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * blocks * levels);
+    for (Tcl_Size j = 0; j < blocks; ++j) {
+        Tcl_Size first = j * MEAS_RANGE_BLOCK, last = first + MEAS_RANGE_BLOCK - 1;
+        while ((first < last) && isnan(y[first])) {
+            first++;
+        }
+        RangeScan scan;
+        scan.min = scan.max = y[first];
+        ScanRange(configPtr, NULL, y, first + 1, last, SCAN_EXTREMA, &scan);
+        rangePtr->minIdx[j] = (scan.minIdx < 0) ? first : scan.minIdx;
+        rangePtr->maxIdx[j] = (scan.maxIdx < 0) ? first : scan.maxIdx;
+    }
+    for (int k = 1; k < levels; ++k) {
+        const Tcl_Size *prevMin = rangePtr->minIdx + (k - 1) * blocks, *prevMax = rangePtr->maxIdx + (k - 1) * blocks;
+        Tcl_Size *levelMin = rangePtr->minIdx + k * blocks, *levelMax = rangePtr->maxIdx + k * blocks;
+        Tcl_Size half = (Tcl_Size)1 << (k - 1);
+        for (Tcl_Size j = 0; j + 2 * half <= blocks; ++j) {
+            Tcl_Size left = prevMin[j], right = prevMin[j + half];
+            levelMin[j] = ((y[right] < y[left]) || (isnan(y[left]) && !isnan(y[right]))) ? right : left;
+            left = prevMax[j];
+            right = prevMax[j + half];
+            levelMax[j] = ((y[right] > y[left]) || (isnan(y[left]) && !isnan(y[right]))) ? right : left;
+        }
+    }
+    repPtr->rangePtr = rangePtr;
+    return rangePtr;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ScanExtrema --
+ *
+ *      Same as ScanRange() with SCAN_EXTREMA over points [first, last], but the whole blocks of the range extrema
+ *      index inside the range are looked up in the index instead of scanned.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr   - input: settings of the interpreter
+ *      const RangeIndex *rangePtr    - input: index from GetRangeIndex(), NULL to scan all points
+ *      const double *y               - input: values
+ *      Tcl_Size first                - input: index of the first point
+ *      Tcl_Size last                 - input: index of the last point
+ *      RangeScan *scanPtr            - input/output: start values of min and max, results as in ScanRange()
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      At most two partial blocks are scanned, the whole blocks take two lookups per extremum. The index skips NaN
+ *      values and a NaN start value is never improved, so the results are the ones of a sequential scan.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ScanExtrema(const MeasConfig *configPtr, const RangeIndex *rangePtr, const double *y, Tcl_Size first,
+                        Tcl_Size last, RangeScan *scanPtr) {
+    Tcl_Size blockFirst = (first + MEAS_RANGE_BLOCK - 1) / MEAS_RANGE_BLOCK;
+    Tcl_Size blockLast = (last + 1) / MEAS_RANGE_BLOCK - 1;
+    if ((rangePtr == NULL) || (blockLast < blockFirst)) {
+        ScanRange(configPtr, NULL, y, first, last, SCAN_EXTREMA, scanPtr);
+        return;
+    }
+    double min = scanPtr->min, max = scanPtr->max;
+    Tcl_Size minIdx = -1, maxIdx = -1;
+    RangeScan part;
+    if (first < blockFirst * MEAS_RANGE_BLOCK) {
+        part.min = min;
+        part.max = max;
+        ScanRange(configPtr, NULL, y, first, blockFirst * MEAS_RANGE_BLOCK - 1, SCAN_EXTREMA, &part);
+        if (part.minIdx >= 0) {
+            min = part.min;
+            minIdx = part.minIdx;
+        }
+        if (part.maxIdx >= 0) {
+            max = part.max;
+            maxIdx = part.maxIdx;
+        }
+    }
+    int k = HighestBit64((Tcl_WideUInt)(blockLast - blockFirst + 1));
+    const Tcl_Size *levelMin = rangePtr->minIdx + k * rangePtr->blocks;
+    const Tcl_Size *levelMax = rangePtr->maxIdx + k * rangePtr->blocks;
+    Tcl_Size tail = blockLast - ((Tcl_Size)1 << k) + 1;
+    Tcl_Size candidates[4] = {levelMin[blockFirst], levelMin[tail], levelMax[blockFirst], levelMax[tail]};
+    for (int c = 0; c < 2; ++c) {
+        if (y[candidates[c]] < min) {
+            min = y[candidates[c]];
+            minIdx = candidates[c];
+        }
+        if (y[candidates[c + 2]] > max) {
+            max = y[candidates[c + 2]];
+            maxIdx = candidates[c + 2];
+        }
+    }
+    if (last >= (blockLast + 1) * MEAS_RANGE_BLOCK) {
+        part.min = min;
+        part.max = max;
+        ScanRange(configPtr, NULL, y, (blockLast + 1) * MEAS_RANGE_BLOCK, last, SCAN_EXTREMA, &part);
+        if (part.minIdx >= 0) {
+            min = part.min;
+            minIdx = part.minIdx;
+        }
+        if (part.maxIdx >= 0) {
+            max = part.max;
+            maxIdx = part.maxIdx;
+        }
+    }
+    scanPtr->min = min;
+    scanPtr->max = max;
+    scanPtr->minIdx = minIdx;
+    scanPtr->maxIdx = maxIdx;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * MinMaxPPMinAtMaxAtCmdProc2 --
+ *
+ *      Implements a Tcl command that analyzes a segment of a (x, y) signal and computes a statistical result over
+ *      that interval. Supported result types include min/max values, peak-to-peak range, and the x-location of
+ *      the min/max value. The interval is defined by `xstart` and `xend`, and the command supports optional
+ *      extraction of the segment as a dictionary.
+ *
+ * Parameters:
+ *      void *clientData              - input: optional user data (unused)
+ *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X values (monotonically increasing)
+ *          objv[2] = y        - list of Y values (aligned with X)
+ *          objv[3] = xstart   - start of the range (inclusive), empty for the first x value
+ *          objv[4] = xend     - end of the range (inclusive), empty for the last x value
+ *          objv[5] = type     - operation to perform:
+ *                                  "min"     => minimum value of y in range
+ *                                  "max"     => maximum value of y in range
+ *                                  "pp"      => peak-to-peak (fabs(min) + fabs(max))
+ *                                  "minat"   => x value at which min(y) occurs
+ *                                  "maxat"   => x value at which max(y) occurs
+ *                                  "between" => dict with "x" and "y" lists between xstart and xend
+ *
+ * Results:
+ *      TCL_OK with one of the following:
+ *          - A double value (min, max, pp)
+ *          - A scalar X value where the min or max occurs
+ *          - A dictionary {x -> list, y -> list} of the subrange
+ *
+ *      TCL_ERROR on:
+ *          - incorrect argument count
+ *          - failure to parse X or Y lists
+ *          - mismatched X/Y lengths
+ *          - xstart/xend outside of X range or invalid interval
+ *          - unrecognized type keyword
+ *
+ * Side Effects:
+ *      - Finds the segments that contain `xstart` and `xend` with binary search
+ *      - Performs interpolation at the edges of the integration interval using `CalcYBetween`
+ *      - Allocates and returns result as either a scalar, list, or dictionary
+ *
+ * Notes:
+ *      - The range [xstart, xend] must lie entirely within the input X domain
+ *      - Subrange data includes interpolated boundary points at xstart and xend, so it can't be a view of the input
+ *        vectors: the window is copied with memcpy() into packed arrays returned as vectors (see NewMeasVectorObj())
+ *      - Min, max, pp, minat and maxat are reduced in place over points [istart+1, iend] with ScanExtrema(), the
+ *        interpolated values at the ends are merged as scalars by WindowExtrema(), so nothing is copied or
+ *        allocated; vectors queried more than once use their range extrema index (see GetRangeIndex())
+ *      - minat and maxat report the first point of the extremum
+ *      - Requires at least 2 X/Y samples in the interval to function correctly
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int MinMaxPPMinAtMaxAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 6) {
+        Tcl_WrongNumArgs(interp, 5, objv, "x y xstart xend type");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, yLen;
+    const double *xElems, *yElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, objv[2], &yLen, &yElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double xstart, xend;
+    if (GetBoundFromObj(interp, objv[3], xElems, xLen, 0, &xstart) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[4], xElems, xLen, 1, &xend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    int type;
+    const char *typeStr = Tcl_GetString(objv[5]);
+    if (!strcmp(typeStr, "min")) {
+        type = TYPE_MIN;
+    } else if (!strcmp(typeStr, "max")) {
+        type = TYPE_MAX;
+    } else if (!strcmp(typeStr, "pp")) {
+        type = TYPE_PP;
+    } else if (!strcmp(typeStr, "minat")) {
+        type = TYPE_MINAT;
+    } else if (!strcmp(typeStr, "maxat")) {
+        type = TYPE_MAXAT;
+    } else if (!strcmp(typeStr, "between")) {
+        type = TYPE_BETWEEN;
+    } else {
+        return TCL_ERROR;
+    }
+    if (xLen != yLen) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    double xActualStart, xActualEnd;
+    xActualStart = xElems[0];
+    xActualEnd = xElems[xLen - 1];
+    if (xstart < xActualStart) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Start of integration interval '%f' is outside the x values range", xstart);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (xend > xActualEnd) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("End of integration interval '%f' is outside the x values range", xend);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    } else if (xstart >= xend) {
+        Tcl_SetObjResult(
+            interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the integration", -1));
+        return TCL_ERROR;
+    }
+    Tcl_Size istart = FindSegment(xElems, xGrid, xLen, xstart, 0);
+    Tcl_Size iend = FindSegment(xElems, xGrid, xLen, xend, istart);
+    int endFlagFound = (istart >= 0) && (iend >= 0);
+    double ystart = 0, yend = 0;
+    if (endFlagFound) {
+        ystart = CalcYBetween(xElems[istart], yElems[istart], xElems[istart + 1], yElems[istart + 1], xstart);
+        yend = CalcYBetween(xElems[iend], yElems[iend], xElems[iend + 1], yElems[iend + 1], xend);
+    }
+    if (!endFlagFound) {
+        return TCL_ERROR;
+    }
+    if (type == TYPE_BETWEEN) {
+        Tcl_Size count = iend - istart + 2;
+        double *xBetween = (double *)Tcl_Alloc(sizeof(double) * count);
+        double *yBetween = (double *)Tcl_Alloc(sizeof(double) * count);
+        xBetween[0] = xstart;
+        yBetween[0] = ystart;
+        memcpy(xBetween + 1, xElems + istart + 1, sizeof(double) * (count - 2));
+        memcpy(yBetween + 1, yElems + istart + 1, sizeof(double) * (count - 2));
+        xBetween[count - 1] = xend;
+        yBetween[count - 1] = yend;
+        Tcl_Obj *resultDict = Tcl_NewDictObj();
+        Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("x", -1), NewMeasVectorObj(configPtr, xBetween, count));
+        Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("y", -1), NewMeasVectorObj(configPtr, yBetween, count));
+        Tcl_SetObjResult(interp, resultDict);
+        return TCL_OK;
+    }
+    RangeScan scan;
+    MeasStats stats;
+    scan.min = scan.max = ystart;
+    scan.minIdx = scan.maxIdx = -1;
+    ScanExtrema(configPtr, GetRangeIndex(configPtr, objv[2]), yElems, istart + 1, iend, &scan);
+    WindowExtrema(xElems, yElems, istart, iend, xstart, xend, ystart, yend, &scan, &stats);
+    double result = 0.0;
+    switch ((enum Types)type) {
+    case TYPE_MIN:
+        result = stats.min;
+        break;
+    case TYPE_MAX:
+        result = stats.max;
+        break;
+    case TYPE_PP:
+        result = stats.pp;
+        break;
+    case TYPE_MINAT:
+        result = stats.minAt;
+        break;
+    case TYPE_MAXAT:
+        result = stats.maxAt;
+        break;
+    case TYPE_BETWEEN:
+        break;
+    };
+    Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * WindowExtrema --
+ *
+ *      Completes the minimum, maximum, peak-to-peak and the positions of the extrema of a window from the scan of its
+ *      inner points and the interpolated values at its ends.
+ *
+ * Parameters:
+ *      const double *x               - input: strictly increasing x values
+ *      const double *y               - input: y values, same length as `x`
+ *      Tcl_Size istart               - input: segment that contains `xstart`, as returned by IntegSegments()
+ *      Tcl_Size iend                 - input: segment that contains `xend`, as returned by IntegSegments()
+ *      double xstart                 - input: start of the window
+ *      double xend                   - input: end of the window
+ *      double ystart                 - input: value interpolated at `xstart`
+ *      double yend                   - input: value interpolated at `xend`
+ *      const RangeScan *scanPtr      - input: extrema of points [istart+1, iend] scanned from `ystart`
+ *      MeasStats *statsPtr           - output: min, max, pp, minAt and maxAt
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void WindowExtrema(const double *x, const double *y, Tcl_Size istart, Tcl_Size iend, double xstart, double xend,
+                          double ystart, double yend, const RangeScan *scanPtr, MeasStats *statsPtr) {
+    double min = scanPtr->min, max = scanPtr->max;
+    if (isnan(ystart)) {
+        /* nothing is below or above NaN, so the positions stay at xstart, but the values skip NaN as fmin() does */
+        for (Tcl_Size i = istart + 1; i <= iend; ++i) {
+            min = fmin(min, y[i]);
+            max = fmax(max, y[i]);
+        }
+    }
+    statsPtr->min = fmin(min, yend);
+    statsPtr->max = fmax(max, yend);
+    statsPtr->pp = fabs(statsPtr->min) + fabs(statsPtr->max);
+    statsPtr->minAt = (scanPtr->minIdx < 0) ? xstart : x[scanPtr->minIdx];
+    statsPtr->maxAt = (scanPtr->maxIdx < 0) ? xstart : x[scanPtr->maxIdx];
+    if (yend < scanPtr->min) {
+        statsPtr->minAt = xend;
+    }
+    if (yend > scanPtr->max) {
+        statsPtr->maxAt = xend;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * WindowStats --
+ *
+ *      Computes average, rms, minimum, maximum, peak-to-peak and the positions of the extrema of a vector over
+ *      [xstart, xend] in one pass over the samples.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr   - input: settings of the interpreter
+ *      const CumIntegral *cumPtr     - input: cumulative integrals of y from GetCumIntegral(), NULL to sum the samples
+ *      const RangeIndex *rangePtr    - input: range extrema index of y from GetRangeIndex(), used with `cumPtr`
+ *      const double *x               - input: strictly increasing x values
+ *      const double *y               - input: y values, same length as `x`
+ *      Tcl_Size istart               - input: segment that contains `xstart`, as returned by IntegSegments()
+ *      Tcl_Size iend                 - input: segment that contains `xend`, as returned by IntegSegments()
+ *      double xstart                 - input: start of the window
+ *      double xend                   - input: end of the window
+ *      MeasStats *statsPtr           - output: computed values
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      None.
+ *
+ * Notes:
+ *      The window is the same one MinMaxPPMinAtMaxAtCmdProc2 reduces: values at `xstart` and `xend`
+ *      are interpolated with CalcYBetween() and the samples in between are used as is, but nothing is copied. Each
+ *      value matches the one returned by the dedicated command: the same comparisons are used for the extrema and the
+ *      integrals are summed in the same order as IntegTrapz(), or taken from the same cumulative integrals. The
+ *      samples are scanned once with ScanRange(), or only for the extrema with ScanExtrema() when the integrals are
+ *      taken from the cumulative ones.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void WindowStats(const MeasConfig *configPtr, const CumIntegral *cumPtr, const RangeIndex *rangePtr,
+                        const double *x, const double *y, Tcl_Size istart, Tcl_Size iend, double xstart, double xend,
+                        MeasStats *statsPtr) {
+    double ystart = CalcYBetween(x[istart], y[istart], x[istart + 1], y[istart + 1], xstart);
+    double yend = CalcYBetween(x[iend], y[iend], x[iend + 1], y[iend + 1], xend);
+    double sqStart = CalcYBetween(x[istart], y[istart] * y[istart], x[istart + 1], y[istart + 1] * y[istart + 1],
+                                  xstart);
+    double sqEnd = CalcYBetween(x[iend], y[iend] * y[iend], x[iend + 1], y[iend + 1] * y[iend + 1], xend);
+    double integ, integSq;
+    RangeScan scan;
+    scan.min = scan.max = ystart;
+    scan.minIdx = scan.maxIdx = -1;
+    if (istart == iend) {
+        integ = (yend + ystart) / 2.0 * (xend - xstart);
+        integSq = (sqEnd + sqStart) / 2.0 * (xend - xstart);
+    } else {
+        if (cumPtr != NULL) {
+            ScanExtrema(configPtr, rangePtr, y, istart + 1, iend, &scan);
+            scan.sum = cumPtr->sum[iend] - cumPtr->sum[istart + 1];
+            scan.sumSq = fmax(cumPtr->sumSq[iend] - cumPtr->sumSq[istart + 1], 0.0);
+        } else {
+            ScanRange(configPtr, x, y, istart + 1, iend, SCAN_EXTREMA | SCAN_SUMS, &scan);
+        }
+        double yisp1 = y[istart + 1], yie = y[iend];
+        integ = (yisp1 + ystart) / 2.0 * (x[istart + 1] - xstart);
+        integ = integ + scan.sum / 2.0;
+        integ = integ + (yend + yie) / 2.0 * (xend - x[iend]);
+        integSq = (yisp1 * yisp1 + sqStart) / 2.0 * (x[istart + 1] - xstart);
+        integSq = integSq + scan.sumSq / 2.0;
+        integSq = integSq + (sqEnd + yie * yie) / 2.0 * (xend - x[iend]);
+    }
+    WindowExtrema(x, y, istart, iend, xstart, xend, ystart, yend, &scan, statsPtr);
+    statsPtr->avg = integ / (xend - xstart);
+    statsPtr->rms = sqrt(integSq / (xend - xstart));
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * NewStatsObj --
+ *
+ *      Creates the dictionary returned by `::tclmeasure::Stats`.
+ *
+ * Parameters:
+ *      const MeasStats *statsPtr     - input: values computed by WindowStats()
+ *
+ * Results:
+ *      New dictionary object with keys avg, rms, min, max, pp, minat and maxat.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Obj *NewStatsObj(const MeasStats *statsPtr) {
+    Tcl_Obj *resultDict = Tcl_NewDictObj();
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("avg", -1), Tcl_NewDoubleObj(statsPtr->avg));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("rms", -1), Tcl_NewDoubleObj(statsPtr->rms));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("min", -1), Tcl_NewDoubleObj(statsPtr->min));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("max", -1), Tcl_NewDoubleObj(statsPtr->max));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("pp", -1), Tcl_NewDoubleObj(statsPtr->pp));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("minat", -1), Tcl_NewDoubleObj(statsPtr->minAt));
+    Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("maxat", -1), Tcl_NewDoubleObj(statsPtr->maxAt));
+    return resultDict;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StatsCmdProc2 --
+ *
+ *      Implements `::tclmeasure::Stats x y xstart xend`, returns avg, rms, min, max, pp, minat and maxat of a Y vector
+ *      over the interval [xstart, xend] computed in a single pass.
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X values
+ *          objv[2] = y        - list of Y values
+ *          objv[3] = xstart   - start of the interval (must lie within `x`), empty for the first x value
+ *          objv[4] = xend     - end of the interval (must lie within `x`), empty for the last x value
+ *
+ * Results:
+ *      TCL_OK with a dict with keys avg, rms, min, max, pp, minat and maxat in the interpreter result.
+ *      TCL_ERROR on invalid arguments, mismatched lengths or an interval outside of `x`, with the same messages as
+ *      IntegCmdProc2.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int StatsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "x y xstart xend");
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen, yLen;
+    const double *xElems, *yElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetMeasVectorElements(interp, objv[2], &yLen, &yElems) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double xstart, xend;
+    if (GetBoundFromObj(interp, objv[3], xElems, xLen, 0, &xstart) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[4], xElems, xLen, 1, &xend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (xLen != yLen) {
+        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
+        Tcl_SetObjResult(interp, errorMsg);
+        return TCL_ERROR;
+    }
+    Tcl_Size istart, iend;
+    if (IntegSegments(interp, xElems, xGrid, xLen, xstart, xend, &istart, &iend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    MeasStats stats;
+    const CumIntegral *cumPtr = GetCumIntegral(configPtr, objv[1], objv[2]);
+    const RangeIndex *rangePtr = (cumPtr != NULL) ? GetRangeIndex(configPtr, objv[2]) : NULL;
+    WindowStats(configPtr, cumPtr, rangePtr, xElems, yElems, istart, iend, xstart, xend, &stats);
+    Tcl_SetObjResult(interp, NewStatsObj(&stats));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ColumnsCmdProc2 --
+ *
+ *      Implements `::tclmeasure::Columns x names xstart xend type y ?y ...?`, does the same Avg, Rms, Min, Max, PP,
+ *      MinAt, MaxAt or Stats measurement on many Y vectors over the interval [xstart, xend] and returns the results by
+ *      the names of the vectors.
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = x        - list of X values
+ *          objv[2] = names    - list of the names of the Y vectors, one for each of objv[6..]
+ *          objv[3] = xstart   - start of the interval (must lie within `x`), empty for the first x value
+ *          objv[4] = xend     - end of the interval (must lie within `x`), empty for the last x value
+ *          objv[5] = type     - one of avg, rms, min, max, pp, minat, maxat or stats
+ *          objv[6..] = y      - lists of Y values
+ *
+ * Results:
+ *      TCL_OK with a dict in the interpreter result, the names as the keys and the values the dedicated command
+ *      returns for each vector as the values.
+ *      TCL_ERROR on invalid arguments, mismatched lengths or an interval outside of `x`, with the messages of
+ *      StatsCmdProc2 except that a vector of wrong length is named.
+ *
+ * Side Effects:
+ *      May build the cumulative integrals and the range extrema indices of the vectors, as the dedicated commands do.
+ *
+ * Notes:
+ *      X is converted and checked, and the segments of the interval are found, once for all vectors; the vectors are
+ *      then reduced one after the other, so each pass reads a single contiguous column. Windows shorter than a chunk
+ *      of the worker pool aren't split, so with many vectors the pool reduces whole vectors instead, each one by a
+ *      single thread with the same kernels, and the results don't depend on the number of threads.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ColumnsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    static const char *const types[] = {"avg", "rms", "min", "max", "pp", "minat", "maxat", "stats", NULL};
+    enum ColumnTypes { COLUMN_AVG, COLUMN_RMS, COLUMN_MIN, COLUMN_MAX, COLUMN_PP, COLUMN_MINAT, COLUMN_MAXAT,
+                       COLUMN_STATS };
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc < 7) {
+        Tcl_WrongNumArgs(interp, 1, objv, "x names xstart xend type y ?y ...?");
+        return TCL_ERROR;
+    }
+    Tcl_Size count = objc - 6, namesLen;
+    Tcl_Obj **names;
+    int type;
+    if (Tcl_ListObjGetElements(interp, objv[2], &namesLen, &names) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (namesLen != count) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Number of names '%ld' is not equal to number of vectors '%ld'",
+                                               namesLen, count));
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[5], types, sizeof(char *), "type", TCL_EXACT, &type) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Size xLen;
+    const double *xElems;
+    const MeasGrid *xGrid;
+    if (GetMeasXElements(interp, configPtr, objv[1], &xLen, &xElems, &xGrid) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    double xstart, xend;
+    if (GetBoundFromObj(interp, objv[3], xElems, xLen, 0, &xstart) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (GetBoundFromObj(interp, objv[4], xElems, xLen, 1, &xend) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    ColumnChunks job;
+    job.ys = (const double **)Tcl_Alloc(sizeof(double *) * count);
+    for (Tcl_Size i = 0; i < count; ++i) {
+        Tcl_Size yLen;
+        if (GetMeasVectorElements(interp, objv[6 + i], &yLen, &job.ys[i]) != TCL_OK) {
+            Tcl_Free((char *)job.ys);
+            return TCL_ERROR;
+        }
+        if (xLen != yLen) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Length of x '%ld' is not equal to length of '%s' '%ld'", xLen,
+                                                   Tcl_GetString(names[i]), yLen));
+            Tcl_Free((char *)job.ys);
+            return TCL_ERROR;
+        }
+    }
+    if (IntegSegments(interp, xElems, xGrid, xLen, xstart, xend, &job.istart, &job.iend) != TCL_OK) {
+        Tcl_Free((char *)job.ys);
+        return TCL_ERROR;
+    }
+    MeasConfig single = *configPtr;
+    single.threads = 1;
+    job.configPtr = &single;
+    job.x = xElems;
+    job.xstart = xstart;
+    job.xend = xend;
+    job.sums = (type == COLUMN_AVG) || (type == COLUMN_RMS) || (type == COLUMN_STATS);
+    job.cums = (const CumIntegral **)Tcl_Alloc(sizeof(CumIntegral *) * count);
+    job.ranges = (const RangeIndex **)Tcl_Alloc(sizeof(RangeIndex *) * count);
+    job.stats = (MeasStats *)Tcl_Alloc(sizeof(MeasStats) * count);
+    for (Tcl_Size i = 0; i < count; ++i) {
+        job.cums[i] = job.sums ? GetCumIntegral(configPtr, objv[1], objv[6 + i]) : NULL;
+        job.ranges[i] = (!job.sums || (job.cums[i] != NULL)) ? GetRangeIndex(configPtr, objv[6 + i]) : NULL;
+    }
+    Tcl_Size minLen = MEAS_CHUNK_MIN / (job.iend - job.istart + 1);
+    int chunks = SplitRange(configPtr, 0, count, (minLen > 0) ? minLen : 1, job.bounds);
+    if ((chunks == 1) || (job.iend - job.istart >= MEAS_CHUNK_MIN)) {
+        /* long windows are split by ScanRange() itself */
+        job.configPtr = configPtr;
+        job.bounds[0] = 0;
+        job.bounds[1] = count;
+        ColumnChunkProc(&job, 0);
+    } else {
+        RunChunks(chunks, ColumnChunkProc, &job);
+    }
+    Tcl_Obj *resultDict = Tcl_NewDictObj();
+    for (Tcl_Size i = 0; i < count; ++i) {
+        const MeasStats *statsPtr = &job.stats[i];
+        Tcl_Obj *valueObj;
+        switch ((enum ColumnTypes)type) {
+        case COLUMN_AVG:
+            valueObj = Tcl_NewDoubleObj(statsPtr->avg);
+            break;
+        case COLUMN_RMS:
+            valueObj = Tcl_NewDoubleObj(statsPtr->rms);
+            break;
+        case COLUMN_MIN:
+            valueObj = Tcl_NewDoubleObj(statsPtr->min);
+            break;
+        case COLUMN_MAX:
+            valueObj = Tcl_NewDoubleObj(statsPtr->max);
+            break;
+        case COLUMN_PP:
+            valueObj = Tcl_NewDoubleObj(statsPtr->pp);
+            break;
+        case COLUMN_MINAT:
+            valueObj = Tcl_NewDoubleObj(statsPtr->minAt);
+            break;
+        case COLUMN_MAXAT:
+            valueObj = Tcl_NewDoubleObj(statsPtr->maxAt);
+            break;
+        default:
+            valueObj = NewStatsObj(statsPtr);
+            break;
+        }
+        Tcl_DictObjPut(NULL, resultDict, names[i], valueObj);
+    }
+    Tcl_Free((char *)job.ys);
+    Tcl_Free((char *)job.cums);
+    Tcl_Free((char *)job.ranges);
+    Tcl_Free((char *)job.stats);
+    Tcl_SetObjResult(interp, resultDict);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ColumnChunkProc --
+ *
+ *      Chunk procedure of ColumnsCmdProc2(): reduces the window of vectors [bounds[chunk], bounds[chunk+1]).
+ *
+ * Parameters:
+ *      void *clientData          - input/output: the ColumnChunks job
+ *      int chunk                 - input: index of the chunk
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Fills the stats of the vectors of the chunk. Only the extrema are computed if the job needs no integrals, as
+ *      MinMaxPPMinAtMaxAtCmdProc2 does.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ColumnChunkProc(void *clientData, int chunk) {
+    ColumnChunks *jobPtr = (ColumnChunks *)clientData;
+    const double *x = jobPtr->x;
+    Tcl_Size istart = jobPtr->istart, iend = jobPtr->iend;
+    for (Tcl_Size i = jobPtr->bounds[chunk]; i < jobPtr->bounds[chunk + 1]; ++i) {
+        const double *y = jobPtr->ys[i];
+        if (jobPtr->sums) {
+            WindowStats(jobPtr->configPtr, jobPtr->cums[i], jobPtr->ranges[i], x, y, istart, iend, jobPtr->xstart,
+                        jobPtr->xend, &jobPtr->stats[i]);
+            continue;
+        }
+        double ystart = CalcYBetween(x[istart], y[istart], x[istart + 1], y[istart + 1], jobPtr->xstart);
+        double yend = CalcYBetween(x[iend], y[iend], x[iend + 1], y[iend + 1], jobPtr->xend);
+        RangeScan scan;
+        scan.min = scan.max = ystart;
+        scan.minIdx = scan.maxIdx = -1;
+        ScanExtrema(jobPtr->configPtr, jobPtr->ranges[i], y, istart + 1, iend, &scan);
+        WindowExtrema(x, y, istart, iend, jobPtr->xstart, jobPtr->xend, ystart, yend, &scan, &jobPtr->stats[i]);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * NewStreamCmdProc2 --
+ *
+ *      Implements `::tclmeasure::Stream xname batch measurements`, creates a stream that runs the planned commands of
+ *      measurements over data fed in chunks (see ::tclmeasure::stream). The command of the stream is
+ *      `::tclmeasure::streamN` and is handled by StreamCmdProc2.
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = xname        - name of the x vector in the fed data dictionaries
+ *          objv[2] = batch        - boolean, measurements is a dictionary of named commands if true
+ *          objv[3] = measurements - planned command of a single measurement, or a dictionary of them
+ *
+ * Results:
+ *      TCL_OK with the fully qualified name of the stream command in the interpreter result.
+ *      TCL_ERROR if a command can't be streamed or has invalid arguments, prefixed with the name of the measurement
+ *      in a batch.
+ *
+ * Side Effects:
+ *      Creates the command of the stream, which owns the stream until it is deleted.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int NewStreamCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 4) {
+        Tcl_WrongNumArgs(interp, 1, objv, "xname batch measurements");
+        return TCL_ERROR;
+    }
+    int batch;
+    if (Tcl_GetBooleanFromObj(interp, objv[2], &batch) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    Tcl_Size count = 1;
+    Tcl_Obj **elems = NULL;
+    if (batch) {
+        if (Tcl_ListObjGetElements(interp, objv[3], &count, &elems) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (count % 2) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("missing value to go with key", -1));
+            return TCL_ERROR;
+        }
+        count /= 2;
+    }
+    MeasStream *streamPtr = NewStream(interp, configPtr, objv[1], count, batch ? elems : NULL,
+                                      batch ? elems + 1 : objv + 3, 0);
+    if (streamPtr == NULL) {
+        return TCL_ERROR;
+    }
+    /* skip names taken by other commands */
+    Tcl_Obj *nameObj;
+    Tcl_CmdInfo info;
+    do {
+        nameObj = Tcl_ObjPrintf("::tclmeasure::stream%ld", ++configPtr->streams);
+        if (!Tcl_GetCommandInfo(interp, Tcl_GetString(nameObj), &info)) {
+            break;
+        }
+        Tcl_DecrRefCount(nameObj);
+    } while (1);
+    streamPtr->token = Tcl_CreateObjCommand2(interp, Tcl_GetString(nameObj), (Tcl_ObjCmdProc2 *)StreamCmdProc2,
+                                             streamPtr, FreeStream);
+    Tcl_SetObjResult(interp, nameObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * NewStream --
+ *
+ *      Creates a stream from the planned commands of its measurements, without its command.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasConfig *configPtr     - input: settings of the interpreter
+ *      Tcl_Obj *xnameObj         - input: name of the x vector in the fed data dictionaries
+ *      Tcl_Size count            - input: number of measurements
+ *      Tcl_Obj *const *names     - input: names of the measurements of a batch at every second element, NULL for a
+ *                                  single measurement
+ *      Tcl_Obj *const *cmds      - input: planned commands of the measurements at every second element, or the
+ *                                  command of a single measurement
+ *      int evalOthers            - input: commands that can't be streamed get the STREAM_EVAL kind instead of failing
+ *
+ * Results:
+ *      New stream, or NULL with an error message in the interpreter, prefixed with the name of the measurement in a
+ *      batch
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static MeasStream *NewStream(Tcl_Interp *interp, MeasConfig *configPtr, Tcl_Obj *xnameObj, Tcl_Size count,
+                             Tcl_Obj *const *names, Tcl_Obj *const *cmds, int evalOthers) {
+    MeasStream *streamPtr = (MeasStream *)Tcl_Alloc(sizeof(MeasStream));
+    streamPtr->configPtr = configPtr;
+    streamPtr->token = NULL;
+    streamPtr->vecCount = 0;
+    /* the x vector and at most two vectors per measurement */
+    streamPtr->vecNames = (Tcl_Obj **)Tcl_Alloc(sizeof(Tcl_Obj *) * (2 * count + 1));
+    streamPtr->last = NULL;
+    streamPtr->joint = NULL;
+    streamPtr->chunks = NULL;
+    streamPtr->batch = (names != NULL);
+    streamPtr->measCount = 0;
+    streamPtr->meas = (StreamMeas *)Tcl_Alloc(sizeof(StreamMeas) * (count + 1));
+    StreamVector(streamPtr, xnameObj);
+    for (Tcl_Size i = 0; i < count; ++i) {
+        StreamMeas *measPtr = &streamPtr->meas[i];
+        measPtr->nameObj = (names != NULL) ? names[2 * i] : NULL;
+        if (measPtr->nameObj != NULL) {
+            Tcl_IncrRefCount(measPtr->nameObj);
+        }
+        streamPtr->measCount++;
+        if (ParseStreamMeas(interp, streamPtr, cmds[2 * i], measPtr) != TCL_OK) {
+            if (evalOthers) {
+                measPtr->kind = STREAM_EVAL;
+                Tcl_ResetResult(interp);
+                continue;
+            }
+            if (names != NULL) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Measurement '%s': %s", Tcl_GetString(measPtr->nameObj),
+                                                       Tcl_GetString(Tcl_GetObjResult(interp))));
+            }
+            FreeStream(streamPtr);
+            return NULL;
+        }
+    }
+    Tcl_Size vecCount = streamPtr->vecCount;
+    streamPtr->last = (double *)Tcl_Alloc(sizeof(double) * vecCount);
+    streamPtr->joint = (double *)Tcl_Alloc(sizeof(double) * 2 * vecCount);
+    streamPtr->chunks = (const double **)Tcl_Alloc(sizeof(const double *) * 2 * vecCount);
+    for (Tcl_Size v = 0; v < vecCount; ++v) {
+        streamPtr->chunks[vecCount + v] = streamPtr->joint + 2 * v;
+    }
+    ResetStream(streamPtr);
+    return streamPtr;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StreamVector --
+ *
+ *      Gets the slot of a vector in the fed data of a stream, adding the name if the stream does not use it yet.
+ *
+ * Parameters:
+ *      MeasStream *streamPtr     - input/output: stream being created
+ *      Tcl_Obj *nameObj          - input: name of the vector in the fed data dictionaries
+ *
+ * Results:
+ *      Index of the vector in streamPtr->vecNames
+ *
+ * Side Effects:
+ *      May add a reference to nameObj
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int StreamVector(MeasStream *streamPtr, Tcl_Obj *nameObj) {
+    const char *name = Tcl_GetString(nameObj);
+    for (Tcl_Size v = 0; v < streamPtr->vecCount; ++v) {
+        if (!strcmp(Tcl_GetString(streamPtr->vecNames[v]), name)) {
+            return (int)v;
+        }
+    }
+    Tcl_IncrRefCount(nameObj);
+    streamPtr->vecNames[streamPtr->vecCount] = nameObj;
+    return (int)streamPtr->vecCount++;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ParseStreamMeas --
+ *
+ *      Sets up a measurement of a stream from its planned command. The commands that can be streamed are the ones of
+ *      -trig/-targ and -at measurements (TrigTarg), -find -at (FindAt), -integ without -cum (Integ), -avg (Avg),
+ *      -rms (Rms), -stats (Stats) and -min, -max, -pp, -minat, -maxat (MinMaxPPMinAtMaxAt). The x vector argument of
+ *      the command is the one of the stream.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasStream *streamPtr     - input/output: stream being created, gets the vectors of the measurement
+ *      Tcl_Obj *cmdObj           - input: planned command, see ::tclmeasure::Plan
+ *      StreamMeas *measPtr       - output: measurement, nameObj is set by the caller
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the command can't be streamed or an argument is invalid
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ParseStreamMeas(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *cmdObj, StreamMeas *measPtr) {
+    static const char *const commands[] = {
+        "::tclmeasure::TrigTarg", "::tclmeasure::FindAt", "::tclmeasure::Integ", "::tclmeasure::Avg",
+        "::tclmeasure::Rms",      "::tclmeasure::Stats",  "::tclmeasure::MinMaxPPMinAtMaxAt", NULL};
+    enum Commands { CMD_TRIGTARG, CMD_FINDAT, CMD_INTEG, CMD_AVG, CMD_RMS, CMD_STATS, CMD_MINMAX };
+    static const Tcl_Size words[] = {12, 4, 6, 5, 5, 5, 6};
+    static const char *const types[] = {"min", "max", "pp", "minat", "maxat", NULL};
+    static const int typeResults[] = {RESULT_MIN, RESULT_MAX, RESULT_PP, RESULT_MINAT, RESULT_MAXAT};
+    Tcl_Size objc;
+    Tcl_Obj **objv;
+    int cmd;
+    if (Tcl_ListObjGetElements(interp, cmdObj, &objc, &objv) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if ((objc == 0) ||
+        (Tcl_GetIndexFromObjStruct(NULL, objv[0], commands, sizeof(char *), "command", TCL_EXACT, &cmd) != TCL_OK)) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj("Measurement can't be streamed, only -trig/-targ, -find -at, -integ, "
+                                                  "-avg, -rms, -stats, -min, -max, -pp, -minat and -maxat measurements "
+                                                  "are supported",
+                                                  -1));
+        return TCL_ERROR;
+    }
+    if (objc != words[cmd]) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Command '%s' has a wrong number of arguments", Tcl_GetString(cmdObj)));
+        return TCL_ERROR;
+    }
+    measPtr->hasFrom = 0;
+    if (cmd == CMD_TRIGTARG) {
+        measPtr->kind = STREAM_TRIGTARG;
+        if (ParseStreamCross(interp, streamPtr, objv[2], objv[3], objv[6], objv[7], objv[10], &measPtr->trig) !=
+            TCL_OK) {
+            return TCL_ERROR;
+        }
+        return ParseStreamCross(interp, streamPtr, objv[4], objv[5], objv[8], objv[9], objv[11], &measPtr->targ);
+    }
+    StreamWindow *winPtr = &measPtr->window;
+    measPtr->kind = STREAM_WINDOW;
+    winPtr->to = INFINITY;
+    if (cmd == CMD_FINDAT) {
+        measPtr->result = RESULT_FINDAT;
+        measPtr->hasFrom = 1;
+        winPtr->vec = StreamVector(streamPtr, objv[3]);
+        return Tcl_GetDoubleFromObj(interp, objv[2], &winPtr->from);
+    }
+    winPtr->vec = StreamVector(streamPtr, objv[2]);
+    if (Tcl_GetCharLength(objv[3]) > 0) {
+        measPtr->hasFrom = 1;
+        if (Tcl_GetDoubleFromObj(interp, objv[3], &winPtr->from) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    }
+    if ((Tcl_GetCharLength(objv[4]) > 0) && (Tcl_GetDoubleFromObj(interp, objv[4], &winPtr->to) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+    switch ((enum Commands)cmd) {
+    case CMD_INTEG: {
+        int cum;
+        if (Tcl_GetBooleanFromObj(interp, objv[5], &cum) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (cum) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("-integ measurement with -cum switch can't be streamed", -1));
+            return TCL_ERROR;
+        }
+        measPtr->result = RESULT_INTEG;
+        break;
+    }
+    case CMD_AVG:
+        measPtr->result = RESULT_AVG;
+        break;
+    case CMD_RMS:
+        measPtr->result = RESULT_RMS;
+        break;
+    case CMD_STATS:
+        measPtr->result = RESULT_STATS;
+        break;
+    case CMD_MINMAX: {
+        int type;
+        if (Tcl_GetIndexFromObjStruct(NULL, objv[5], types, sizeof(char *), "type", TCL_EXACT, &type) != TCL_OK) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("-%s measurement can't be streamed", Tcl_GetString(objv[5])));
+            return TCL_ERROR;
+        }
+        measPtr->result = typeResults[type];
+        break;
+    }
+    default:
+        break;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ParseStreamCross --
+ *
+ *      Sets up the trigger or target crossing search of a streamed TrigTarg command from its arguments.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasStream *streamPtr     - input/output: stream being created, gets the vector of the search
+ *      Tcl_Obj *vecObj           - input: name of the vector
+ *      Tcl_Obj *valObj           - input: level to cross
+ *      Tcl_Obj *condObj          - input: "rise", "fall", or "cross"
+ *      Tcl_Obj *countObj         - input: 1-based number of the crossing, or "last"
+ *      Tcl_Obj *delayObj         - input: x value before which crossings are ignored
+ *      StreamCross *crossPtr     - output: crossing search
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if a number is invalid
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ParseStreamCross(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *vecObj, Tcl_Obj *valObj,
+                            Tcl_Obj *condObj, Tcl_Obj *countObj, Tcl_Obj *delayObj, StreamCross *crossPtr) {
+    crossPtr->vec = StreamVector(streamPtr, vecObj);
+    if (Tcl_GetDoubleFromObj(interp, valObj, &crossPtr->val) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (!strcmp(Tcl_GetString(condObj), "rise")) {
+        crossPtr->cond = COND_RISE;
+    } else if (!strcmp(Tcl_GetString(condObj), "fall")) {
+        crossPtr->cond = COND_FALL;
+    } else {
+        crossPtr->cond = COND_CROSS;
+    }
+    if (!strcmp(Tcl_GetString(countObj), "last")) {
+        crossPtr->count = -1;
+    } else if (Tcl_GetWideIntFromObj(interp, countObj, &crossPtr->count) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    return Tcl_GetDoubleFromObj(interp, delayObj, &crossPtr->delay);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ResetStream --
+ *
+ *      Forgets the fed data of a stream, so its measurements start over with the next fed chunk.
+ *
+ * Parameters:
+ *      MeasStream *streamPtr     - input/output: stream
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ResetStream(MeasStream *streamPtr) {
+    streamPtr->fed = 0;
+    for (Tcl_Size i = 0; i < streamPtr->measCount; ++i) {
+        StreamMeas *measPtr = &streamPtr->meas[i];
+        if (measPtr->kind == STREAM_TRIGTARG) {
+            measPtr->trig.left = measPtr->trig.count;
+            measPtr->trig.found = 0;
+            measPtr->targ.left = measPtr->targ.count;
+            measPtr->targ.found = 0;
+        } else if (measPtr->kind == STREAM_WINDOW) {
+            measPtr->window.state = WINDOW_BEFORE;
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FreeStream --
+ *
+ *      Frees a stream, called when its command is deleted.
+ *
+ * Parameters:
+ *      void *clientData          - input: pointer to the MeasStream
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Releases the names of the vectors and measurements.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FreeStream(void *clientData) {
+    MeasStream *streamPtr = (MeasStream *)clientData;
+    for (Tcl_Size v = 0; v < streamPtr->vecCount; ++v) {
+        Tcl_DecrRefCount(streamPtr->vecNames[v]);
+    }
+    for (Tcl_Size i = 0; i < streamPtr->measCount; ++i) {
+        if (streamPtr->meas[i].nameObj != NULL) {
+            Tcl_DecrRefCount(streamPtr->meas[i].nameObj);
+        }
+    }
+    Tcl_Free((char *)streamPtr->vecNames);
+    Tcl_Free((char *)streamPtr->meas);
+    if (streamPtr->last != NULL) {
+        Tcl_Free((char *)streamPtr->last);
+        Tcl_Free((char *)streamPtr->joint);
+        Tcl_Free((char *)streamPtr->chunks);
+    }
+    Tcl_Free((char *)streamPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StreamCmdProc2 --
+ *
+ *      Implements the command of a stream created by ::tclmeasure::stream:
+ *          $stream feed data  - feeds a chunk of data, a dictionary of vectors that holds the x vector and the
+ *                               vectors of the measurements, all with the same length
+ *          $stream result     - returns the result of the measurement over the data fed so far, or the dictionary of
+ *                               results of a batch
+ *          $stream reset      - forgets the fed data
+ *          $stream destroy    - deletes the stream
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the MeasStream
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments
+ *
+ * Results:
+ *      TCL_OK with the result of the subcommand; TCL_ERROR on invalid arguments, on invalid fed data, or if a result
+ *      is not available, with the same messages as the measurement commands.
+ *
+ * Side Effects:
+ *      feed and reset update the state of the measurements, destroy deletes the command.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int StreamCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasStream *streamPtr = (MeasStream *)clientData;
+    static const char *const subcommands[] = {"feed", "result", "reset", "destroy", NULL};
+    enum Subcommands { SUB_FEED, SUB_RESULT, SUB_RESET, SUB_DESTROY };
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (objc != ((sub == SUB_FEED) ? 3 : 2)) {
+        Tcl_WrongNumArgs(interp, 2, objv, (sub == SUB_FEED) ? "data" : NULL);
+        return TCL_ERROR;
+    }
+    switch ((enum Subcommands)sub) {
+    case SUB_FEED:
+        return FeedStream(interp, streamPtr, objv[2]);
+    case SUB_RESULT: {
+        if (!streamPtr->batch) {
+            Tcl_Obj *resultObj = StreamMeasResult(interp, streamPtr, &streamPtr->meas[0]);
+            if (resultObj == NULL) {
+                return TCL_ERROR;
+            }
+            Tcl_SetObjResult(interp, resultObj);
+            return TCL_OK;
+        }
+        Tcl_Obj *resultDict = Tcl_NewDictObj();
+        for (Tcl_Size i = 0; i < streamPtr->measCount; ++i) {
+            Tcl_Obj *resultObj = StreamMeasResult(interp, streamPtr, &streamPtr->meas[i]);
+            if (resultObj == NULL) {
+                Tcl_DecrRefCount(resultDict);
+                Tcl_SetObjResult(interp,
+                                 Tcl_ObjPrintf("Measurement '%s': %s", Tcl_GetString(streamPtr->meas[i].nameObj),
+                                               Tcl_GetString(Tcl_GetObjResult(interp))));
+                return TCL_ERROR;
+            }
+            Tcl_DictObjPut(interp, resultDict, streamPtr->meas[i].nameObj, resultObj);
+        }
+        Tcl_SetObjResult(interp, resultDict);
+        return TCL_OK;
+    }
+    case SUB_RESET:
+        ResetStream(streamPtr);
+        return TCL_OK;
+    case SUB_DESTROY:
+        Tcl_DeleteCommandFromToken(interp, streamPtr->token);
+        return TCL_OK;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FeedStream --
+ *
+ *      Feeds a chunk of data to the measurements of a stream. The segment between the last fed point and the first
+ *      point of the chunk is fed first, as a chunk of two points, so the chunks join into a single vector.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasStream *streamPtr     - input/output: stream
+ *      Tcl_Obj *dataObj          - input: dictionary of vectors, holds the x vector and the vectors of the
+ *                                  measurements
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if a vector is missing or invalid, if the lengths differ, or if x is not
+ *      strictly increasing with configure -checkx, also across chunks. The stream is unchanged on error.
+ *
+ * Side Effects:
+ *      Converts the vectors of the chunk to measvector objects.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int FeedStream(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *dataObj) {
+    MeasConfig *configPtr = streamPtr->configPtr;
+    Tcl_Size vecCount = streamPtr->vecCount;
+    const double **chunks = streamPtr->chunks;
+    Tcl_Size len;
+    if (GetStreamVectors(interp, streamPtr, dataObj, chunks, &len) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (len == 0) {
+        return TCL_OK;
+    }
+    if (configPtr->checkX && (streamPtr->fed > 0) && !(chunks[0][0] > streamPtr->last[0])) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("x values must be strictly increasing, value '%f' at index '%ld' is not "
+                                               "greater than the previous one",
+                                               chunks[0][0], (Tcl_Size)streamPtr->fed));
+        return TCL_ERROR;
+    }
+    if (streamPtr->fed == 0) {
+        StartStreamWindows(streamPtr, chunks[0][0]);
+    } else {
+        for (Tcl_Size v = 0; v < vecCount; ++v) {
+            streamPtr->joint[2 * v] = streamPtr->last[v];
+            streamPtr->joint[2 * v + 1] = chunks[v][0];
+        }
+        FeedStreamPoints(streamPtr, chunks + vecCount, 2);
+    }
+    FeedStreamPoints(streamPtr, chunks, len);
+    for (Tcl_Size v = 0; v < vecCount; ++v) {
+        streamPtr->last[v] = chunks[v][len - 1];
+    }
+    streamPtr->fed += len;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetStreamVectors --
+ *
+ *      Gets the values of the vectors of a stream from a data dictionary and checks that they have the same length.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasStream *streamPtr     - input: stream
+ *      Tcl_Obj *dataObj          - input: dictionary of vectors, holds the x vector and the vectors of the
+ *                                  measurements
+ *      const double **vecs       - output: values of each vector of the stream, vecCount elements
+ *      Tcl_Size *lenPtr          - output: length of the vectors
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if a vector is missing or invalid, if the lengths differ, or if x is not
+ *      strictly increasing with configure -checkx.
+ *
+ * Side Effects:
+ *      Converts the vectors to measvector objects.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetStreamVectors(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *dataObj, const double **vecs,
+                            Tcl_Size *lenPtr) {
+    Tcl_Size len = 0;
+    for (Tcl_Size v = 0; v < streamPtr->vecCount; ++v) {
+        Tcl_Obj *vecObj;
+        if (Tcl_DictObjGet(interp, dataObj, streamPtr->vecNames[v], &vecObj) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (vecObj == NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("key \"%s\" not known in dictionary",
+                                                   Tcl_GetString(streamPtr->vecNames[v])));
+            return TCL_ERROR;
+        }
+        if (v == 0) {
+            const MeasGrid *xGrid;
+            if (GetMeasXElements(interp, streamPtr->configPtr, vecObj, &len, &vecs[0], &xGrid) != TCL_OK) {
+                return TCL_ERROR;
+            }
+        } else {
+            Tcl_Size vecLen;
+            if (GetMeasVectorElements(interp, vecObj, &vecLen, &vecs[v]) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            if (vecLen != len) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Length of %s '%ld' is not equal to length of %s '%ld'",
+                                                       Tcl_GetString(streamPtr->vecNames[0]), len,
+                                                       Tcl_GetString(streamPtr->vecNames[v]), vecLen));
+                return TCL_ERROR;
+            }
+        }
+    }
+    *lenPtr = len;
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StartStreamWindows --
+ *
+ *      Sets the start of the windows of a stream that has no fed data yet from the first fed x value: a window without
+ *      a start begins there, a window that starts before it is missed.
+ *
+ * Parameters:
+ *      MeasStream *streamPtr     - input/output: stream
+ *      double x0                 - input: first fed x value
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void StartStreamWindows(MeasStream *streamPtr, double x0) {
+    for (Tcl_Size i = 0; i < streamPtr->measCount; ++i) {
+        StreamMeas *measPtr = &streamPtr->meas[i];
+        if (measPtr->kind == STREAM_WINDOW) {
+            if (!measPtr->hasFrom) {
+                measPtr->window.from = x0;
+            }
+            if (measPtr->window.from < x0) {
+                measPtr->window.state = WINDOW_MISSED;
+            }
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FeedStreamPoints --
+ *
+ *      Feeds consecutive points of the vectors of a stream to each of its measurements.
+ *
+ * Parameters:
+ *      MeasStream *streamPtr       - input/output: stream
+ *      const double *const *vecs   - input: points of each vector of the stream, vecs[0] is the x vector
+ *      Tcl_Size n                  - input: number of points
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FeedStreamPoints(MeasStream *streamPtr, const double *const *vecs, Tcl_Size n) {
+    for (Tcl_Size i = 0; i < streamPtr->measCount; ++i) {
+        StreamMeas *measPtr = &streamPtr->meas[i];
+        if (measPtr->kind == STREAM_TRIGTARG) {
+            FeedStreamCross(streamPtr->configPtr, &measPtr->trig, vecs[0], vecs[measPtr->trig.vec], n);
+            FeedStreamCross(streamPtr->configPtr, &measPtr->targ, vecs[0], vecs[measPtr->targ.vec], n);
+        } else if (measPtr->kind == STREAM_WINDOW) {
+            FeedStreamWindow(streamPtr->configPtr, &measPtr->window, vecs[0], vecs[measPtr->window.vec], n);
+        }
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FeedStreamCross --
+ *
+ *      Searches the crossing of a streamed TrigTarg measurement in the segments of fed points. The n-th crossing is
+ *      counted down over the chunks and the search stops once it is found, the last crossing is replaced by the last
+ *      one of every chunk that has one.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr - input: settings of the interpreter
+ *      StreamCross *crossPtr       - input/output: crossing search
+ *      const double *x             - input: x values of the points
+ *      const double *y             - input: values of the crossing vector
+ *      Tcl_Size n                  - input: number of points
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FeedStreamCross(const MeasConfig *configPtr, StreamCross *crossPtr, const double *x, const double *y,
+                            Tcl_Size n) {
+    if ((n < 2) || (crossPtr->found && (crossPtr->count != -1))) {
+        return;
+    }
+    /* the first segment of the search starts at or after the delay, as in TrigTargCmdProc2 */
+    Tcl_Size first = LowerBound(x, NULL, 0, n - 1, crossPtr->delay);
+    CrossSearch search = {y, NULL, crossPtr->val, crossPtr->cond, NULL, GetKernel(configPtr)->crossMask};
+    Tcl_Size i;
+    if (crossPtr->count == -1) {
+        i = FindCrossing(configPtr, &search, first, n - 1, -1);
+    } else {
+        i = SearchCrossing(&search, first, n - 1, &crossPtr->left);
+    }
+    if (i >= 0) {
+        crossPtr->x = CalcXBetween(x[i], y[i], x[i + 1], y[i + 1], crossPtr->val);
+        crossPtr->found = 1;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FeedStreamWindow --
+ *
+ *      Feeds points to the window of a streamed measurement. The window opens in the segment that brackets its
+ *      start, found as in IntegSegments(), and closes in the first segment that reaches its end. The points inside
+ *      the window are summed once the next point is fed, the last fed segment is kept as the end of the window until
+ *      the window closes.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr - input: settings of the interpreter
+ *      StreamWindow *winPtr        - input/output: window
+ *      const double *x             - input: x values of the points
+ *      const double *y             - input: values of the vector of the window
+ *      Tcl_Size n                  - input: number of points
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void FeedStreamWindow(const MeasConfig *configPtr, StreamWindow *winPtr, const double *x, const double *y,
+                             Tcl_Size n) {
+    Tcl_Size p;
+    if (n < 2) {
+        /* the segment that joins a single point to the previous chunk was already fed */
+        return;
+    }
+    if (winPtr->state == WINDOW_BEFORE) {
+        Tcl_Size k = LowerBound(x, NULL, 1, n, winPtr->from);
+        if (k == n) {
+            return;
+        }
+        --k;
+        winPtr->xstart = winPtr->from;
+        winPtr->ystart = CalcYBetween(x[k], y[k], x[k + 1], y[k + 1], winPtr->xstart);
+        winPtr->sqStart = CalcYBetween(x[k], y[k] * y[k], x[k + 1], y[k + 1] * y[k + 1], winPtr->xstart);
+        winPtr->xc = winPtr->xstart;
+        winPtr->yc = winPtr->ystart;
+        winPtr->sqc = winPtr->sqStart;
+        winPtr->integ = winPtr->integSq = 0.0;
+        winPtr->min = winPtr->max = winPtr->ystart;
+        winPtr->minAt = winPtr->maxAt = winPtr->xstart;
+        winPtr->state = WINDOW_OPEN;
+        p = k + 1;
+    } else if (winPtr->state == WINDOW_OPEN) {
+        p = 0;
+    } else {
+        return;
+    }
+    Tcl_Size j = LowerBound(x, NULL, p, n, winPtr->to);
+    if (j < n) {
+        if (j > p) {
+            SumStreamWindow(configPtr, winPtr, x, y, p, j - 1);
+        }
+        winPtr->state = WINDOW_CLOSED;
+    } else {
+        j = n - 1;
+        if (j > p) {
+            SumStreamWindow(configPtr, winPtr, x, y, p, j - 1);
+        }
+    }
+    winPtr->xa = x[j - 1];
+    winPtr->ya = y[j - 1];
+    winPtr->xb = x[j];
+    winPtr->yb = y[j];
+    winPtr->xend = (winPtr->state == WINDOW_CLOSED) ? winPtr->to : winPtr->xb;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * SumStreamWindow --
+ *
+ *      Adds the points p..q to the integrals and extrema of an open window, with the segment that joins them to the
+ *      last summed point.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr - input: settings of the interpreter
+ *      StreamWindow *winPtr        - input/output: window
+ *      const double *x             - input: x values of the points
+ *      const double *y             - input: values of the vector of the window
+ *      Tcl_Size p                  - input: index of the first point to add
+ *      Tcl_Size q                  - input: index of the last point to add, q >= p
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      The extrema follow WindowExtrema(): when the window starts at NaN the positions stay at the start and the
+ *      values skip NaN.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void SumStreamWindow(const MeasConfig *configPtr, StreamWindow *winPtr, const double *x, const double *y,
+                            Tcl_Size p, Tcl_Size q) {
+    int nanStart = isnan(winPtr->ystart);
+    RangeScan scan;
+    scan.min = winPtr->min;
+    scan.max = winPtr->max;
+    scan.minIdx = scan.maxIdx = -1;
+    ScanRange(configPtr, x, y, p, q, nanStart ? SCAN_SUMS : SCAN_EXTREMA | SCAN_SUMS, &scan);
+    winPtr->integ += (winPtr->yc + y[p]) / 2.0 * (x[p] - winPtr->xc) + scan.sum / 2.0;
+    winPtr->integSq += (winPtr->sqc + y[p] * y[p]) / 2.0 * (x[p] - winPtr->xc) + scan.sumSq / 2.0;
+    if (nanStart) {
+        for (Tcl_Size i = p; i <= q; ++i) {
+            winPtr->min = fmin(winPtr->min, y[i]);
+            winPtr->max = fmax(winPtr->max, y[i]);
+        }
+    } else {
+        if (scan.minIdx >= 0) {
+            winPtr->min = scan.min;
+            winPtr->minAt = x[scan.minIdx];
+        }
+        if (scan.maxIdx >= 0) {
+            winPtr->max = scan.max;
+            winPtr->maxAt = x[scan.maxIdx];
+        }
+    }
+    winPtr->xc = x[q];
+    winPtr->yc = y[q];
+    winPtr->sqc = y[q] * y[q];
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StreamMeasResult --
+ *
+ *      Computes the result of a measurement of a stream over the data fed so far, the same value as the measurement
+ *      command returns for the fed data. A window that did not reach its end yet ends at the last fed point.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp          - input/output: interpreter for error reporting
+ *      const MeasStream *streamPtr - input: stream of the measurement
+ *      const StreamMeas *measPtr   - input: measurement
+ *
+ * Results:
+ *      New object with the result, or NULL with an error message in the interpreter if the crossing or the window was
+ *      not found in the fed data
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Obj *StreamMeasResult(Tcl_Interp *interp, const MeasStream *streamPtr, const StreamMeas *measPtr) {
+    static const char *const conditions[] = {"rise", "fall", "cross"};
+    if (measPtr->kind == STREAM_TRIGTARG) {
+        const StreamCross *crosses[] = {&measPtr->trig, &measPtr->targ};
+        for (int c = 0; c < 2; ++c) {
+            const StreamCross *crossPtr = crosses[c];
+            if (!crossPtr->found) {
+                Tcl_Obj *countObj = (crossPtr->count == -1) ? Tcl_NewStringObj("last", -1)
+                                                            : Tcl_NewWideIntObj(crossPtr->count);
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s value '%f' with conditions '%s %s delay=%f' was not found",
+                                                       (c == 0) ? "Trig" : "Targ", crossPtr->val,
+                                                       conditions[crossPtr->cond], Tcl_GetString(countObj),
+                                                       crossPtr->delay));
+                Tcl_DecrRefCount(countObj);
+                return NULL;
+            }
+        }
+        Tcl_Obj *result = Tcl_NewDictObj();
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtrig", -1), Tcl_NewDoubleObj(measPtr->trig.x));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtarg", -1), Tcl_NewDoubleObj(measPtr->targ.x));
+        Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xdelta", -1),
+                       Tcl_NewDoubleObj(measPtr->targ.x - measPtr->trig.x));
+        return result;
+    }
+    const StreamWindow *winPtr = &measPtr->window;
+    if ((winPtr->state == WINDOW_BEFORE) || (winPtr->state == WINDOW_MISSED)) {
+        if (measPtr->result == RESULT_FINDAT) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Value of the vector at '%f' was not found", winPtr->from));
+        } else if ((winPtr->state == WINDOW_BEFORE) && (streamPtr->fed > 0)) {
+            /* the start is not before the last fed point, which ends the window for now */
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the "
+                                                      "integration",
+                                                      -1));
+        } else {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Start of integration interval '%f' is outside the x values range",
+                                                   winPtr->from));
+        }
+        return NULL;
+    }
+    if (measPtr->result == RESULT_FINDAT) {
+        return Tcl_NewDoubleObj(winPtr->ystart);
+    }
+    double xstart = winPtr->xstart, xend = winPtr->xend;
+    if (!(xend > xstart)) {
+        Tcl_SetObjResult(
+            interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the integration", -1));
+        return NULL;
+    }
+    double yend = CalcYBetween(winPtr->xa, winPtr->ya, winPtr->xb, winPtr->yb, xend);
+    double sqEnd = CalcYBetween(winPtr->xa, winPtr->ya * winPtr->ya, winPtr->xb, winPtr->yb * winPtr->yb, xend);
+    double integ = winPtr->integ + (winPtr->yc + yend) / 2.0 * (xend - winPtr->xc);
+    double integSq = winPtr->integSq + (winPtr->sqc + sqEnd) / 2.0 * (xend - winPtr->xc);
+    MeasStats stats;
+    stats.avg = integ / (xend - xstart);
+    stats.rms = sqrt(integSq / (xend - xstart));
+    stats.min = fmin(winPtr->min, yend);
+    stats.max = fmax(winPtr->max, yend);
+    stats.pp = fabs(stats.min) + fabs(stats.max);
+    stats.minAt = (!isnan(winPtr->ystart) && (yend < winPtr->min)) ? xend : winPtr->minAt;
+    stats.maxAt = (!isnan(winPtr->ystart) && (yend > winPtr->max)) ? xend : winPtr->maxAt;
+    switch ((enum StreamResults)measPtr->result) {
+    case RESULT_INTEG:
+        return Tcl_NewDoubleObj(integ);
+    case RESULT_AVG:
+        return Tcl_NewDoubleObj(stats.avg);
+    case RESULT_RMS:
+        return Tcl_NewDoubleObj(stats.rms);
+    case RESULT_MIN:
+        return Tcl_NewDoubleObj(stats.min);
+    case RESULT_MAX:
+        return Tcl_NewDoubleObj(stats.max);
+    case RESULT_PP:
+        return Tcl_NewDoubleObj(stats.pp);
+    case RESULT_MINAT:
+        return Tcl_NewDoubleObj(stats.minAt);
+    case RESULT_MAXAT:
+        return Tcl_NewDoubleObj(stats.maxAt);
+    default:
+        break;
+    }
+    return NewStatsObj(&stats);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * RawfileCmdProc2 --
+ *
+ *      Implements `::tclmeasure::rawfile open path ?-plot index?`, maps an ngspice rawfile into memory and creates
+ *      the command `::tclmeasure::rawfileN` that gives access to one plot of the file (see RawHandleCmdProc2). Only
+ *      the header is parsed when a binary file is opened, the values of an ASCII plot are parsed at once into packed
+ *      vectors (see ParseRawValues()).
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = open
+ *          objv[2] = path   - path of the rawfile
+ *          objv[3] = -plot  - optional, selects the plot of a file with several ones
+ *          objv[4] = index  - 0-based index of the plot, 0 by default
+ *
+ * Results:
+ *      TCL_OK with the fully qualified name of the handle command in the interpreter result.
+ *      TCL_ERROR if the file can't be mapped, is not a rawfile, does not hold the plot or has invalid ASCII values.
+ *
+ * Side Effects:
+ *      Maps the file and creates the handle command, which owns the mapping until it is deleted.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int RawfileCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    static const char *const subcommands[] = {"open", NULL};
+    int sub, plot = 0;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "open path ?-plot index?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if ((objc != 3) && (objc != 5)) {
+        Tcl_WrongNumArgs(interp, 2, objv, "path ?-plot index?");
+        return TCL_ERROR;
+    }
+    if (objc == 5) {
+        if (strcmp(Tcl_GetString(objv[3]), "-plot")) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("bad option \"%s\": must be -plot", Tcl_GetString(objv[3])));
+            return TCL_ERROR;
+        }
+        if (Tcl_GetIntFromObj(interp, objv[4], &plot) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (plot < 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Plot index '%d' must not be negative", plot));
+            return TCL_ERROR;
+        }
+    }
+    MeasRawFile *rawPtr = (MeasRawFile *)Tcl_Alloc(sizeof(MeasRawFile));
+    rawPtr->refCount = 1;
+    rawPtr->token = NULL;
+    rawPtr->base = NULL;
+    rawPtr->size = 0;
+    rawPtr->columns = NULL;
+    rawPtr->vars = 0;
+    rawPtr->infoObj = NULL;
+    rawPtr->namesObj = NULL;
+    rawPtr->vecObjs = NULL;
+    Tcl_InitHashTable(&rawPtr->names, TCL_STRING_KEYS);
+    if (MapFile(interp, objv[2], &rawPtr->base, &rawPtr->size) != TCL_OK) {
+        ReleaseRawFile(rawPtr);
+        return TCL_ERROR;
+    }
+    if (rawPtr->base == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("'%s' is not an ngspice rawfile", Tcl_GetString(objv[2])));
+        ReleaseRawFile(rawPtr);
+        return TCL_ERROR;
+    }
+    if ((ParseRawHeader(interp, rawPtr, Tcl_GetString(objv[2]), plot) != TCL_OK) ||
+        (rawPtr->isAscii && (ParseRawValues(interp, configPtr, rawPtr, Tcl_GetString(objv[2])) != TCL_OK))) {
+        ReleaseRawFile(rawPtr);
+        return TCL_ERROR;
+    }
+    rawPtr->vecObjs = (Tcl_Obj **)Tcl_Alloc(sizeof(Tcl_Obj *) * rawPtr->vars);
+    memset(rawPtr->vecObjs, 0, sizeof(Tcl_Obj *) * rawPtr->vars);
+    /* skip names taken by other commands */
+    Tcl_Obj *nameObj;
+    Tcl_CmdInfo info;
+    do {
+        nameObj = Tcl_ObjPrintf("::tclmeasure::rawfile%ld", ++configPtr->files);
+        if (!Tcl_GetCommandInfo(interp, Tcl_GetString(nameObj), &info)) {
+            break;
+        }
+        Tcl_DecrRefCount(nameObj);
+    } while (1);
+    rawPtr->token = Tcl_CreateObjCommand2(interp, Tcl_GetString(nameObj), (Tcl_ObjCmdProc2 *)RawHandleCmdProc2, rawPtr,
+                                          DeleteRawHandle);
+    Tcl_SetObjResult(interp, nameObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * MapFile, UnmapFile --
+ *
+ *      Map a file read-only into memory, with mmap() or with a file mapping on Windows, and unmap it. Pages are read
+ *      from the file when they are first accessed, so opening a large file costs no reads.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      Tcl_Obj *pathObj          - input: path of the file
+ *      const char **basePtr      - output: start of the mapping, NULL for an empty file
+ *      size_t *sizePtr           - output: size of the file in bytes
+ *      const char *base          - input: mapping to unmap
+ *      size_t size               - input: size of the mapping
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the file can't be opened or mapped
+ *
+ * Side Effects:
+ *      Maps the file, the file itself is closed before returning
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int MapFile(Tcl_Interp *interp, Tcl_Obj *pathObj, const char **basePtr, size_t *sizePtr) {
+    const char *path = Tcl_GetString(pathObj);
+    Tcl_DString utf, native;
+    *basePtr = NULL;
+    *sizePtr = 0;
+    if (Tcl_TranslateFileName(interp, path, &utf) == NULL) {
+        return TCL_ERROR;
+    }
+    Tcl_UtfToExternalDString(NULL, Tcl_DStringValue(&utf), Tcl_DStringLength(&utf), &native);
+    Tcl_DStringFree(&utf);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(Tcl_DStringValue(&native), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    Tcl_DStringFree(&native);
+    if (file == INVALID_HANDLE_VALUE) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't open file '%s'", path));
+        return TCL_ERROR;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't open file '%s'", path));
+        return TCL_ERROR;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return TCL_OK;
+    }
+    /* the view keeps the mapping and the file open */
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    const void *base = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping != NULL) {
+        CloseHandle(mapping);
+    }
+    if (base == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't map file '%s'", path));
+        return TCL_ERROR;
+    }
+    *basePtr = (const char *)base;
+    *sizePtr = (size_t)size.QuadPart;
+#else
+    int fd = open(Tcl_DStringValue(&native), O_RDONLY);
+    Tcl_DStringFree(&native);
+    if (fd < 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't open file '%s': %s", path, Tcl_ErrnoMsg(errno)));
+        return TCL_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int statErrno = errno;
+        close(fd);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't open file '%s': %s", path, Tcl_ErrnoMsg(statErrno)));
+        return TCL_ERROR;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return TCL_OK;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int mapErrno = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Can't map file '%s': %s", path, Tcl_ErrnoMsg(mapErrno)));
+        return TCL_ERROR;
+    }
+    *basePtr = (const char *)base;
+    *sizePtr = (size_t)st.st_size;
+#endif
+    return TCL_OK;
+}
+
+static void UnmapFile(const char *base, size_t size) {
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+#else
+    munmap((void *)base, size);
+#endif
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ParseRawHeader --
+ *
+ *      Parses the headers of the plots of a mapped rawfile up to the requested plot. A header is made of "Key: value"
+ *      lines, "No. Variables" lines after "Variables:" describe the variables as "index name type", and the values
+ *      follow the "Binary:" line, all variables of the first point, then of the second point, and so on. The values
+ *      of an ASCII plot follow the "Values:" line as text, in the same order, each point starting with its index. The
+ *      data of the other plots is skipped, its size is given by their headers for binary plots, ASCII plots end at
+ *      the next "Title:" line.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasRawFile *rawPtr       - input/output: mapped file, gets the description of the plot
+ *      const char *path          - input: path of the file, for error messages
+ *      int plot                  - input: 0-based index of the plot
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if a header is malformed or the file holds fewer plots
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      A file that ends before all points of its last plot are written (an interrupted simulation) gives the
+ *      points that are complete. The number of points of an ASCII plot is checked by ParseRawValues().
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ParseRawHeader(Tcl_Interp *interp, MeasRawFile *rawPtr, const char *path, int plot) {
+    static const char *const keys[] = {"Title",      "Date",      "Plotname", "Flags",  "No. Variables",
+                                       "No. Points", "Variables", "Binary",   "Values", NULL};
+    static const char *const infoKeys[] = {"title", "date", "plotname", "flags"};
+    enum Keys {
+        KEY_TITLE,
+        KEY_DATE,
+        KEY_PLOTNAME,
+        KEY_FLAGS,
+        KEY_VARS,
+        KEY_POINTS,
+        KEY_VARIABLES,
+        KEY_BINARY,
+        KEY_VALUES
+    };
+    const char *pos = rawPtr->base, *end = rawPtr->base + rawPtr->size;
+    for (int p = 0;; ++p) {
+        Tcl_Obj *infoObj = Tcl_NewDictObj();
+        Tcl_Obj *namesObj = Tcl_NewListObj(0, NULL);
+        Tcl_Obj *typesObj = Tcl_NewListObj(0, NULL);
+        Tcl_WideInt vars = -1, points = -1;
+        int isComplex = 0, isAscii = 0;
+        const char *values = NULL, *malformed = NULL;
+        Tcl_IncrRefCount(infoObj);
+        Tcl_IncrRefCount(namesObj);
+        Tcl_IncrRefCount(typesObj);
+        for (int k = KEY_TITLE; k <= KEY_FLAGS; ++k) {
+            Tcl_DictObjPut(NULL, infoObj, Tcl_NewStringObj(infoKeys[k], -1), Tcl_NewObj());
+        }
+        while ((pos < end) && (values == NULL) && (malformed == NULL)) {
+            const char *line = pos;
+            const char *eol = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+            const char *lineEnd = (eol != NULL) ? eol : end;
+            pos = (eol != NULL) ? eol + 1 : end;
+            const char *colon = (const char *)memchr(line, ':', (size_t)(lineEnd - line));
+            int key;
+            if (colon == NULL) {
+                continue;
+            }
+            Tcl_Obj *keyObj = Tcl_NewStringObj(line, colon - line);
+            int known = (Tcl_GetIndexFromObjStruct(NULL, keyObj, keys, sizeof(char *), "key", TCL_EXACT, &key) ==
+                         TCL_OK);
+            Tcl_DecrRefCount(keyObj);
+            if (!known) {
+                continue;
+            }
+            const char *val = colon + 1, *valEnd = lineEnd;
+            while ((val < valEnd) && ((*val == ' ') || (*val == '\t'))) {
+                ++val;
+            }
+            while ((valEnd > val) && ((valEnd[-1] == ' ') || (valEnd[-1] == '\t') || (valEnd[-1] == '\r'))) {
+                --valEnd;
+            }
+            Tcl_Obj *valObj = Tcl_NewStringObj(val, valEnd - val);
+            Tcl_IncrRefCount(valObj);
+            switch ((enum Keys)key) {
+            case KEY_TITLE:
+            case KEY_DATE:
+            case KEY_PLOTNAME:
+            case KEY_FLAGS:
+                Tcl_DictObjPut(NULL, infoObj, Tcl_NewStringObj(infoKeys[key], -1), valObj);
+                if (key == KEY_FLAGS) {
+                    isComplex = (strstr(Tcl_GetString(valObj), "complex") != NULL);
+                }
+                break;
+            case KEY_VARS:
+                if ((Tcl_GetWideIntFromObj(NULL, valObj, &vars) != TCL_OK) || (vars <= 0)) {
+                    malformed = "invalid number of variables";
+                }
+                break;
+            case KEY_POINTS:
+                if ((Tcl_GetWideIntFromObj(NULL, valObj, &points) != TCL_OK) || (points < 0)) {
+                    malformed = "invalid number of points";
+                }
+                break;
+            case KEY_VARIABLES:
+                if (vars <= 0) {
+                    malformed = "variables are listed before their number";
+                    break;
+                }
+                /* the first variable may follow the colon */
+                if ((val == valEnd) && (pos < end)) {
+                    val = pos;
+                    eol = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+                    valEnd = (eol != NULL) ? eol : end;
+                    pos = (eol != NULL) ? eol + 1 : end;
+                }
+                for (Tcl_WideInt v = 0; v < vars; ++v) {
+                    if (ParseRawVariable(val, valEnd, namesObj, typesObj) != TCL_OK) {
+                        malformed = "invalid variable description";
+                        break;
+                    }
+                    if (v + 1 < vars) {
+                        if (pos >= end) {
+                            malformed = "missing variable descriptions";
+                            break;
+                        }
+                        val = pos;
+                        eol = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+                        valEnd = (eol != NULL) ? eol : end;
+                        pos = (eol != NULL) ? eol + 1 : end;
+                    }
+                }
+                break;
+            case KEY_BINARY:
+            case KEY_VALUES:
+                values = pos;
+                isAscii = (key == KEY_VALUES);
+                break;
+            }
+            Tcl_DecrRefCount(valObj);
+        }
+        Tcl_Size described;
+        Tcl_ListObjLength(NULL, namesObj, &described);
+        if ((malformed == NULL) && (values != NULL)) {
+            if ((vars <= 0) || (points < 0)) {
+                malformed = "missing number of variables or points";
+            } else if (described != vars) {
+                malformed = "missing variable descriptions";
+            }
+        }
+        if ((malformed != NULL) || (values == NULL)) {
+            Tcl_DecrRefCount(infoObj);
+            Tcl_DecrRefCount(namesObj);
+            Tcl_DecrRefCount(typesObj);
+            if (malformed != NULL) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Header of plot %d in rawfile '%s' is malformed: %s", p, path,
+                                                       malformed));
+            } else if (p == 0) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("'%s' is not an ngspice rawfile", path));
+            } else {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Rawfile '%s' has %d plots", path, p));
+            }
+            return TCL_ERROR;
+        }
+        size_t pointSize = (size_t)vars * (isComplex ? 2 : 1) * sizeof(double);
+        const char *valuesEnd;
+        if (isAscii) {
+            valuesEnd = FindPlotEnd(values, end);
+        } else {
+            Tcl_WideInt complete = (Tcl_WideInt)((size_t)(end - values) / pointSize);
+            if (points > complete) {
+                points = complete;
+            }
+            valuesEnd = values + (size_t)points * pointSize;
+        }
+        if (p == plot) {
+            rawPtr->values = values;
+            rawPtr->end = valuesEnd;
+            rawPtr->isAscii = isAscii;
+            rawPtr->points = (Tcl_Size)points;
+            rawPtr->vars = (Tcl_Size)vars;
+            rawPtr->isComplex = isComplex;
+            Tcl_DictObjPut(NULL, infoObj, Tcl_NewStringObj("points", -1), Tcl_NewWideIntObj(points));
+            Tcl_DictObjPut(NULL, infoObj, Tcl_NewStringObj("variables", -1), namesObj);
+            Tcl_DictObjPut(NULL, infoObj, Tcl_NewStringObj("types", -1), typesObj);
+            Tcl_DecrRefCount(typesObj);
+            rawPtr->infoObj = infoObj;
+            rawPtr->namesObj = namesObj;
+            Tcl_Obj **names;
+            Tcl_Size count;
+            Tcl_ListObjGetElements(NULL, namesObj, &count, &names);
+            for (Tcl_Size v = 0; v < count; ++v) {
+                int isNew;
+                Tcl_HashEntry *entryPtr = Tcl_CreateHashEntry(&rawPtr->names, Tcl_GetString(names[v]), &isNew);
+                if (isNew) {
+                    Tcl_SetHashValue(entryPtr, (void *)(size_t)v);
+                }
+            }
+            return TCL_OK;
+        }
+        Tcl_DecrRefCount(infoObj);
+        Tcl_DecrRefCount(namesObj);
+        Tcl_DecrRefCount(typesObj);
+        pos = valuesEnd;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ParseRawVariable --
+ *
+ *      Parses the description of a variable in a rawfile header, "index name type" separated by blanks, optionally
+ *      followed by other parameters that are ignored.
+ *
+ * Parameters:
+ *      const char *line          - input: start of the description
+ *      const char *end           - input: end of the line
+ *      Tcl_Obj *namesObj         - input/output: list that gets the name
+ *      Tcl_Obj *typesObj         - input/output: list that gets the type
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the name or the type is missing
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ParseRawVariable(const char *line, const char *end, Tcl_Obj *namesObj, Tcl_Obj *typesObj) {
+    const char *fields[3], *fieldEnds[3];
+    int count = 0;
+    while ((count < 3) && (line < end)) {
+        while ((line < end) && ((*line == ' ') || (*line == '\t') || (*line == '\r'))) {
+            ++line;
+        }
+        if (line == end) {
+            break;
+        }
+        fields[count] = line;
+        while ((line < end) && (*line != ' ') && (*line != '\t') && (*line != '\r')) {
+            ++line;
+        }
+        fieldEnds[count++] = line;
+    }
+    if (count < 3) {
+        return TCL_ERROR;
+    }
+    Tcl_ListObjAppendElement(NULL, namesObj, Tcl_NewStringObj(fields[1], fieldEnds[1] - fields[1]));
+    Tcl_ListObjAppendElement(NULL, typesObj, Tcl_NewStringObj(fields[2], fieldEnds[2] - fields[2]));
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ReleaseRawFile, DeleteRawHandle --
+ *
+ *      Release a reference to a rawfile, unmapping it with the last one. DeleteRawHandle is called when the handle
+ *      command is deleted, it releases the vectors kept by the handle and the reference of the handle, vectors that
+ *      were not read yet keep the file mapped.
+ *
+ * Parameters:
+ *      MeasRawFile *rawPtr       - input/output: rawfile
+ *      void *clientData          - input: pointer to the MeasRawFile of the handle
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      May unmap the file and free the rawfile
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ReleaseRawFile(MeasRawFile *rawPtr) {
+    if (--rawPtr->refCount > 0) {
+        return;
+    }
+    if (rawPtr->base != NULL) {
+        UnmapFile(rawPtr->base, rawPtr->size);
+    }
+    if (rawPtr->columns != NULL) {
+        for (Tcl_Size v = 0; v < rawPtr->vars; ++v) {
+            if (rawPtr->columns[v] != NULL) {
+                Tcl_Free((char *)rawPtr->columns[v]);
+            }
+        }
+        Tcl_Free((char *)rawPtr->columns);
+    }
+    if (rawPtr->infoObj != NULL) {
+        Tcl_DecrRefCount(rawPtr->infoObj);
+        Tcl_DecrRefCount(rawPtr->namesObj);
+    }
+    Tcl_DeleteHashTable(&rawPtr->names);
+    if (rawPtr->vecObjs != NULL) {
+        Tcl_Free((char *)rawPtr->vecObjs);
+    }
+    Tcl_Free((char *)rawPtr);
+}
+
+static void DeleteRawHandle(void *clientData) {
+    MeasRawFile *rawPtr = (MeasRawFile *)clientData;
+    rawPtr->token = NULL;
+    for (Tcl_Size v = 0; v < rawPtr->vars; ++v) {
+        if (rawPtr->vecObjs[v] != NULL) {
+            Tcl_DecrRefCount(rawPtr->vecObjs[v]);
+            rawPtr->vecObjs[v] = NULL;
+        }
+    }
+    ReleaseRawFile(rawPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * RawHandleCmdProc2 --
+ *
+ *      Implements the command of a rawfile opened by `::tclmeasure::rawfile open`:
+ *          $raw info          - returns a dictionary with keys title, date, plotname and flags from the header, points,
+ *                               variables (names) and types
+ *          $raw names         - returns the names of the variables
+ *          $raw vector name   - returns the values of a variable as a vector accepted by all measurement commands
+ *          $raw data ?names?  - returns a dictionary of the vectors of all or of the given variables, to be passed
+ *                               to `measure -data`
+ *          $raw close         - deletes the command
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the MeasRawFile
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments
+ *
+ * Results:
+ *      TCL_OK with the result of the subcommand; TCL_ERROR on invalid arguments or unknown variables.
+ *
+ * Side Effects:
+ *      close deletes the command.
+ *
+ * Notes:
+ *      Vectors are read from the mapped file when a command first uses them (see ReadRawVector()), so asking for
+ *      the data of a file with many variables costs nothing for the variables that are not measured. The same
+ *      object is returned for a variable every time, so the data read and the indexes built for it are shared by
+ *      all measurements. The real part is returned for complex variables.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int RawHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasRawFile *rawPtr = (MeasRawFile *)clientData;
+    static const char *const subcommands[] = {"info", "names", "vector", "data", "close", NULL};
+    enum Subcommands { SUB_INFO, SUB_NAMES, SUB_VECTOR, SUB_DATA, SUB_CLOSE };
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    switch ((enum Subcommands)sub) {
+    case SUB_INFO:
+    case SUB_NAMES:
+    case SUB_CLOSE:
+        if (objc != 2) {
+            Tcl_WrongNumArgs(interp, 2, objv, NULL);
+            return TCL_ERROR;
+        }
+        if (sub == SUB_CLOSE) {
+            Tcl_DeleteCommandFromToken(interp, rawPtr->token);
+        } else {
+            Tcl_SetObjResult(interp, (sub == SUB_INFO) ? rawPtr->infoObj : rawPtr->namesObj);
+        }
+        return TCL_OK;
+    case SUB_VECTOR: {
+        Tcl_Obj *vecObj;
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "name");
+            return TCL_ERROR;
+        }
+        if (GetRawVector(interp, rawPtr, objv[2], &vecObj) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        Tcl_SetObjResult(interp, vecObj);
+        return TCL_OK;
+    }
+    case SUB_DATA: {
+        Tcl_Size count;
+        Tcl_Obj **names;
+        if (objc > 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "?names?");
+            return TCL_ERROR;
+        }
+        if (Tcl_ListObjGetElements(interp, (objc == 3) ? objv[2] : rawPtr->namesObj, &count, &names) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        Tcl_Obj *dataDict = Tcl_NewDictObj();
+        for (Tcl_Size i = 0; i < count; ++i) {
+            Tcl_Obj *vecObj;
+            if (GetRawVector(interp, rawPtr, names[i], &vecObj) != TCL_OK) {
+                Tcl_DecrRefCount(dataDict);
+                return TCL_ERROR;
+            }
+            Tcl_DictObjPut(NULL, dataDict, names[i], vecObj);
+        }
+        Tcl_SetObjResult(interp, dataDict);
+        return TCL_OK;
+    }
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * GetRawVector --
+ *
+ *      Gets the vector of a variable of a rawfile, creating it on the first request. The vector of a binary plot is a
+ *      "measvector" object without values and without string representation, both are made from the mapped file
+ *      when first used. The vector of an ASCII plot takes the values parsed when the file was opened.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasRawFile *rawPtr       - input/output: rawfile, keeps the vector
+ *      Tcl_Obj *nameObj          - input: name of the variable
+ *      Tcl_Obj **vecObjPtr       - output: vector, owned by the rawfile
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the plot has no such variable
+ *
+ * Side Effects:
+ *      A new vector of a binary plot holds a reference to the rawfile until it is read
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int GetRawVector(Tcl_Interp *interp, MeasRawFile *rawPtr, Tcl_Obj *nameObj, Tcl_Obj **vecObjPtr) {
+    Tcl_HashEntry *entryPtr = Tcl_FindHashEntry(&rawPtr->names, Tcl_GetString(nameObj));
+    if (entryPtr == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Variable '%s' is not in the rawfile", Tcl_GetString(nameObj)));
+        return TCL_ERROR;
+    }
+    Tcl_Size v = (Tcl_Size)(size_t)Tcl_GetHashValue(entryPtr);
+    if (rawPtr->vecObjs[v] == NULL) {
+        Tcl_Obj *objPtr = Tcl_NewObj();
+        Tcl_ObjInternalRep ir;
+        MeasVectorRep *repPtr;
+        if (rawPtr->columns != NULL) {
+            repPtr = NewMeasVectorRep(rawPtr->columns[v], rawPtr->points);
+            rawPtr->columns[v] = NULL;
+        } else {
+            repPtr = NewMeasVectorRep(NULL, rawPtr->points);
+            repPtr->rawPtr = rawPtr;
+            repPtr->rawVar = v;
+            rawPtr->refCount++;
+        }
+        Tcl_InvalidateStringRep(objPtr);
+        ir.twoPtrValue.ptr1 = repPtr;
+        ir.twoPtrValue.ptr2 = NULL;
+        Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+        Tcl_IncrRefCount(objPtr);
+        rawPtr->vecObjs[v] = objPtr;
+    }
+    *vecObjPtr = rawPtr->vecObjs[v];
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ReadRawVector --
+ *
+ *      Reads the values of a rawfile variable from the mapped file into the packed array of its representation. The
+ *      values of a variable are one double (real part and imaginary part for complex plots) per point, with all
+ *      other variables of the point in between.
+ *
+ * Parameters:
+ *      MeasVectorRep *repPtr     - input/output: representation with rawPtr set, gets the data
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      Releases the reference of the representation to the rawfile
+ *
+ * Notes:
+ *      Values are copied with memcpy(), since the values of a binary rawfile follow a text header and are not
+ *      aligned. They are in the byte order of the machine that wrote the file.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void ReadRawVector(MeasVectorRep *repPtr) {
+    MeasRawFile *rawPtr = repPtr->rawPtr;
+    size_t valueSize = (rawPtr->isComplex ? 2 : 1) * sizeof(double);
+    size_t stride = (size_t)rawPtr->vars * valueSize;
+    const char *src = rawPtr->values + (size_t)repPtr->rawVar * valueSize;
+    double *data = (double *)Tcl_Alloc(sizeof(double) * (repPtr->len > 0 ? repPtr->len : 1));
+    for (Tcl_Size i = 0; i < repPtr->len; ++i) {
+        memcpy(&data[i], src + (size_t)i * stride, sizeof(double));
+    }
+    repPtr->data = data;
+    repPtr->rawPtr = NULL;
+    ReleaseRawFile(rawPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * FindPlotEnd --
+ *
+ *      Finds the end of the values of an ASCII plot in a rawfile, the start of the next line that begins with
+ *      "Title:", which starts the header of the next plot.
+ *
+ * Parameters:
+ *      const char *pos           - input: first value of the plot
+ *      const char *end           - input: end of the file
+ *
+ * Results:
+ *      Start of the header of the next plot, `end` for the last plot
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static const char *FindPlotEnd(const char *pos, const char *end) {
+    while (pos < end) {
+        if (((size_t)(end - pos) >= 6) && !memcmp(pos, "Title:", 6)) {
+            return pos;
+        }
+        const char *eol = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+        pos = (eol != NULL) ? eol + 1 : end;
+    }
+    return end;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * ParseRawValues --
+ *
+ *      Parses the values of an ASCII plot into one packed array per variable. Each point is written as its index
+ *      followed by the values of all variables, separated by blanks and newlines, a complex value as "real,imag".
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, gives the number of threads
+ *      MeasRawFile *rawPtr       - input/output: rawfile with the plot found by ParseRawHeader(), gets the columns
+ *      const char *path          - input: path of the file, for error messages
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if a value is not a number
+ *
+ * Side Effects:
+ *      Allocates the columns, sets the number of points to the complete points of the plot
+ *
+ * Notes:
+ *      The real part is kept for complex variables, like for binary plots. See CountTextTokens() for how the text is
+ *      split between threads.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int ParseRawValues(Tcl_Interp *interp, const MeasConfig *configPtr, MeasRawFile *rawPtr, const char *path) {
+    TextChunks job;
+    job.text = rawPtr->values;
+    job.len = (size_t)(rawPtr->end - rawPtr->values);
+    job.commas = 0;
+    job.rows = 0;
+    job.stride = rawPtr->vars + 1;
+    Tcl_WideInt complete = CountTextTokens(configPtr, &job) / job.stride;
+    if (rawPtr->points > complete) {
+        rawPtr->points = (Tcl_Size)complete;
+        Tcl_DictObjPut(NULL, rawPtr->infoObj, Tcl_NewStringObj("points", -1), Tcl_NewWideIntObj(complete));
+    }
+    job.points = rawPtr->points;
+    rawPtr->columns = (double **)Tcl_Alloc(sizeof(double *) * rawPtr->vars);
+    job.columns = (double **)Tcl_Alloc(sizeof(double *) * job.stride);
+    /* the index of the point is not kept */
+    job.columns[0] = NULL;
+    for (Tcl_Size v = 0; v < rawPtr->vars; ++v) {
+        rawPtr->columns[v] = (double *)Tcl_Alloc(sizeof(double) * (rawPtr->points > 0 ? rawPtr->points : 1));
+        job.columns[v + 1] = rawPtr->columns[v];
+    }
+    int status = StoreTextTokens(interp, configPtr, &job, path);
+    Tcl_Free((char *)job.columns);
+    return status;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * IsTextSeparator, ParseTextNumber --
+ *
+ *      Split numbers written as text. Numbers are separated by blanks and newlines, and by commas and semicolons in
+ *      tables. ParseTextNumber() converts the number that starts at `p`, up to the next separator or comma, so only
+ *      the real part of a complex value "real,imag" of a rawfile is read.
+ *
+ * Parameters:
+ *      char c                    - input: character
+ *      int commas                - input: commas and semicolons separate numbers
+ *      const char *p             - input: start of the number
+ *      const char *end           - input: end of the text
+ *      double *valPtr            - output: value of the number
+ *
+ * Results:
+ *      IsTextSeparator: nonzero if `c` separates numbers
+ *      ParseTextNumber: nonzero if the text up to the separator is a valid number
+ *
+ * Side Effects:
+ *      None
+ *
+ * Notes:
+ *      Numbers are converted with Tcl_GetDouble() from a copy, the text is not terminated. Unlike strtod(), it
+ *      always reads a decimal point, whatever the locale of the process.
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static inline int IsTextSeparator(char c, int commas) {
+    return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') || (commas && ((c == ',') || (c == ';')));
+}
+
+static int ParseTextNumber(const char *p, const char *end, double *valPtr) {
+    char buf[64];
+    size_t n = 0;
+    while ((p + n < end) && (p[n] != ',') && !IsTextSeparator(p[n], 1)) {
+        if (n == sizeof(buf) - 1) {
+            return 0;
+        }
+        buf[n] = p[n];
+        ++n;
+    }
+    buf[n] = '\0';
+    return (n > 0) && (Tcl_GetDouble(NULL, buf, valPtr) == TCL_OK);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * CountTextTokens, CountTokensProc --
+ *
+ *      Splits a text into chunks of at least MEAS_TEXT_CHUNK_MIN bytes for the threads configured in the interpreter
+ *      and counts the numbers that start in each chunk. A chunk that starts in the middle of a number leaves it to
+ *      the previous chunk. The counts give the index of the first number of each chunk, so StoreTextTokens() can
+ *      then convert all chunks in parallel, each number to its row and column.
+ *
+ * Parameters:
+ *      const MeasConfig *configPtr  - input: settings of the interpreter, gives the number of threads
+ *      TextChunks *jobPtr        - input/output: text, len and commas set, gets the chunks, counts and firsts
+ *      void *clientData          - input: TextChunks of the job
+ *      int chunk                 - input: chunk to count
+ *
+ * Results:
+ *      CountTextTokens: number of numbers in the text
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_WideInt CountTextTokens(const MeasConfig *configPtr, TextChunks *jobPtr) {
+    size_t minChunks = jobPtr->len / MEAS_TEXT_CHUNK_MIN;
+    int chunks = configPtr->threads;
+    if (minChunks < (size_t)chunks) {
+        chunks = (int)minChunks;
+    }
+    if (chunks < 1) {
+        chunks = 1;
+    }
+    jobPtr->chunks = chunks;
+    for (int c = 0; c <= chunks; ++c) {
+        jobPtr->bounds[c] = (size_t)((Tcl_WideUInt)jobPtr->len * c / chunks);
+    }
+    if (chunks == 1) {
+        CountTokensProc(jobPtr, 0);
+    } else {
+        RunChunks(chunks, CountTokensProc, jobPtr);
+    }
+    Tcl_WideInt total = 0;
+    for (int c = 0; c < chunks; ++c) {
+        jobPtr->firsts[c] = total;
+        total += jobPtr->counts[c];
+    }
+    return total;
+}
+
+static void CountTokensProc(void *clientData, int chunk) {
+    TextChunks *jobPtr = (TextChunks *)clientData;
+    const char *text = jobPtr->text, *stop = text + jobPtr->len;
+    const char *p = text + jobPtr->bounds[chunk], *end = text + jobPtr->bounds[chunk + 1];
+    int commas = jobPtr->commas;
+    Tcl_WideInt count = 0;
+    if ((p > text) && !IsTextSeparator(p[-1], commas)) {
+        while ((p < end) && !IsTextSeparator(*p, commas)) {
+            ++p;
+        }
+    }
+    while (p < end) {
+        if (IsTextSeparator(*p, commas)) {
+            ++p;
+            continue;
+        }
+        ++count;
+        while ((p < stop) && !IsTextSeparator(*p, commas)) {
+            ++p;
+        }
+    }
+    jobPtr->counts[chunk] = count;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * StoreTextTokens, StoreTokensProc --
+ *
+ *      Converts the numbers of the chunks counted by CountTextTokens() in parallel. Number k goes to row k / stride
+ *      of column k % stride, columns that are NULL are skipped without conversion, and numbers after the last of the
+ *      `points` rows are ignored. With `rows` set each line must hold whole rows, so a number that starts a line
+ *      must start a row and the other way round.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      const MeasConfig *configPtr  - input: settings of the interpreter (unused, the chunks are those of the count)
+ *      TextChunks *jobPtr        - input/output: counted job with stride, points and columns set
+ *      const char *path          - input: path of the file, for error messages
+ *      void *clientData          - input: TextChunks of the job
+ *      int chunk                 - input: chunk to convert
+ *
+ * Results:
+ *      StoreTextTokens: TCL_OK on success; TCL_ERROR if a number is invalid or the rows are ragged
+ *
+ * Side Effects:
+ *      Fills the columns
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int StoreTextTokens(Tcl_Interp *interp, const MeasConfig *configPtr, TextChunks *jobPtr, const char *path) {
+    if (jobPtr->chunks == 1) {
+        StoreTokensProc(jobPtr, 0);
+    } else {
+        RunChunks(jobPtr->chunks, StoreTokensProc, jobPtr);
+    }
+    /* the first error of the text is reported */
+    for (int c = 0; c < jobPtr->chunks; ++c) {
+        const char *invalid = jobPtr->invalid[c], *ragged = jobPtr->ragged[c];
+        if ((ragged != NULL) && ((invalid == NULL) || (ragged < invalid))) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Rows of '%s' don't all have %ld columns", path,
+                                                   (long)jobPtr->stride));
+            return TCL_ERROR;
+        }
+        if (invalid != NULL) {
+            const char *tokenEnd = invalid, *end = jobPtr->text + jobPtr->len;
+            while ((tokenEnd < end) && (tokenEnd - invalid < 64) && !IsTextSeparator(*tokenEnd, jobPtr->commas)) {
+                ++tokenEnd;
             }
-        }
-        if (trigVecFoundFlag && targVecFoundFlag) {
-            break;
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Value '%.*s' in '%s' is not a number", (int)(tokenEnd - invalid),
+                                                   invalid, path));
+            return TCL_ERROR;
         }
     }
-    if ((trigVecCondCount == -1) && lastTrigHitSet) {
-        trigVecFoundFlag = 1;
-        xTrig = CalcXBetween(lastTrigHit[0], lastTrigHit[1], lastTrigHit[2], lastTrigHit[3], val1);
+    return TCL_OK;
+}
+
+static void StoreTokensProc(void *clientData, int chunk) {
+    TextChunks *jobPtr = (TextChunks *)clientData;
+    const char *text = jobPtr->text, *stop = text + jobPtr->len;
+    const char *p = text + jobPtr->bounds[chunk], *end = text + jobPtr->bounds[chunk + 1];
+    int commas = jobPtr->commas;
+    Tcl_WideInt k = jobPtr->firsts[chunk];
+    Tcl_WideInt last = (Tcl_WideInt)jobPtr->points * jobPtr->stride;
+    Tcl_Size col = (Tcl_Size)(k % jobPtr->stride), row = (Tcl_Size)(k / jobPtr->stride);
+    jobPtr->invalid[chunk] = NULL;
+    jobPtr->ragged[chunk] = NULL;
+    /* a number starts a line if only separators and a newline precede it */
+    const char *q = p;
+    while ((q > text) && IsTextSeparator(q[-1], commas) && (q[-1] != '\n')) {
+        --q;
     }
-    if ((targVecCondCount == -1) && lastTargHitSet) {
-        targVecFoundFlag = 1;
-        xTarg = CalcXBetween(lastTargHit[0], lastTargHit[1], lastTargHit[2], lastTargHit[3], val2);
+    int lineStart = (q == text) || (q[-1] == '\n');
+    if ((p > text) && !IsTextSeparator(p[-1], commas)) {
+        while ((p < end) && !IsTextSeparator(*p, commas)) {
+            ++p;
+        }
     }
-    if (!trigVecFoundFlag) {
-        const char *condition;
-        const char *vecCondCount;
-        switch ((enum Conditions)trigVecCond) {
-        case COND_RISE:
-            condition = "rise";
-            break;
-        case COND_FALL:
-            condition = "fall";
-            break;
-        case COND_CROSS:
-            condition = "cross";
-            break;
-        };
-        if (trigVecCondCount == -1) {
-            vecCondCount = "last";
-        } else {
-            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(trigVecCondCount));
+    while ((p < end) && (k < last)) {
+        if (IsTextSeparator(*p, commas)) {
+            lineStart |= (*p == '\n');
+            ++p;
+            continue;
         }
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Trig value '%f' with conditions '%s %s delay=%f' was not found", val1,
-                                          condition, vecCondCount, trigVecDelay);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else if (!targVecFoundFlag) {
-        const char *condition;
-        const char *vecCondCount;
-        switch ((enum Conditions)targVecCond) {
-        case COND_RISE:
-            condition = "rise";
-            break;
-        case COND_FALL:
-            condition = "fall";
-            break;
-        case COND_CROSS:
-            condition = "cross";
-            break;
-        };
-        if (targVecCondCount == -1) {
-            vecCondCount = "last";
-        } else {
-            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(targVecCondCount));
+        if (jobPtr->rows && (lineStart != (col == 0))) {
+            jobPtr->ragged[chunk] = p;
+            return;
+        }
+        double *column = jobPtr->columns[col];
+        if ((column != NULL) && !ParseTextNumber(p, stop, &column[row])) {
+            jobPtr->invalid[chunk] = p;
+            return;
+        }
+        lineStart = 0;
+        ++k;
+        if (++col == jobPtr->stride) {
+            col = 0;
+            ++row;
+        }
+        while ((p < stop) && !IsTextSeparator(*p, commas)) {
+            ++p;
         }
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Targ value '%f' with conditions '%s %s delay=%f' was not found", val2,
-                                          condition, vecCondCount, targVecDelay);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
     }
-    Tcl_Obj *result = Tcl_NewDictObj();
-    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtrig", -1), Tcl_NewDoubleObj(xTrig));
-    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xtarg", -1), Tcl_NewDoubleObj(xTarg));
-    Tcl_DictObjPut(interp, result, Tcl_NewStringObj("xdelta", -1), Tcl_NewDoubleObj(xTarg - xTrig));
-    Tcl_SetObjResult(interp, result);
-    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * FindDerivWhenCmdProc2 --
+ * ReadTableCmdProc2 --
  *
- *      Implements a Tcl command to evaluate time-domain vector conditions (rise/fall/crossing) over one or more
- *      time-aligned signals. Depending on the selected mode, it returns either the time (`xWhen`) of a matching
- *      condition, the corresponding value from a secondary signal (`yFind`), or the derivative at the matched time.
- *      The function supports flexible condition targeting via explicit index, "last", or "all" modes.
+ *      Implements `::tclmeasure::readtable path ?-names list?`, reads a table of numbers written by ngspice `wrdata`
+ *      or as CSV into packed vectors, one per column. Numbers are separated by blanks, commas or semicolons, each
+ *      line holds one row. A first line that does not start with a number is a header with the names of the
+ *      columns, quotes around them are removed. Without header the columns are named by their 0-based index.
  *
  * Parameters:
- *      void *clientData              - input: optional user data (unused)
- *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
  *      Tcl_Size objc                 - input: number of command arguments
  *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
  *
- *          objv[1]  = x              - list of X (time) values
- *          objv[2]  = mode           - one of: when, wheneq, findwhen, findwheneq, derivwhen, derivwheneq
- *          objv[3]  = findVec        - list of values used for yFind or derivative computations
- *          objv[4]  = whenVecLS      - left-side comparison signal for condition detection
- *          objv[5]  = val            - scalar threshold for single-vector comparisons
- *          objv[6]  = whenVecRS      - right-side signal (used for equality/cross-vector mode)
- *          objv[7]  = whenVecCond    - condition: "rise", "fall", or "cross"
- *          objv[8]  = whenVecCondCount - index (1-based), "last", or "all" occurrence of condition to use
- *          objv[9]  = delay          - minimum X before any condition is considered
- *          objv[10] = from           - inclusive range start for evaluation
- *          objv[11] = to             - inclusive range end for evaluation
+ *          objv[1] = path   - path of the table
+ *          objv[2] = -names - optional, names of the columns, replace the names of the header
+ *          objv[3] = list   - one name per column
  *
  * Results:
- *      TCL_OK on success, with interpreter result set to:
- *        - list of xWhen values       (mode: "when", "wheneq")
- *        - list of interpolated yFind (mode: "findwhen", "findwheneq")
- *        - list of derivatives        (mode: "derivwhen", "derivwheneq")
- *
- *      TCL_ERROR on failure (e.g. invalid arguments, mismatched vector lengths, no match found).
+ *      TCL_OK with a dictionary of the column vectors by name, to be passed to `measure -data`.
+ *      TCL_ERROR if the file can't be read, is empty, has a value that is not a number or rows of different lengths.
  *
  * Side Effects:
- *      May allocate and populate Tcl lists (`xWhenObj`, `yFindObj`, `derYObj`) as return values.
- *      Sets interpreter result to descriptive error messages if validation or detection fails.
+ *      None, the file is mapped while it is read
  *
  * Notes:
- *      - Matching is performed on (x, value) pairs from `whenVecLS` and optionally `whenVecRS`.
- *      - Linear interpolation is used to find exact crossing points (`CalcXBetween`, `CalcCrossPoint`).
- *      - Derivative estimation uses 3-point stencil via `DerivSelect()` and `Deriv()` with positional logic.
- *      - "last" uses the most recent matching event, "all" accumulates all matching times and values.
- *      - For `wheneq`, a cross-condition between `whenVecLS` and `whenVecRS` is evaluated.
- *      - Derivative results are aligned with crossing points and interpolated values.
+ *      A column whose name was already used is skipped: `wrdata` writes the scale before every vector, so only the
+ *      first copy is kept. The text is split between the threads set with `configure -threads` for large files (see
+ *      CountTextTokens()).
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int FindDerivWhenCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
-    double lastWhenHit[4] = {0.0, 0.0, 0.0, 0.0};
-    int lastWhenHitSet = 0;
-    double lastWhenHitCross[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-    int lastWhenHitCrossSet = 0;
-    double lastFindWhenHit[4] = {0.0, 0.0, 0.0, 0.0};
-    double lastDerYWhenHit[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-    int lastDerYWhenHitPos;
-    int xWhenSet = 0;
-    Tcl_Obj *xWhenObj = Tcl_NewListObj(0, NULL);
-    Tcl_Obj *yFindObj = Tcl_NewListObj(0, NULL);
-    Tcl_Obj *derYObj = Tcl_NewListObj(0, NULL);
-
-    if (objc != 12) {
-        Tcl_WrongNumArgs(interp, 11, objv,
-                         "x mode findVec whenVecLS val whenVecRS whenVecCond whenVecCondCount delay from to");
-        return TCL_ERROR;
-    }
-    Tcl_Obj *xVec = objv[1];
-    int mode;
-    if (Tcl_GetIndexFromObj(NULL, objv[2], FindDerivWhenSwitches, "mode", 0, &mode) != TCL_OK) {
+static int ReadTableCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    Tcl_Obj *namesObj = NULL;
+    if ((objc != 2) && (objc != 4)) {
+        Tcl_WrongNumArgs(interp, 1, objv, "path ?-names list?");
         return TCL_ERROR;
     }
-    Tcl_Obj *findVec = objv[3];
-    Tcl_Obj *whenVecLS = objv[4];
-    double val;
-    Tcl_GetDoubleFromObj(interp, objv[5], &val);
-    Tcl_Obj *whenVecRS = objv[6];
-    int whenVecCond;
-    if (!strcmp(Tcl_GetString(objv[7]), "rise")) {
-        whenVecCond = COND_RISE;
-    } else if (!strcmp(Tcl_GetString(objv[7]), "fall")) {
-        whenVecCond = COND_FALL;
-    } else {
-        whenVecCond = COND_CROSS;
-    }
-    Tcl_WideInt whenVecCondCount;
-    if (!strcmp(Tcl_GetString(objv[8]), "last")) {
-        whenVecCondCount = -1;
-    } else if (!strcmp(Tcl_GetString(objv[8]), "all")) {
-        whenVecCondCount = -2;
-    } else {
-        Tcl_GetWideIntFromObj(interp, objv[8], &whenVecCondCount);
-    }
-    double delay;
-    Tcl_GetDoubleFromObj(interp, objv[9], &delay);
-    double from;
-    Tcl_GetDoubleFromObj(interp, objv[10], &from);
-    double to;
-    Tcl_GetDoubleFromObj(interp, objv[11], &to);
-
-    Tcl_Size xLen, findVecLen, whenVecLSLen, whenVecRSLen;
-    Tcl_Obj **xVecElems, **findVecElems, **whenVecLSElems, **whenVecRSElems;
-    if (Tcl_ListObjGetElements(interp, xVec, &xLen, &xVecElems) == TCL_ERROR) {
-        return TCL_ERROR;
+    if (objc == 4) {
+        if (strcmp(Tcl_GetString(objv[2]), "-names")) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("bad option \"%s\": must be -names", Tcl_GetString(objv[2])));
+            return TCL_ERROR;
+        }
+        namesObj = objv[3];
     }
-    if (Tcl_ListObjGetElements(interp, findVec, &findVecLen, &findVecElems) == TCL_ERROR) {
+    const char *path = Tcl_GetString(objv[1]);
+    const char *base;
+    size_t size;
+    if (MapFile(interp, objv[1], &base, &size) != TCL_OK) {
         return TCL_ERROR;
     }
-    if (Tcl_ListObjGetElements(interp, whenVecLS, &whenVecLSLen, &whenVecLSElems) == TCL_ERROR) {
-        return TCL_ERROR;
+    const char *pos = base, *end = base + size;
+    while ((pos < end) && IsTextSeparator(*pos, 1)) {
+        ++pos;
     }
-    if (Tcl_ListObjGetElements(interp, whenVecRS, &whenVecRSLen, &whenVecRSElems) == TCL_ERROR) {
+    if (pos == end) {
+        if (base != NULL) {
+            UnmapFile(base, size);
+        }
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Table '%s' is empty", path));
         return TCL_ERROR;
     }
-    if ((mode == FDW_SWITCH_WHEN) || (mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHEN) ||
-        (mode == FDW_SWITCH_FINDWHENEQ)) {
-        if (xLen != whenVecLSLen) {
-            Tcl_Obj *errorMsg =
-                Tcl_ObjPrintf("Length of x '%ld' is not equal to length of whenVecLS '%ld'", xLen, whenVecLSLen);
-            Tcl_SetObjResult(interp, errorMsg);
-            return TCL_ERROR;
+    /* the fields of the first line give the number of columns and maybe their names */
+    const char *eol = (const char *)memchr(pos, '\n', (size_t)(end - pos));
+    const char *lineEnd = (eol != NULL) ? eol : end;
+    double first;
+    int header = !ParseTextNumber(pos, lineEnd, &first);
+    Tcl_Obj *fieldsObj = Tcl_NewListObj(0, NULL);
+    Tcl_IncrRefCount(fieldsObj);
+    for (const char *p = pos; p < lineEnd;) {
+        if (IsTextSeparator(*p, 1)) {
+            ++p;
+            continue;
         }
-    }
-    if ((mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHENEQ) || (mode == FDW_SWITCH_DERIVWHENEQ)) {
-        if (xLen != whenVecRSLen) {
-            Tcl_Obj *errorMsg =
-                Tcl_ObjPrintf("Length of x '%ld' is not equal to length of whenVecRS '%ld'", xLen, whenVecRSLen);
-            Tcl_SetObjResult(interp, errorMsg);
-            return TCL_ERROR;
+        const char *field = p;
+        while ((p < lineEnd) && !IsTextSeparator(*p, 1)) {
+            ++p;
         }
-    }
-    if ((mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_DERIVWHEN)) {
-        if (xLen != findVecLen) {
-            Tcl_Obj *errorMsg =
-                Tcl_ObjPrintf("Length of x '%ld' is not equal to length of findVec '%ld'", xLen, findVecLen);
-            Tcl_SetObjResult(interp, errorMsg);
-            return TCL_ERROR;
+        const char *fieldEnd = p;
+        if ((fieldEnd - field >= 2) && (*field == '"') && (fieldEnd[-1] == '"')) {
+            ++field;
+            --fieldEnd;
         }
+        Tcl_ListObjAppendElement(NULL, fieldsObj, Tcl_NewStringObj(field, fieldEnd - field));
     }
-    Tcl_WideInt whenVecCount = 0;
-    int whenVecFoundFlag = 0;
-    double xWhen, yFind, derY;
-    if ((mode == FDW_SWITCH_WHEN) || (mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_DERIVWHEN)) {
-        for (Tcl_Size i = 0; i < whenVecLSLen - 1; ++i) {
-            double xi;
-            Tcl_GetDoubleFromObj(interp, xVecElems[i], &xi);
-            if ((xi < (from + delay)) || (xi > to)) {
-                continue;
-            }
-            double xip1, whenVecLSI, whenVecLSIp1;
-            Tcl_GetDoubleFromObj(interp, xVecElems[i + 1], &xip1);
-            Tcl_GetDoubleFromObj(interp, whenVecLSElems[i], &whenVecLSI);
-            Tcl_GetDoubleFromObj(interp, whenVecLSElems[i + 1], &whenVecLSIp1);
-            if (!whenVecFoundFlag) {
-                int result;
-                switch ((enum Conditions)whenVecCond) {
-                case COND_RISE:
-                    if ((whenVecLSI <= val) && (whenVecLSIp1 > val)) {
-                        result = 1;
-                    } else {
-                        result = 0;
-                    }
-                    break;
-                case COND_FALL:
-                    if ((whenVecLSI >= val) && (whenVecLSIp1 < val)) {
-                        result = 1;
-                    } else {
-                        result = 0;
-                    }
-                    break;
-                case COND_CROSS:
-                    if (((whenVecLSI <= val) && (whenVecLSIp1 > val)) ||
-                        ((whenVecLSI >= val) && (whenVecLSIp1 < val))) {
-                        result = 1;
-                    } else {
-                        result = 0;
-                    }
-                    break;
-                };
-                if (result) {
-                    whenVecCount++;
-                    if (whenVecCondCount == -1) {
-                        xWhen = CalcXBetween(xi, whenVecLSI, xip1, whenVecLSIp1, val);
-                        xWhenSet = 1;
-                        lastWhenHit[0] = xi;
-                        lastWhenHit[1] = whenVecLSI;
-                        lastWhenHit[2] = xip1;
-                        lastWhenHit[3] = whenVecLSIp1;
-                        lastWhenHitSet = 1;
-                        if (mode == FDW_SWITCH_FINDWHEN) {
-                            lastFindWhenHit[0] = xi;
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i], &lastFindWhenHit[1]);
-                            lastFindWhenHit[2] = xip1;
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &lastFindWhenHit[3]);
-                        } else if (mode == FDW_SWITCH_DERIVWHEN) {
-                            double findVecElemITemp;
-                            double findVecElemIp1Temp;
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                            double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                            DerivSelect(interp, i, xi, xWhen, xip1, xLen, xVecElems, findVecElems, yDeriv,
-                                        lastDerYWhenHit, &lastDerYWhenHitPos);
-                        }
-                    } else if (whenVecCondCount == -2) {
-                        double xWhenLoc = CalcXBetween(xi, whenVecLSI, xip1, whenVecLSIp1, val);
-                        Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhenLoc));
-                        xWhenSet = 1;
-                        if (mode == FDW_SWITCH_FINDWHEN) {
-                            double findVecElemITemp;
-                            double findVecElemIp1Temp;
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                            double yFindLoc = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhenLoc);
-                            Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFindLoc));
-                        } else if (mode == FDW_SWITCH_DERIVWHEN) {
-                            double findVecElemITemp;
-                            double findVecElemIp1Temp;
-                            double derivDataTemp[6];
-                            int derivPosTemp;
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                            Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                            double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhenLoc);
-                            DerivSelect(interp, i, xi, xWhenLoc, xip1, xLen, xVecElems, findVecElems, yDeriv,
-                                        derivDataTemp, &derivPosTemp);
-                            double derYLoc = Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2],
-                                                   derivDataTemp[3], derivDataTemp[4], derivDataTemp[5], derivPosTemp);
-                            Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derYLoc));
-                        }
-                    }
-                }
-            }
-            if ((whenVecCondCount != -2) && (whenVecCondCount != -1)) {
-                if ((whenVecCount == whenVecCondCount) && !whenVecFoundFlag) {
-                    whenVecFoundFlag = 1;
-                    xWhen = CalcXBetween(xi, whenVecLSI, xip1, whenVecLSIp1, val);
-                    Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhen));
-                    xWhenSet = 1;
-                    if (mode == FDW_SWITCH_FINDWHEN) {
-                        double findVecElemITemp;
-                        double findVecElemIp1Temp;
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                        yFind = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                        Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFind));
-                    } else if (mode == FDW_SWITCH_DERIVWHEN) {
-                        double findVecElemITemp;
-                        double findVecElemIp1Temp;
-                        double derivDataTemp[6];
-                        int derivPosTemp;
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                        double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                        DerivSelect(interp, i, xi, xWhen, xip1, xLen, xVecElems, findVecElems, yDeriv, derivDataTemp,
-                                    &derivPosTemp);
-                        derY = Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2], derivDataTemp[3],
-                                     derivDataTemp[4], derivDataTemp[5], derivPosTemp);
-                        Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derY));
-                    }
-                    break;
-                }
+    Tcl_Size cols;
+    Tcl_ListObjLength(NULL, fieldsObj, &cols);
+    if (header) {
+        pos = lineEnd;
+    }
+    if (namesObj == NULL) {
+        if (!header) {
+            Tcl_SetListObj(fieldsObj, 0, NULL);
+            for (Tcl_Size c = 0; c < cols; ++c) {
+                Tcl_ListObjAppendElement(NULL, fieldsObj, Tcl_ObjPrintf("%ld", (long)c));
             }
         }
-    } else if ((mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHENEQ) || (mode == FDW_SWITCH_DERIVWHENEQ)) {
-        for (Tcl_Size i = 0; i < whenVecLSLen - 1; ++i) {
-            double xi;
-            Tcl_GetDoubleFromObj(interp, xVecElems[i], &xi);
-            if ((xi < (from + delay)) || (xi > to)) {
-                continue;
-            }
-            double xip1, whenVecLSI, whenVecLSIp1, whenVecRSI, whenVecRSIp1;
-            Tcl_GetDoubleFromObj(interp, xVecElems[i + 1], &xip1);
-            Tcl_GetDoubleFromObj(interp, whenVecLSElems[i], &whenVecLSI);
-            Tcl_GetDoubleFromObj(interp, whenVecLSElems[i + 1], &whenVecLSIp1);
-            Tcl_GetDoubleFromObj(interp, whenVecRSElems[i], &whenVecRSI);
-            Tcl_GetDoubleFromObj(interp, whenVecRSElems[i + 1], &whenVecRSIp1);
-            if (!whenVecFoundFlag) {
-                // check two lines crossing
-                if (((whenVecLSI >= whenVecRSI) && (whenVecLSIp1 <= whenVecRSIp1)) ||
-                    ((whenVecLSI <= whenVecRSI) && (whenVecLSIp1 >= whenVecRSIp1))) {
-                    int result;
-                    switch ((enum Conditions)whenVecCond) {
-                    case COND_RISE:
-                        if (whenVecLSI < whenVecLSIp1) {
-                            result = 1;
-                        } else {
-                            result = 0;
-                        }
-                        break;
-                    case COND_FALL:
-                        if (whenVecLSI > whenVecLSIp1) {
-                            result = 1;
-                        } else {
-                            result = 0;
-                        }
-                        break;
-                    case COND_CROSS:
-                        result = 1;
-                        break;
-                    };
-                    if (result) {
-                        whenVecCount++;
-                        if (whenVecCondCount == -1) {
-                            xWhen =
-                                CalcCrossPoint(xi, whenVecLSI, xip1, whenVecLSIp1, xi, whenVecRSI, xip1, whenVecRSIp1);
-                            xWhenSet = 1;
-                            lastWhenHitCross[0] = xi;
-                            lastWhenHitCross[1] = whenVecLSI;
-                            lastWhenHitCross[2] = xip1;
-                            lastWhenHitCross[3] = whenVecLSIp1;
-                            lastWhenHitCross[4] = xi;
-                            lastWhenHitCross[5] = whenVecRSI;
-                            lastWhenHitCross[6] = xip1;
-                            lastWhenHitCross[7] = whenVecRSIp1;
-                            lastWhenHitCrossSet = 1;
-                            lastWhenHitSet = 1;
-                            if (mode == FDW_SWITCH_FINDWHEN) {
-                                lastFindWhenHit[0] = xi;
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i], &lastFindWhenHit[1]);
-                                lastFindWhenHit[2] = xip1;
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &lastFindWhenHit[3]);
-                            } else if (mode == FDW_SWITCH_DERIVWHEN) {
-                                double findVecElemITemp;
-                                double findVecElemIp1Temp;
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                                double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                                DerivSelect(interp, i, xi, xWhen, xip1, xLen, xVecElems, findVecElems, yDeriv,
-                                            lastDerYWhenHit, &lastDerYWhenHitPos);
-                            }
-                        } else if (whenVecCondCount == -2) {
-                            double xWhenLoc =
-                                CalcCrossPoint(xi, whenVecLSI, xip1, whenVecLSIp1, xi, whenVecRSI, xip1, whenVecRSIp1);
-                            xWhenSet = 1;
-                            Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhenLoc));
-                            if (mode == FDW_SWITCH_FINDWHENEQ) {
-                                double findVecElemITemp;
-                                double findVecElemIp1Temp;
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                                double yFindLoc =
-                                    CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhenLoc);
-                                Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFindLoc));
-                            } else if (mode == FDW_SWITCH_DERIVWHENEQ) {
-                                double findVecElemITemp;
-                                double findVecElemIp1Temp;
-                                double derivDataTemp[6];
-                                int derivPosTemp;
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                                Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                                double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhenLoc);
-                                DerivSelect(interp, i, xi, xWhenLoc, xip1, xLen, xVecElems, findVecElems, yDeriv,
-                                            derivDataTemp, &derivPosTemp);
-                                double derYLoc =
-                                    Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2], derivDataTemp[3],
-                                          derivDataTemp[4], derivDataTemp[5], derivPosTemp);
-                                Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derYLoc));
-                            }
-                        }
-                    }
-                }
-            }
-            if ((whenVecCondCount != -2) && (whenVecCondCount != -1)) {
-                if ((whenVecCount == whenVecCondCount) && !whenVecFoundFlag) {
-                    whenVecFoundFlag = 1;
-                    xWhen = CalcCrossPoint(xi, whenVecLSI, xip1, whenVecLSIp1, xi, whenVecRSI, xip1, whenVecRSIp1);
-                    Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhen));
-                    xWhenSet = 1;
-                    if (mode == FDW_SWITCH_FINDWHENEQ) {
-                        double findVecElemITemp;
-                        double findVecElemIp1Temp;
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                        yFind = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                        Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFind));
-                    } else if (mode == FDW_SWITCH_DERIVWHENEQ) {
-                        double findVecElemITemp;
-                        double findVecElemIp1Temp;
-                        double derivDataTemp[6];
-                        int derivPosTemp;
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecElemITemp);
-                        Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecElemIp1Temp);
-                        double yDeriv = CalcYBetween(xi, findVecElemITemp, xip1, findVecElemIp1Temp, xWhen);
-                        DerivSelect(interp, i, xi, xWhen, xip1, xLen, xVecElems, findVecElems, yDeriv, derivDataTemp,
-                                    &derivPosTemp);
-                        derY = Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2], derivDataTemp[3],
-                                     derivDataTemp[4], derivDataTemp[5], derivPosTemp);
-                        Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derY));
-                    }
-                    break;
-                }
-            }
+        namesObj = fieldsObj;
+    }
+    Tcl_Size count;
+    Tcl_Obj **names;
+    if (Tcl_ListObjGetElements(interp, namesObj, &count, &names) != TCL_OK) {
+        Tcl_DecrRefCount(fieldsObj);
+        UnmapFile(base, size);
+        return TCL_ERROR;
+    }
+    if (count != cols) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Table '%s' has %ld columns, %ld names given", path, (long)cols,
+                                               (long)count));
+        Tcl_DecrRefCount(fieldsObj);
+        UnmapFile(base, size);
+        return TCL_ERROR;
+    }
+    TextChunks job;
+    job.text = pos;
+    job.len = (size_t)(end - pos);
+    job.commas = 1;
+    job.rows = 1;
+    job.stride = cols;
+    Tcl_WideInt total = CountTextTokens(configPtr, &job);
+    if (total % cols != 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Rows of '%s' don't all have %ld columns", path, (long)cols));
+        Tcl_DecrRefCount(fieldsObj);
+        UnmapFile(base, size);
+        return TCL_ERROR;
+    }
+    job.points = (Tcl_Size)(total / cols);
+    job.columns = (double **)Tcl_Alloc(sizeof(double *) * cols);
+    Tcl_Obj *resultDict = Tcl_NewDictObj();
+    for (Tcl_Size c = 0; c < cols; ++c) {
+        Tcl_Obj *objPtr;
+        job.columns[c] = NULL;
+        if ((Tcl_DictObjGet(NULL, resultDict, names[c], &objPtr) == TCL_OK) && (objPtr == NULL)) {
+            job.columns[c] = (double *)Tcl_Alloc(sizeof(double) * (job.points > 0 ? job.points : 1));
+            Tcl_DictObjPut(NULL, resultDict, names[c], Tcl_NewObj());
         }
     }
-    if ((whenVecCondCount == -1) && (lastWhenHitSet || lastWhenHitCrossSet)) {
-        if ((mode == FDW_SWITCH_WHEN) || (mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_DERIVWHEN)) {
-            xWhen = CalcXBetween(lastWhenHit[0], lastWhenHit[1], lastWhenHit[2], lastWhenHit[3], val);
-            Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhen));
-            xWhenSet = 1;
-            if (mode == FDW_SWITCH_FINDWHEN) {
-                yFind =
-                    CalcYBetween(lastFindWhenHit[0], lastFindWhenHit[1], lastFindWhenHit[2], lastFindWhenHit[3], xWhen);
-                Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFind));
-            } else if (mode == FDW_SWITCH_DERIVWHEN) {
-                derY = Deriv(lastDerYWhenHit[0], lastDerYWhenHit[1], lastDerYWhenHit[2], lastDerYWhenHit[3],
-                             lastDerYWhenHit[4], lastDerYWhenHit[5], lastDerYWhenHitPos);
-                Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derY));
-            }
+    int status = StoreTextTokens(interp, configPtr, &job, path);
+    for (Tcl_Size c = 0; c < cols; ++c) {
+        if (job.columns[c] == NULL) {
+            continue;
         }
-        if ((mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHENEQ) || (mode == FDW_SWITCH_DERIVWHENEQ)) {
-            xWhen = CalcCrossPoint(lastWhenHitCross[0], lastWhenHitCross[1], lastWhenHitCross[2], lastWhenHitCross[3],
-                                   lastWhenHitCross[4], lastWhenHitCross[5], lastWhenHitCross[6], lastWhenHitCross[7]);
-            Tcl_ListObjAppendElement(interp, xWhenObj, Tcl_NewDoubleObj(xWhen));
-            xWhenSet = 1;
-            if (mode == FDW_SWITCH_FINDWHENEQ) {
-                yFind =
-                    CalcYBetween(lastFindWhenHit[0], lastFindWhenHit[1], lastFindWhenHit[2], lastFindWhenHit[3], xWhen);
-                Tcl_ListObjAppendElement(interp, yFindObj, Tcl_NewDoubleObj(yFind));
-            } else if (mode == FDW_SWITCH_DERIVWHENEQ) {
-                derY = Deriv(lastDerYWhenHit[0], lastDerYWhenHit[1], lastDerYWhenHit[2], lastDerYWhenHit[3],
-                             lastDerYWhenHit[4], lastDerYWhenHit[5], lastDerYWhenHitPos);
-                Tcl_ListObjAppendElement(interp, derYObj, Tcl_NewDoubleObj(derY));
-            }
+        if (status != TCL_OK) {
+            Tcl_Free((char *)job.columns[c]);
+            continue;
         }
+        Tcl_Obj *objPtr = Tcl_NewObj();
+        Tcl_ObjInternalRep ir;
+        Tcl_InvalidateStringRep(objPtr);
+        ir.twoPtrValue.ptr1 = NewMeasVectorRep(job.columns[c], job.points);
+        ir.twoPtrValue.ptr2 = NULL;
+        Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+        Tcl_DictObjPut(NULL, resultDict, names[c], objPtr);
     }
-    if (((mode == FDW_SWITCH_WHEN) || (mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_DERIVWHEN)) && !xWhenSet) {
-        const char *condition;
-        const char *vecCondCount;
-        switch ((enum Conditions)whenVecCond) {
-        case COND_RISE:
-            condition = "rise";
-            break;
-        case COND_FALL:
-            condition = "fall";
-            break;
-        case COND_CROSS:
-            condition = "cross";
-            break;
-        };
-        if (whenVecCondCount == -2) {
-            vecCondCount = "all";
-        } else if (whenVecCondCount == -1) {
-            vecCondCount = "last";
-        } else {
-            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(whenVecCondCount));
-        }
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("When value '%f' with conditions '%s %s delay=%f from=%f to=%f' was not found", val,
-                          condition, vecCondCount, delay, from, to);
-        Tcl_SetObjResult(interp, errorMsg);
+    Tcl_Free((char *)job.columns);
+    Tcl_DecrRefCount(fieldsObj);
+    UnmapFile(base, size);
+    if (status != TCL_OK) {
+        Tcl_DecrRefCount(resultDict);
         return TCL_ERROR;
-    } else if (((mode == FDW_SWITCH_WHENEQ) || (mode == FDW_SWITCH_FINDWHENEQ) || (mode == FDW_SWITCH_DERIVWHENEQ)) &&
-               !xWhenSet) {
-        const char *condition;
-        const char *vecCondCount;
-        switch ((enum Conditions)whenVecCond) {
-        case COND_RISE:
-            condition = "rise";
-            break;
-        case COND_FALL:
-            condition = "fall";
-            break;
-        case COND_CROSS:
-            condition = "cross";
-            break;
-        };
-        if (whenVecCondCount == -2) {
-            vecCondCount = "all";
-        } else if (whenVecCondCount == -1) {
-            vecCondCount = "last";
-        } else {
-            vecCondCount = Tcl_GetString(Tcl_NewWideIntObj(whenVecCondCount));
-        }
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("Cross between vectors with conditions '%s %s delay=%f from=%f to=%f' was not found",
-                          condition, vecCondCount, delay, from, to);
-        Tcl_SetObjResult(interp, errorMsg);
+    }
+    Tcl_SetObjResult(interp, resultDict);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * VectorCmdProc2 --
+ *
+ *      Implements `::tclmeasure::vector bytes ?-float32|-float64?`, reads a bytearray of little-endian binary values
+ *      as a vector accepted by all measurement commands. Without this command bytearrays are parsed as lists unless
+ *      `configure -binary` is set, the command marks the bytes as binary values in any mode and converts single
+ *      precision values.
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig (unused)
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = bytes     - bytearray of the values
+ *          objv[2] = -float64  - optional, values are doubles (`binary format q*`), the default
+ *                    -float32  - values are floats (`binary format r*`)
+ *
+ * Results:
+ *      TCL_OK with the vector in the interpreter result: for doubles the bytearray itself, now read in place by the
+ *      commands, for floats a new vector of the values converted to doubles.
+ *      TCL_ERROR if the length of the bytearray is not a multiple of the size of the values.
+ *
+ * Side Effects:
+ *      Converts a bytearray of doubles to the "measvector" type, its value is unchanged
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int VectorCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    static const char *const formats[] = {"-float64", "-float32", NULL};
+    enum Formats { FORMAT_FLOAT64, FORMAT_FLOAT32 };
+    int format = FORMAT_FLOAT64;
+    if ((objc != 2) && (objc != 3)) {
+        Tcl_WrongNumArgs(interp, 1, objv, "bytes ?-float32|-float64?");
         return TCL_ERROR;
     }
-    if ((mode == FDW_SWITCH_WHEN) || (mode == FDW_SWITCH_WHENEQ)) {
-        Tcl_SetObjResult(interp, xWhenObj);
-        return TCL_OK;
-    } else if ((mode == FDW_SWITCH_FINDWHEN) || (mode == FDW_SWITCH_FINDWHENEQ)) {
-        Tcl_SetObjResult(interp, yFindObj);
-        return TCL_OK;
-    } else if ((mode == FDW_SWITCH_DERIVWHEN) || (mode == FDW_SWITCH_DERIVWHENEQ)) {
-        Tcl_SetObjResult(interp, derYObj);
+    if ((objc == 3) &&
+        (Tcl_GetIndexFromObjStruct(interp, objv[2], formats, sizeof(char *), "format", 0, &format) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+    if (format == FORMAT_FLOAT64) {
+        const Tcl_ObjInternalRep *irPtr = Tcl_FetchInternalRep(objv[1], &measVectorType);
+        if (((irPtr == NULL) || (((MeasVectorRep *)irPtr->twoPtrValue.ptr1)->bytesObj == NULL)) &&
+            (SetMeasVectorFromBytes(interp, objv[1]) != TCL_OK)) {
+            return TCL_ERROR;
+        }
+        Tcl_SetObjResult(interp, objv[1]);
         return TCL_OK;
     }
-    return TCL_ERROR;
+    Tcl_Size size;
+    const unsigned char *bytes = Tcl_GetByteArrayFromObj(objv[1], &size);
+    if (bytes == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Vector is not a bytearray"));
+        return TCL_ERROR;
+    }
+    if (size % sizeof(float) != 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Binary vector of %ld bytes does not hold whole floats", (long)size));
+        return TCL_ERROR;
+    }
+    Tcl_Size len = size / (Tcl_Size)sizeof(float);
+    double *data = (double *)Tcl_Alloc(sizeof(double) * (len > 0 ? len : 1));
+    for (Tcl_Size i = 0; i < len; ++i) {
+        unsigned char word[sizeof(float)];
+        float value;
+        for (size_t b = 0; b < sizeof(float); ++b) {
+#ifdef WORDS_BIGENDIAN
+            word[b] = bytes[i * sizeof(float) + sizeof(float) - 1 - b];
+#else
+            word[b] = bytes[i * sizeof(float) + b];
+#endif
+        }
+        memcpy(&value, word, sizeof(float));
+        data[i] = value;
+    }
+    Tcl_Obj *objPtr = Tcl_NewObj();
+    Tcl_ObjInternalRep ir;
+    Tcl_InvalidateStringRep(objPtr);
+    ir.twoPtrValue.ptr1 = NewMeasVectorRep(data, len);
+    ir.twoPtrValue.ptr2 = NULL;
+    Tcl_StoreInternalRep(objPtr, &measVectorType, &ir);
+    Tcl_SetObjResult(interp, objPtr);
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * FindAtCmdProc2 --
+ * DatasetCmdProc2 --
  *
- *      Implements a Tcl command that performs linear interpolation on a time-aligned signal. Given a scalar X value,
- *      this command scans a sequence of (x, y) points and returns the interpolated Y value at the specified X.
- *      The interpolation uses the segment between two bounding X values that bracket the input X.
+ *      Implements `::tclmeasure::dataset create xname data`, converts the vectors of a data dictionary once, checks
+ *      that they all have the length of the x vector and that the x values are strictly increasing, and creates the
+ *      command `::tclmeasure::datasetN` that gives access to them (see DatasetHandleCmdProc2).
  *
  * Parameters:
- *      void *clientData              - input: optional user data (unused)
- *      Tcl_Interp *interp            - input/output: interpreter used for result and error reporting
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
  *      Tcl_Size objc                 - input: number of command arguments
  *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
  *
- *          objv[1] = x        - list of X (time) values
- *          objv[2] = val      - scalar X value to look up
- *          objv[3] = findVec  - list of Y values aligned with `x`
+ *          objv[1] = create
+ *          objv[2] = xname  - name of the x vector in the data dictionary
+ *          objv[3] = data   - dictionary with names of vectors as the keys and vectors as the values
  *
  * Results:
- *      TCL_OK if `val` is within a segment in `x`; the corresponding interpolated Y value is returned via interpreter.
- *      TCL_ERROR if:
- *          - the number of arguments is invalid,
- *          - any list parsing fails,
- *          - list lengths mismatch,
- *          - `val` lies outside all segment ranges in `x`
+ *      TCL_OK with the fully qualified name of the handle command in the interpreter result.
+ *      TCL_ERROR if the x vector is missing or not strictly increasing, or a vector is invalid or has another length.
  *
  * Side Effects:
- *      Sets interpreter result to the computed Y value or an error message on failure.
- *
- * Notes:
- *      - The function assumes `x` is sorted in ascending order.
- *      - Only the first matching segment where `xi <= val <= xi+1` is used.
- *      - Uses `CalcYBetween` to interpolate linearly between two Y values.
+ *      Converts the vectors of the dictionary to the "measvector" type and creates the handle command.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int FindAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+static int DatasetCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    static const char *const subcommands[] = {"create", NULL};
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "create xname data");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
+        return TCL_ERROR;
+    }
     if (objc != 4) {
-        Tcl_WrongNumArgs(interp, 3, objv, "x val findVec");
+        Tcl_WrongNumArgs(interp, 2, objv, "xname data");
         return TCL_ERROR;
     }
-    Tcl_Size xLen, findVecLen;
-    Tcl_Obj **xVecElems, **findVecElems;
-    if (Tcl_ListObjGetElements(interp, objv[1], &xLen, &xVecElems) == TCL_ERROR) {
+    Tcl_Obj *xObj;
+    if (Tcl_DictObjGet(interp, objv[3], objv[2], &xObj) != TCL_OK) {
         return TCL_ERROR;
     }
-    double val;
-    Tcl_GetDoubleFromObj(interp, objv[2], &val);
-    if (Tcl_ListObjGetElements(interp, objv[3], &findVecLen, &findVecElems) == TCL_ERROR) {
+    if (xObj == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("x vector '%s' is not in the data", Tcl_GetString(objv[2])));
         return TCL_ERROR;
     }
-    if (xLen != findVecLen) {
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of findVec '%ld'", xLen, findVecLen);
-        Tcl_SetObjResult(interp, errorMsg);
+    MeasVector xVec;
+    if ((GetMeasVectorFromObj(interp, xObj, &xVec) != TCL_OK) || (CheckIncreasing(interp, xVec.repPtr) != TCL_OK)) {
         return TCL_ERROR;
     }
-    double yFind;
-    int foundFlag = 0;
-    for (Tcl_Size i = 0; i < xLen - 1; ++i) {
-        double xi, xip1, findVecI, findVecIp1;
-        Tcl_GetDoubleFromObj(interp, xVecElems[i], &xi);
-        Tcl_GetDoubleFromObj(interp, xVecElems[i + 1], &xip1);
-        Tcl_GetDoubleFromObj(interp, findVecElems[i], &findVecI);
-        Tcl_GetDoubleFromObj(interp, findVecElems[i + 1], &findVecIp1);
-        if ((xi <= val) && (xip1 >= val)) {
-            yFind = CalcYBetween(xi, findVecI, xip1, findVecIp1, val);
-            foundFlag = 1;
+    GetMeasGrid(xVec.repPtr);
+    MeasDataset *dsPtr = (MeasDataset *)Tcl_Alloc(sizeof(MeasDataset));
+    dsPtr->token = NULL;
+    dsPtr->xnameObj = objv[2];
+    Tcl_IncrRefCount(dsPtr->xnameObj);
+    dsPtr->columnsObj = Tcl_NewDictObj();
+    Tcl_IncrRefCount(dsPtr->columnsObj);
+    dsPtr->len = xVec.len;
+    Tcl_DictSearch search;
+    Tcl_Obj *nameObj, *vecObj;
+    int done;
+    Tcl_DictObjFirst(NULL, objv[3], &search, &nameObj, &vecObj, &done);
+    for (; !done; Tcl_DictObjNext(&search, &nameObj, &vecObj, &done)) {
+        if (AddDatasetVector(interp, dsPtr, nameObj, vecObj) != TCL_OK) {
+            Tcl_DictObjDone(&search);
+            DeleteDataset(dsPtr);
+            return TCL_ERROR;
+        }
+    }
+    /* skip names taken by other commands */
+    Tcl_CmdInfo info;
+    do {
+        nameObj = Tcl_ObjPrintf("::tclmeasure::dataset%ld", ++configPtr->sets);
+        if (!Tcl_GetCommandInfo(interp, Tcl_GetString(nameObj), &info)) {
             break;
         }
+        Tcl_DecrRefCount(nameObj);
+    } while (1);
+    dsPtr->token = Tcl_CreateObjCommand2(interp, Tcl_GetString(nameObj), (Tcl_ObjCmdProc2 *)DatasetHandleCmdProc2,
+                                         dsPtr, DeleteDataset);
+    Tcl_SetObjResult(interp, nameObj);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * AddDatasetVector --
+ *
+ *      Converts a vector and adds it to a dataset, after checking that it has the length of the x vector.
+ *
+ * Parameters:
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasDataset *dsPtr        - input/output: dataset, gets the vector
+ *      Tcl_Obj *nameObj          - input: name of the vector
+ *      Tcl_Obj *vecObj           - input: vector
+ *
+ * Results:
+ *      TCL_OK on success; TCL_ERROR if the vector is invalid or has another length
+ *
+ * Side Effects:
+ *      Converts vecObj to the "measvector" type, replaces a vector of the same name
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static int AddDatasetVector(Tcl_Interp *interp, MeasDataset *dsPtr, Tcl_Obj *nameObj, Tcl_Obj *vecObj) {
+    MeasVector vec;
+    if (GetMeasVectorFromObj(interp, vecObj, &vec) != TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Vector '%s': %s", Tcl_GetString(nameObj),
+                                               Tcl_GetString(Tcl_GetObjResult(interp))));
+        return TCL_ERROR;
     }
-    if (!foundFlag) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Value of the vector at '%f' was not found", val);
-        Tcl_SetObjResult(interp, errorMsg);
+    if (vec.len != dsPtr->len) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Length of x '%ld' is not equal to length of '%s' '%ld'", dsPtr->len,
+                                               Tcl_GetString(nameObj), vec.len));
         return TCL_ERROR;
-    } else {
-        Tcl_SetObjResult(interp, Tcl_NewDoubleObj(yFind));
-        return TCL_OK;
     }
+    Tcl_DictObjPut(NULL, dsPtr->columnsObj, nameObj, ShareMeasVector(vecObj));
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * DerivAtCmdProc2 --
+ * ShareMeasVector --
  *
- *      Implements a Tcl command that computes the numerical derivative of a signal vector at a specified X position.
- *      The derivative is estimated using a 3-point stencil around the interpolation point. The function searches for
- *      a segment [xi, xi+1] that brackets the given value and uses neighboring data (when available) for accuracy.
+ *      Creates a new object that shares the representation of a "measvector" object, with the values and all data
+ *      cached for them. The string representation is made again when it is needed.
  *
  * Parameters:
- *      void *clientData              - input: optional user data (unused)
- *      Tcl_Interp *interp            - input/output: interpreter for result or error message
- *      Tcl_Size objc                 - input: number of command arguments
- *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *      Tcl_Obj *objPtr           - input: "measvector" object
  *
- *          objv[1] = x           - list of X (independent) values
- *          objv[2] = val         - scalar X value where derivative should be evaluated
- *          objv[3] = derivVec    - list of Y (dependent) values aligned with `x`
+ * Results:
+ *      New object with a reference count of 0
+ *
+ * Side Effects:
+ *      Increments the reference count of the shared representation
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static Tcl_Obj *ShareMeasVector(Tcl_Obj *objPtr) {
+    Tcl_Obj *shareObj = Tcl_NewObj();
+    Tcl_InvalidateStringRep(shareObj);
+    DupMeasVectorInternalRep(objPtr, shareObj);
+    return shareObj;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * DeleteDataset --
+ *
+ *      Frees a dataset when its handle command is deleted.
+ *
+ * Parameters:
+ *      void *clientData          - input: pointer to the MeasDataset
  *
  * Results:
- *      TCL_OK on success, with interpreter result set to a double representing the estimated derivative.
- *      TCL_ERROR on:
- *          - wrong number of arguments,
- *          - list extraction failure,
- *          - mismatched vector lengths,
- *          - val lying outside the data range
+ *      None
  *
  * Side Effects:
- *      Uses `DerivSelect()` to extract the proper 3-point stencil and compute the interpolated derivative using `Deriv()`.
- *      Sets the interpreter result to either a floating-point derivative or a descriptive error message.
+ *      Releases the vectors of the dataset
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void DeleteDataset(void *clientData) {
+    MeasDataset *dsPtr = (MeasDataset *)clientData;
+    Tcl_DecrRefCount(dsPtr->xnameObj);
+    Tcl_DecrRefCount(dsPtr->columnsObj);
+    Tcl_Free((char *)dsPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * DatasetHandleCmdProc2 --
+ *
+ *      Implements the command of a dataset created by `::tclmeasure::dataset create`:
+ *          $ds xname            - returns the name of the x vector
+ *          $ds names            - returns the names of the vectors
+ *          $ds length           - returns the length of the vectors
+ *          $ds vector name      - returns a vector
+ *          $ds data ?names?     - returns a dictionary of all or of the given vectors, as `measure -dataset` uses
+ *          $ds add name vector  - adds or replaces a vector other than the x vector
+ *          $ds close            - deletes the command
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the MeasDataset
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments
+ *
+ * Results:
+ *      TCL_OK with the result of the subcommand; TCL_ERROR on invalid arguments, unknown names or invalid vectors.
+ *
+ * Side Effects:
+ *      add converts the vector, close deletes the command.
  *
  * Notes:
- *      - Linear interpolation is used to estimate the Y value at `val`, then finite-difference is applied.
- *      - The method adapts to edges (beginning or end of the dataset) using forward/backward biased stencils.
- *      - Requires at least 3 points in `x` and `derivVec` to compute valid derivatives.
+ *      Vectors are returned as new objects that share the representation of the private vectors of the dataset (see
+ *      ShareMeasVector()), so the values are never converted again, and the order and grid of the x vector, the
+ *      crossing indexes and the cumulative integrals built by the measurements are kept between calls.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int DerivAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
-    if (objc != 4) {
-        Tcl_WrongNumArgs(interp, 3, objv, "x val derivVec");
-        return TCL_ERROR;
-    }
-    Tcl_Size xLen, derivVecLen;
-    Tcl_Obj **xVecElems, **derivVecElems;
-    if (Tcl_ListObjGetElements(interp, objv[1], &xLen, &xVecElems) == TCL_ERROR) {
-        return TCL_ERROR;
-    }
-    double val;
-    Tcl_GetDoubleFromObj(interp, objv[2], &val);
-    if (Tcl_ListObjGetElements(interp, objv[3], &derivVecLen, &derivVecElems) == TCL_ERROR) {
+static int DatasetHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasDataset *dsPtr = (MeasDataset *)clientData;
+    static const char *const subcommands[] = {"xname", "names", "length", "vector", "data", "add", "close", NULL};
+    enum Subcommands { SUB_XNAME, SUB_NAMES, SUB_LENGTH, SUB_VECTOR, SUB_DATA, SUB_ADD, SUB_CLOSE };
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg ...?");
         return TCL_ERROR;
     }
-    if (xLen != derivVecLen) {
-        Tcl_Obj *errorMsg =
-            Tcl_ObjPrintf("Length of x '%ld' is not equal to length of derivVec '%ld'", xLen, derivVecLen);
-        Tcl_SetObjResult(interp, errorMsg);
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
         return TCL_ERROR;
     }
-    double yDeriv, derY;
-    int foundFlag = 0;
-    for (Tcl_Size i = 0; i < xLen - 1; ++i) {
-        double xi, xip1, derivVecI, derivVecIp1;
-        Tcl_GetDoubleFromObj(interp, xVecElems[i], &xi);
-        Tcl_GetDoubleFromObj(interp, xVecElems[i + 1], &xip1);
-        Tcl_GetDoubleFromObj(interp, derivVecElems[i], &derivVecI);
-        Tcl_GetDoubleFromObj(interp, derivVecElems[i + 1], &derivVecIp1);
-        if ((xi <= val) && (xip1 >= val)) {
-            double derivDataTemp[6];
-            int derivPosTemp;
-            yDeriv = CalcYBetween(xi, derivVecI, xip1, derivVecIp1, val);
-            DerivSelect(interp, i, xi, val, xip1, xLen, xVecElems, derivVecElems, yDeriv, derivDataTemp, &derivPosTemp);
-            derY = Deriv(derivDataTemp[0], derivDataTemp[1], derivDataTemp[2], derivDataTemp[3], derivDataTemp[4],
-                         derivDataTemp[5], derivPosTemp);
-            foundFlag = 1;
-            break;
+    switch ((enum Subcommands)sub) {
+    case SUB_XNAME:
+    case SUB_NAMES:
+    case SUB_LENGTH:
+    case SUB_CLOSE:
+        if (objc != 2) {
+            Tcl_WrongNumArgs(interp, 2, objv, NULL);
+            return TCL_ERROR;
+        }
+        if (sub == SUB_XNAME) {
+            Tcl_SetObjResult(interp, dsPtr->xnameObj);
+        } else if (sub == SUB_LENGTH) {
+            Tcl_SetObjResult(interp, Tcl_NewWideIntObj(dsPtr->len));
+        } else if (sub == SUB_CLOSE) {
+            Tcl_DeleteCommandFromToken(interp, dsPtr->token);
+        } else {
+            Tcl_Obj *namesObj = Tcl_NewListObj(0, NULL);
+            Tcl_DictSearch search;
+            Tcl_Obj *nameObj;
+            int done;
+            Tcl_DictObjFirst(NULL, dsPtr->columnsObj, &search, &nameObj, NULL, &done);
+            for (; !done; Tcl_DictObjNext(&search, &nameObj, NULL, &done)) {
+                Tcl_ListObjAppendElement(NULL, namesObj, nameObj);
+            }
+            Tcl_SetObjResult(interp, namesObj);
+        }
+        return TCL_OK;
+    case SUB_VECTOR: {
+        Tcl_Obj *vecObj;
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "name");
+            return TCL_ERROR;
         }
+        Tcl_DictObjGet(NULL, dsPtr->columnsObj, objv[2], &vecObj);
+        if (vecObj == NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Vector '%s' is not in the dataset", Tcl_GetString(objv[2])));
+            return TCL_ERROR;
+        }
+        Tcl_SetObjResult(interp, ShareMeasVector(vecObj));
+        return TCL_OK;
     }
-    if (!foundFlag) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Derivative of the vector at '%f' was not found", val);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else {
-        Tcl_SetObjResult(interp, Tcl_NewDoubleObj(derY));
+    case SUB_DATA: {
+        Tcl_Obj *dataDict = Tcl_NewDictObj();
+        if (objc > 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "?names?");
+            return TCL_ERROR;
+        }
+        if (objc == 2) {
+            Tcl_DictSearch search;
+            Tcl_Obj *nameObj, *vecObj;
+            int done;
+            Tcl_DictObjFirst(NULL, dsPtr->columnsObj, &search, &nameObj, &vecObj, &done);
+            for (; !done; Tcl_DictObjNext(&search, &nameObj, &vecObj, &done)) {
+                Tcl_DictObjPut(NULL, dataDict, nameObj, ShareMeasVector(vecObj));
+            }
+            Tcl_SetObjResult(interp, dataDict);
+            return TCL_OK;
+        }
+        Tcl_Size count;
+        Tcl_Obj **names;
+        if (Tcl_ListObjGetElements(interp, objv[2], &count, &names) != TCL_OK) {
+            Tcl_DecrRefCount(dataDict);
+            return TCL_ERROR;
+        }
+        for (Tcl_Size i = 0; i < count; ++i) {
+            Tcl_Obj *vecObj;
+            Tcl_DictObjGet(NULL, dsPtr->columnsObj, names[i], &vecObj);
+            if (vecObj == NULL) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Vector '%s' is not in the dataset", Tcl_GetString(names[i])));
+                Tcl_DecrRefCount(dataDict);
+                return TCL_ERROR;
+            }
+            Tcl_DictObjPut(NULL, dataDict, names[i], ShareMeasVector(vecObj));
+        }
+        Tcl_SetObjResult(interp, dataDict);
         return TCL_OK;
     }
+    case SUB_ADD:
+        if (objc != 4) {
+            Tcl_WrongNumArgs(interp, 2, objv, "name vector");
+            return TCL_ERROR;
+        }
+        if (!strcmp(Tcl_GetString(objv[2]), Tcl_GetString(dsPtr->xnameObj))) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("x vector '%s' of the dataset can't be replaced",
+                                                   Tcl_GetString(objv[2])));
+            return TCL_ERROR;
+        }
+        return AddDatasetVector(interp, dsPtr, objv[2], objv[3]);
+    }
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * IntegCmdProc2 --
+ * SweepCmdProc2 --
  *
- *      Implements a Tcl command that numerically integrates a Y vector over a given interval in X using the trapezoidal
- *      rule. Supports optional output of cumulative integral values over the integration domain.
+ *      Implements `::tclmeasure::Sweep xname batch plans runs`, does the planned measurements on the data of many runs
+ *      (see ::tclmeasure::sweep). The measurements that can be streamed are set up once, and the runs are shared
+ *      between the threads configured in the interpreter, each run fed at once to its own copy of the measurements.
+ *      The other measurements are evaluated for each run by the interpreter. A measurement that fails on a run gives
+ *      an error entry of the run instead of failing the sweep.
  *
  * Parameters:
- *      void *clientData              - input: optional user data (unused)
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
  *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
  *      Tcl_Size objc                 - input: number of command arguments
  *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
  *
- *          objv[1] = x        - list of X values (time domain)
- *          objv[2] = y        - list of Y values (to integrate over X)
- *          objv[3] = xstart   - start of the integration interval (must lie within `x`)
- *          objv[4] = xend     - end of the integration interval (must lie within `x`)
- *          objv[5] = cum      - boolean flag; if true, return cumulative integral series as dict with "x" and "y" keys
+ *          objv[1] = xname  - name of the x vector in the data dictionaries of the runs
+ *          objv[2] = batch  - boolean, plans is a dictionary of named plans if true
+ *          objv[3] = plans  - plan of a single measurement (see ::tclmeasure::Plan), or a dictionary of them
+ *          objv[4] = runs   - list of data dictionaries, one per run
  *
  * Results:
- *      TCL_OK on success:
- *          - If `cum` is false: interpreter result is the total integral (double)
- *          - If `cum` is true: result is a dict with keys:
- *              "x" => list of X values from the integration path
- *              "y" => list of cumulative integral values
- *
- *      TCL_ERROR on:
- *          - invalid argument count
- *          - non-numeric or non-list inputs
- *          - mismatched lengths between `x` and `y`
- *          - `xstart`/`xend` outside the `x` domain
- *          - `xstart >= xend`
+ *      TCL_OK with a dictionary in the interpreter result:
+ *          results - list with the result of each run, or with the dictionary of results of each run for a batch;
+ *                    a measurement that failed gives an empty value
+ *          errors  - dictionary with the indexes of the failed runs as the keys and the error messages as the
+ *                    values, or dictionaries of the messages by the names of the failed measurements for a batch
+ *      TCL_ERROR on invalid arguments.
  *
  * Side Effects:
- *      Uses `CalcYBetween()` to interpolate values at exact `xstart` and `xend` positions for accurate integration.
- *      Accumulates the integral using trapezoidal rule:
- *          ∫(a to b) y dx ≈ Σ [(yi + yi+1)/2] * (xi+1 - xi)
- *      When `cum` is enabled, builds Tcl lists for cumulative output.
- *
- * Notes:
- *      - Assumes `x` is monotonically increasing.
- *      - All interpolation and accumulation is performed in double precision.
- *      - Caller is responsible for ensuring signal alignment and sampling accuracy.
+ *      Converts the vectors of the runs to measvector objects.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int IntegCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
-    if (objc != 6) {
-        Tcl_WrongNumArgs(interp, 5, objv, "x y xstart xend cum");
+static int SweepCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    if (objc != 5) {
+        Tcl_WrongNumArgs(interp, 1, objv, "xname batch plans runs");
         return TCL_ERROR;
     }
-    Tcl_Size xLen, yLen;
-    Tcl_Obj **xElems, **yElems;
-    if (Tcl_ListObjGetElements(interp, objv[1], &xLen, &xElems) == TCL_ERROR) {
+    int batch;
+    if (Tcl_GetBooleanFromObj(interp, objv[2], &batch) != TCL_OK) {
         return TCL_ERROR;
     }
-    if (Tcl_ListObjGetElements(interp, objv[2], &yLen, &yElems) == TCL_ERROR) {
+    Tcl_Size count = 1;
+    Tcl_Obj **elems = NULL;
+    if (batch) {
+        if (Tcl_ListObjGetElements(interp, objv[3], &count, &elems) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (count % 2) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("missing value to go with key", -1));
+            return TCL_ERROR;
+        }
+        count /= 2;
+    }
+    Tcl_Size runs;
+    Tcl_Obj **runObjs;
+    if (Tcl_ListObjGetElements(interp, objv[4], &runs, &runObjs) != TCL_OK) {
         return TCL_ERROR;
     }
-    double xstart;
-    Tcl_GetDoubleFromObj(interp, objv[3], &xstart);
-    double xend;
-    Tcl_GetDoubleFromObj(interp, objv[4], &xend);
-    int cumFlag;
-    Tcl_GetBooleanFromObj(interp, objv[5], &cumFlag);
-    Tcl_Obj *xCum = NULL;
-    Tcl_Obj *yCum = NULL;
-    if (cumFlag) {
-        xCum = Tcl_NewListObj(0, NULL);
-        yCum = Tcl_NewListObj(0, NULL);
+    MeasSweep sweep;
+    sweep.plans = (Tcl_Obj **)Tcl_Alloc(sizeof(Tcl_Obj *) * (count + 1));
+    /* commands at every second element, as the values of a batch dictionary */
+    Tcl_Obj **cmds = (Tcl_Obj **)Tcl_Alloc(sizeof(Tcl_Obj *) * 2 * (count + 1));
+    Tcl_Obj *keyObj = Tcl_NewStringObj("cmd", -1);
+    Tcl_IncrRefCount(keyObj);
+    Tcl_Size plans = 0;
+    int code = TCL_OK;
+    for (; plans < count; ++plans) {
+        Tcl_Obj *planObj = batch ? elems[2 * plans + 1] : objv[3];
+        if (Tcl_DictObjGet(interp, planObj, keyObj, &cmds[2 * plans]) != TCL_OK) {
+            code = TCL_ERROR;
+            break;
+        }
+        if (cmds[2 * plans] == NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Plan '%s' has no command", Tcl_GetString(planObj)));
+            code = TCL_ERROR;
+            break;
+        }
+        sweep.plans[plans] = planObj;
+        Tcl_IncrRefCount(planObj);
+        Tcl_IncrRefCount(cmds[2 * plans]);
     }
-    if (xLen != yLen) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
+    Tcl_DecrRefCount(keyObj);
+    sweep.streamPtr = NULL;
+    if (code == TCL_OK) {
+        sweep.streamPtr = NewStream(interp, configPtr, objv[1], count, batch ? elems : NULL, cmds, 1);
     }
-    double xActualStart, xActualEnd;
-    Tcl_GetDoubleFromObj(interp, xElems[0], &xActualStart);
-    Tcl_GetDoubleFromObj(interp, xElems[xLen - 1], &xActualEnd);
-    if (xstart < xActualStart) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Start of integration interval '%f' is outside the x values range", xstart);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else if (xend > xActualEnd) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("End of integration interval '%f' is outside the x values range", xend);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else if (xstart >= xend) {
-        Tcl_SetObjResult(
-            interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the integration", -1));
+    for (Tcl_Size i = 0; i < plans; ++i) {
+        Tcl_DecrRefCount(cmds[2 * i]);
+    }
+    Tcl_Free((char *)cmds);
+    if (sweep.streamPtr == NULL) {
+        for (Tcl_Size i = 0; i < plans; ++i) {
+            Tcl_DecrRefCount(sweep.plans[i]);
+        }
+        Tcl_Free((char *)sweep.plans);
         return TCL_ERROR;
     }
-    int startFlagFound = 0;
-    int endFlagFound = 0;
-    double ystart = 0, yend;
-    int istart = 0, iend;
-    double result = 0.0;
-    for (Tcl_Size i = 0; i < xLen - 1; ++i) {
-        double xi, xip1, yi, yip1;
-        Tcl_GetDoubleFromObj(interp, xElems[i], &xi);
-        Tcl_GetDoubleFromObj(interp, xElems[i + 1], &xip1);
-        Tcl_GetDoubleFromObj(interp, yElems[i], &yi);
-        Tcl_GetDoubleFromObj(interp, yElems[i + 1], &yip1);
-        if ((xi <= xstart) && (xip1 >= xstart) && !startFlagFound) {
-            ystart = CalcYBetween(xi, yi, xip1, yip1, xstart);
-            istart = i;
-            startFlagFound = 1;
-        } else if ((xi <= xend) && (xip1 >= xend) && !endFlagFound) {
-            yend = CalcYBetween(xi, yi, xip1, yip1, xend);
-            iend = i;
-            endFlagFound = 1;
-        }
-        if (startFlagFound) {
-            if (i == istart) {
-                xi = xstart;
-                yi = ystart;
-                result = result + (yip1 + yi) / 2.0 * (xip1 - xi);
-                if (cumFlag) {
-                    Tcl_ListObjAppendElement(interp, xCum, Tcl_NewDoubleObj(xi));
-                    Tcl_ListObjAppendElement(interp, yCum, Tcl_NewDoubleObj(result));
-                }
-                continue;
-            } else if (endFlagFound) {
-                if (i == iend) {
-                    xip1 = xend;
-                    yip1 = yend;
-                    result = result + (yip1 + yi) / 2.0 * (xip1 - xi);
-                    if (cumFlag) {
-                        Tcl_ListObjAppendElement(interp, xCum, Tcl_NewDoubleObj(xip1));
-                        Tcl_ListObjAppendElement(interp, yCum, Tcl_NewDoubleObj(result));
-                    }
-                    break;
+    MeasStream *streamPtr = sweep.streamPtr;
+    Tcl_Size vecCount = streamPtr->vecCount;
+    int streamed = 0;
+    for (Tcl_Size i = 0; i < count; ++i) {
+        streamed |= (streamPtr->meas[i].kind != STREAM_EVAL);
+    }
+    /* each run is processed by a single thread */
+    sweep.config = *configPtr;
+    sweep.config.threads = 1;
+    sweep.runs = runs;
+    sweep.vecs = (const double **)Tcl_Alloc(sizeof(const double *) * (runs * vecCount + 1));
+    sweep.lens = (Tcl_Size *)Tcl_Alloc(sizeof(Tcl_Size) * (runs + 1));
+    sweep.errors = (Tcl_Obj **)Tcl_Alloc(sizeof(Tcl_Obj *) * (runs + 1));
+    sweep.meas = (StreamMeas *)Tcl_Alloc(sizeof(StreamMeas) * (runs * count + 1));
+    for (Tcl_Size r = 0; r < runs; ++r) {
+        sweep.lens[r] = 0;
+        sweep.errors[r] = NULL;
+        if (!streamed) {
+            continue;
+        }
+        if (GetStreamVectors(interp, streamPtr, runObjs[r], sweep.vecs + r * vecCount, &sweep.lens[r]) != TCL_OK) {
+            sweep.errors[r] = Tcl_GetObjResult(interp);
+        } else if (sweep.lens[r] == 0) {
+            sweep.errors[r] = Tcl_NewStringObj("Vectors of the run are empty", -1);
+        }
+        if (sweep.errors[r] != NULL) {
+            Tcl_IncrRefCount(sweep.errors[r]);
+            Tcl_ResetResult(interp);
+        }
+    }
+    if (streamed) {
+        int chunks = SplitRange(configPtr, 0, runs, 1, sweep.bounds);
+        if (chunks == 1) {
+            SweepRunsProc(&sweep, 0);
+        } else {
+            RunChunks(chunks, SweepRunsProc, &sweep);
+        }
+    }
+    Tcl_Obj *resultsObj = Tcl_NewListObj(0, NULL);
+    Tcl_Obj *errorsObj = Tcl_NewDictObj();
+    for (Tcl_Size r = 0; r < runs; ++r) {
+        Tcl_Obj *runObj = batch ? Tcl_NewDictObj() : NULL;
+        Tcl_Obj *runErrorsObj = batch ? Tcl_NewDictObj() : NULL;
+        int failed = 0;
+        for (Tcl_Size i = 0; i < count; ++i) {
+            Tcl_Obj *valueObj = SweepMeasResult(interp, &sweep, r, i, runObjs[r]);
+            if (valueObj == NULL) {
+                failed = 1;
+                valueObj = Tcl_NewObj();
+                if (batch) {
+                    Tcl_DictObjPut(NULL, runErrorsObj, streamPtr->meas[i].nameObj, Tcl_GetObjResult(interp));
+                } else {
+                    Tcl_DictObjPut(NULL, errorsObj, Tcl_NewWideIntObj(r), Tcl_GetObjResult(interp));
                 }
+            }
+            /* the value may be the result of the interpreter */
+            Tcl_IncrRefCount(valueObj);
+            Tcl_ResetResult(interp);
+            if (batch) {
+                Tcl_DictObjPut(NULL, runObj, streamPtr->meas[i].nameObj, valueObj);
             } else {
-                result = result + (yip1 + yi) / 2.0 * (xip1 - xi);
-                if (cumFlag) {
-                    Tcl_ListObjAppendElement(interp, xCum, Tcl_NewDoubleObj(xi));
-                    Tcl_ListObjAppendElement(interp, yCum, Tcl_NewDoubleObj(result));
-                }
+                Tcl_ListObjAppendElement(NULL, resultsObj, valueObj);
             }
+            Tcl_DecrRefCount(valueObj);
+        }
+        if (!batch) {
+            continue;
+        }
+        Tcl_ListObjAppendElement(NULL, resultsObj, runObj);
+        if (failed) {
+            Tcl_DictObjPut(NULL, errorsObj, Tcl_NewWideIntObj(r), runErrorsObj);
+        } else {
+            Tcl_DecrRefCount(runErrorsObj);
         }
     }
-    if (cumFlag) {
-        Tcl_Obj *resultDict = Tcl_NewDictObj();
-        Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("x", -1), xCum);
-        Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("y", -1), yCum);
-        Tcl_SetObjResult(interp, resultDict);
-        return TCL_OK;
-    } else {
-        Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
-        return TCL_OK;
+    for (Tcl_Size r = 0; r < runs; ++r) {
+        if (sweep.errors[r] != NULL) {
+            Tcl_DecrRefCount(sweep.errors[r]);
+        }
+    }
+    for (Tcl_Size i = 0; i < count; ++i) {
+        Tcl_DecrRefCount(sweep.plans[i]);
     }
+    Tcl_Free((char *)sweep.plans);
+    Tcl_Free((char *)sweep.vecs);
+    Tcl_Free((char *)sweep.lens);
+    Tcl_Free((char *)sweep.errors);
+    Tcl_Free((char *)sweep.meas);
+    FreeStream(streamPtr);
+    Tcl_Obj *sweepObj = Tcl_NewDictObj();
+    Tcl_DictObjPut(NULL, sweepObj, Tcl_NewStringObj("results", -1), resultsObj);
+    Tcl_DictObjPut(NULL, sweepObj, Tcl_NewStringObj("errors", -1), errorsObj);
+    Tcl_SetObjResult(interp, sweepObj);
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * findMinObj --
+ * SweepRunsProc --
  *
- *      Find the minimum value among a list of Tcl_Obj pointers, each representing a numeric value. The function parses
- *      all elements as doubles and returns the smallest one.
+ *      Feeds the runs of a chunk of a sweep to their copies of the streamed measurements. Called by RunChunks(), does
+ *      not use the Tcl API.
  *
  * Parameters:
- *      Tcl_Interp *interp        - input/output: interpreter for error reporting if conversion fails
- *      Tcl_Obj *const objv[]     - input: array of Tcl_Obj pointers (assumed to be numeric values)
- *      Tcl_Size len              - input: number of elements in the `objv` array
- *      double *result            - output: pointer to store the minimum value found
+ *      void *clientData          - input/output: pointer to the MeasSweep
+ *      int chunk                 - input: chunk of runs, see MeasSweep.bounds
  *
  * Results:
- *      TCL_OK on success, and *result is set to the minimum double value from the array
- *      TCL_ERROR if:
- *          - len is zero or negative
- *          - any element in `objv` fails conversion to double (error message set in interpreter)
+ *      None
  *
  * Side Effects:
- *      On failure, sets an error message in the interpreter result
- *
- * Notes:
- *      - Uses `fmin()` to preserve IEEE behavior with NaNs if present.
- *      - All numeric values are interpreted as double precision.
+ *      Fills the measurements of the runs in MeasSweep.meas
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-int findMinObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result) {
-    if (len <= 0)
-        return TCL_ERROR;
-    double min;
-    if (Tcl_GetDoubleFromObj(interp, objv[0], &min) != TCL_OK)
-        return TCL_ERROR;
-    for (Tcl_Size i = 1; i < len; i++) {
-        double val;
-        if (Tcl_GetDoubleFromObj(interp, objv[i], &val) != TCL_OK)
-            return TCL_ERROR;
-        min = fmin(min, val);
+static void SweepRunsProc(void *clientData, int chunk) {
+    MeasSweep *sweepPtr = (MeasSweep *)clientData;
+    const MeasStream *streamPtr = sweepPtr->streamPtr;
+    for (Tcl_Size r = sweepPtr->bounds[chunk]; r < sweepPtr->bounds[chunk + 1]; ++r) {
+        MeasStream run = *streamPtr;
+        run.configPtr = &sweepPtr->config;
+        run.meas = sweepPtr->meas + r * streamPtr->measCount;
+        memcpy(run.meas, streamPtr->meas, sizeof(StreamMeas) * streamPtr->measCount);
+        if (sweepPtr->errors[r] != NULL) {
+            continue;
+        }
+        const double **vecs = sweepPtr->vecs + r * streamPtr->vecCount;
+        StartStreamWindows(&run, vecs[0][0]);
+        FeedStreamPoints(&run, vecs, sweepPtr->lens[r]);
     }
-    *result = min;
-    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * findMaxObj --
+ * SweepMeasResult --
  *
- *      Find the maximum value among a list of Tcl_Obj pointers, each representing a numeric value. The function parses
- *      all elements as doubles and returns the largest one.
+ *      Gets the result of a measurement of a sweep on one run: the result of a streamed measurement after the run was
+ *      fed, or the result of the planned command evaluated on the data of the run.
  *
  * Parameters:
- *      Tcl_Interp *interp        - input/output: interpreter for error reporting if conversion fails
- *      Tcl_Obj *const objv[]     - input: array of Tcl_Obj pointers (expected to hold numeric values)
- *      Tcl_Size len              - input: number of elements in the `objv` array
- *      double *result            - output: pointer to store the maximum value found
+ *      Tcl_Interp *interp          - input/output: interpreter for evaluation and error reporting
+ *      const MeasSweep *sweepPtr   - input: sweep, with the runs fed by SweepRunsProc()
+ *      Tcl_Size run                - input: index of the run
+ *      Tcl_Size meas               - input: index of the measurement
+ *      Tcl_Obj *dataObj            - input: data dictionary of the run
  *
  * Results:
- *      TCL_OK on success, and *result is set to the maximum double value from the array
- *      TCL_ERROR if:
- *          - len is zero or negative
- *          - any element in `objv` cannot be converted to a double (error set in interpreter)
+ *      Result of the measurement, a new object or the result of the interpreter; NULL with the error message in the
+ *      interpreter if the measurement failed on the run
  *
  * Side Effects:
- *      On failure, sets an error message in the interpreter result
- *
- * Notes:
- *      - Uses `fmax()` to ensure IEEE compliance (e.g., handling NaNs).
- *      - All values are treated as double-precision floating point.
+ *      Evaluates the command of a measurement that can't be streamed.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-int findMaxObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result) {
-    if (len <= 0)
-        return TCL_ERROR;
-    double max;
-    if (Tcl_GetDoubleFromObj(interp, objv[0], &max) != TCL_OK)
-        return TCL_ERROR;
-    for (Tcl_Size i = 1; i < len; i++) {
-        double val;
-        if (Tcl_GetDoubleFromObj(interp, objv[i], &val) != TCL_OK)
-            return TCL_ERROR;
-        max = fmax(max, val);
+static Tcl_Obj *SweepMeasResult(Tcl_Interp *interp, const MeasSweep *sweepPtr, Tcl_Size run, Tcl_Size meas,
+                                Tcl_Obj *dataObj) {
+    const MeasStream *streamPtr = sweepPtr->streamPtr;
+    if (streamPtr->meas[meas].kind != STREAM_EVAL) {
+        if (sweepPtr->errors[run] != NULL) {
+            Tcl_SetObjResult(interp, sweepPtr->errors[run]);
+            return NULL;
+        }
+        MeasStream runStream = *streamPtr;
+        runStream.fed = sweepPtr->lens[run];
+        return StreamMeasResult(interp, &runStream, &sweepPtr->meas[run * streamPtr->measCount + meas]);
     }
-    *result = max;
-    return TCL_OK;
+    Tcl_Obj *keyObj = Tcl_NewStringObj("cmd", -1);
+    Tcl_Obj *cmdObj, *vecsObj;
+    Tcl_IncrRefCount(keyObj);
+    Tcl_DictObjGet(NULL, sweepPtr->plans[meas], keyObj, &cmdObj);
+    Tcl_SetStringObj(keyObj, "vecs", -1);
+    Tcl_DictObjGet(NULL, sweepPtr->plans[meas], keyObj, &vecsObj);
+    Tcl_DecrRefCount(keyObj);
+    Tcl_Size count = 0;
+    Tcl_Obj **indexes;
+    if ((vecsObj != NULL) && (Tcl_ListObjGetElements(interp, vecsObj, &count, &indexes) != TCL_OK)) {
+        return NULL;
+    }
+    /* the names of the vectors are replaced with the vectors of the run, as ::tclmeasure::Run does */
+    cmdObj = Tcl_DuplicateObj(cmdObj);
+    Tcl_IncrRefCount(cmdObj);
+    for (Tcl_Size i = 0; i < count; ++i) {
+        int index;
+        Tcl_Obj *nameObj, *vecObj;
+        if ((Tcl_GetIntFromObj(interp, indexes[i], &index) != TCL_OK) ||
+            (Tcl_ListObjIndex(interp, cmdObj, index, &nameObj) != TCL_OK) ||
+            (Tcl_DictObjGet(interp, dataObj, nameObj, &vecObj) != TCL_OK)) {
+            Tcl_DecrRefCount(cmdObj);
+            return NULL;
+        }
+        if (vecObj == NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("key \"%s\" not known in dictionary", Tcl_GetString(nameObj)));
+            Tcl_DecrRefCount(cmdObj);
+            return NULL;
+        }
+        Tcl_ListObjReplace(NULL, cmdObj, index, 1, 1, &vecObj);
+    }
+    int code = Tcl_EvalObjEx(interp, cmdObj, 0);
+    Tcl_DecrRefCount(cmdObj);
+    return (code == TCL_OK) ? Tcl_GetObjResult(interp) : NULL;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * findMinIndexObj --
+ * AccumulatorCmdProc2 --
  *
- *      Find the index of the minimum value in an array of Tcl_Obj pointers. Each element is expected to be a numeric
- *      Tcl object. The function scans the list, converts values to doubles, and returns the index of the smallest one.
+ *      Implements `::tclmeasure::accumulator create ?-quantiles list? ?-low value? ?-high value?`, creates the command
+ *      `::tclmeasure::accumulatorN` that collects statistics of the values pushed to it (see
+ *      AccumulatorHandleCmdProc2).
  *
  * Parameters:
- *      Tcl_Interp *interp        - input/output: interpreter used for error reporting on conversion failure
- *      Tcl_Obj *const objv[]     - input: array of Tcl_Obj pointers (expected to contain numeric values)
- *      Tcl_Size len              - input: number of elements in the array
- *      Tcl_Size *index           - output: pointer to store the index of the minimum value found
+ *      void *clientData              - input: pointer to the per-interpreter MeasConfig
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
+ *
+ *          objv[1] = create
+ *          -quantiles list  - optional, probabilities of the estimated quantiles, between 0 and 1
+ *          -low value       - optional, lower limit of the values that pass, gives the yield
+ *          -high value      - optional, upper limit of the values that pass, gives the yield
  *
  * Results:
- *      TCL_OK on success, with *index set to the position of the minimum value
- *      TCL_ERROR if:
- *          - len is zero or negative
- *          - any element cannot be converted to a double
+ *      TCL_OK with the fully qualified name of the handle command in the interpreter result.
+ *      TCL_ERROR on invalid options.
  *
  * Side Effects:
- *      On error, sets a message in the interpreter result
- *
- * Notes:
- *      - Uses strict `<` comparison; if multiple equal minimum values exist, the first is returned.
- *      - All values are interpreted as doubles during comparison.
+ *      Creates the handle command.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-int findMinIndexObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, Tcl_Size *index) {
-    if (len <= 0)
+static int AccumulatorCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasConfig *configPtr = (MeasConfig *)clientData;
+    static const char *const subcommands[] = {"create", NULL};
+    static const char *const options[] = {"-quantiles", "-low", "-high", NULL};
+    enum Options { OPT_QUANTILES, OPT_LOW, OPT_HIGH };
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "create ?-quantiles list? ?-low value? ?-high value?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
         return TCL_ERROR;
-    double minVal;
-    if (Tcl_GetDoubleFromObj(interp, objv[0], &minVal) != TCL_OK)
+    }
+    if (objc % 2) {
+        Tcl_WrongNumArgs(interp, 2, objv, "?-quantiles list? ?-low value? ?-high value?");
         return TCL_ERROR;
-    Tcl_Size minIdx = 0;
-    for (Tcl_Size i = 1; i < len; i++) {
-        double val;
-        if (Tcl_GetDoubleFromObj(interp, objv[i], &val) != TCL_OK)
+    }
+    Tcl_Size quantileCount = 0;
+    Tcl_Obj **probs = NULL;
+    int hasLimits = 0;
+    double low = -INFINITY, high = INFINITY;
+    for (Tcl_Size i = 2; i < objc; i += 2) {
+        int option;
+        if (Tcl_GetIndexFromObjStruct(interp, objv[i], options, sizeof(char *), "option", 0, &option) != TCL_OK) {
             return TCL_ERROR;
-        if (val < minVal) {
-            minVal = val;
-            minIdx = i;
         }
+        switch ((enum Options)option) {
+        case OPT_QUANTILES:
+            if (Tcl_ListObjGetElements(interp, objv[i + 1], &quantileCount, &probs) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            for (Tcl_Size j = 0; j < quantileCount; ++j) {
+                double p;
+                if (Tcl_GetDoubleFromObj(interp, probs[j], &p) != TCL_OK) {
+                    return TCL_ERROR;
+                }
+                if (!((p >= 0.0) && (p <= 1.0))) {
+                    Tcl_SetObjResult(interp, Tcl_ObjPrintf("Quantile probability '%s' is not between 0 and 1",
+                                                           Tcl_GetString(probs[j])));
+                    return TCL_ERROR;
+                }
+            }
+            break;
+        case OPT_LOW:
+        case OPT_HIGH:
+            if (Tcl_GetDoubleFromObj(interp, objv[i + 1], (option == OPT_LOW) ? &low : &high) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            hasLimits = 1;
+            break;
+        }
+    }
+    MeasAccumulator *accPtr = (MeasAccumulator *)Tcl_Alloc(sizeof(MeasAccumulator));
+    accPtr->token = NULL;
+    accPtr->hasLimits = hasLimits;
+    accPtr->low = low;
+    accPtr->high = high;
+    accPtr->quantileCount = quantileCount;
+    accPtr->quantiles = (MeasQuantile *)Tcl_Alloc(sizeof(MeasQuantile) * (quantileCount + 1));
+    for (Tcl_Size j = 0; j < quantileCount; ++j) {
+        Tcl_GetDoubleFromObj(NULL, probs[j], &accPtr->quantiles[j].p);
     }
-    *index = minIdx;
+    ResetAccumulator(accPtr);
+    /* skip names taken by other commands */
+    Tcl_Obj *nameObj;
+    Tcl_CmdInfo info;
+    do {
+        nameObj = Tcl_ObjPrintf("::tclmeasure::accumulator%ld", ++configPtr->accums);
+        if (!Tcl_GetCommandInfo(interp, Tcl_GetString(nameObj), &info)) {
+            break;
+        }
+        Tcl_DecrRefCount(nameObj);
+    } while (1);
+    accPtr->token = Tcl_CreateObjCommand2(interp, Tcl_GetString(nameObj), (Tcl_ObjCmdProc2 *)AccumulatorHandleCmdProc2,
+                                          accPtr, DeleteAccumulator);
+    Tcl_SetObjResult(interp, nameObj);
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * findMaxIndexObj --
+ * ResetAccumulator --
  *
- *      Find the index of the maximum value in an array of Tcl_Obj pointers. Each element is expected to represent
- *      a numeric value. The function converts each element to a double and returns the index of the largest one.
+ *      Forgets the values pushed to an accumulator.
  *
  * Parameters:
- *      Tcl_Interp *interp        - input/output: interpreter used for error reporting if conversion fails
- *      Tcl_Obj *const objv[]     - input: array of Tcl_Obj pointers (assumed to hold numeric values)
- *      Tcl_Size len              - input: number of elements in the array
- *      Tcl_Size *index           - output: pointer to store the index of the maximum value
+ *      MeasAccumulator *accPtr   - input/output: accumulator
  *
  * Results:
- *      TCL_OK on success, with *index set to the position of the maximum value
- *      TCL_ERROR if:
- *          - len is zero or negative
- *          - any element fails to convert to a double
+ *      None
  *
  * Side Effects:
- *      On failure, sets an error message in the interpreter
- *
- * Notes:
- *      - Uses strict `>` comparison; if multiple equal maximum values exist, the first is returned.
- *      - Comparison and value extraction are performed using double-precision floating point.
+ *      None
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-int findMaxIndexObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, Tcl_Size *index) {
-    if (len <= 0)
-        return TCL_ERROR;
-    double maxVal;
-    if (Tcl_GetDoubleFromObj(interp, objv[0], &maxVal) != TCL_OK)
-        return TCL_ERROR;
-    Tcl_Size maxIdx = 0;
-    for (Tcl_Size i = 1; i < len; i++) {
-        double val;
-        if (Tcl_GetDoubleFromObj(interp, objv[i], &val) != TCL_OK)
-            return TCL_ERROR;
-        if (val > maxVal) {
-            maxVal = val;
-            maxIdx = i;
-        }
-    }
-    *index = maxIdx;
-    return TCL_OK;
+static void ResetAccumulator(MeasAccumulator *accPtr) {
+    accPtr->count = 0;
+    accPtr->failed = 0;
+    accPtr->mean = 0.0;
+    accPtr->m2 = 0.0;
+    accPtr->min = INFINITY;
+    accPtr->max = -INFINITY;
+    accPtr->passed = 0;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * findPPObj --
+ * DeleteAccumulator --
  *
- *      Compute the peak-to-peak (PP) range of a list of Tcl_Obj values by summing the absolute values of the minimum
- *      and maximum elements. Each value is parsed as a double.
+ *      Frees an accumulator when its handle command is deleted.
  *
  * Parameters:
- *      Tcl_Interp *interp        - input/output: interpreter used for error reporting if conversion fails
- *      Tcl_Obj *const objv[]     - input: array of Tcl_Obj pointers (expected to contain numeric values)
- *      Tcl_Size len              - input: number of elements in the array
- *      double *result            - output: pointer to store the computed peak-to-peak range
+ *      void *clientData          - input: pointer to the MeasAccumulator
  *
  * Results:
- *      TCL_OK on success, with *result set to fabs(min) + fabs(max)
- *      TCL_ERROR if:
- *          - `findMinObj` or `findMaxObj` fails (due to invalid input or empty list)
+ *      None
  *
  * Side Effects:
- *      May set an error message in the interpreter if conversion fails
+ *      None
  *
- * Notes:
- *      - Unlike traditional peak-to-peak (max - min), this function returns `fabs(min) + fabs(max)`
- *        which is useful for symmetric or absolute range calculations.
- *      - All values are interpreted as double-precision numbers.
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static void DeleteAccumulator(void *clientData) {
+    MeasAccumulator *accPtr = (MeasAccumulator *)clientData;
+    Tcl_Free((char *)accPtr->quantiles);
+    Tcl_Free((char *)accPtr);
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * AccumulatorHandleCmdProc2 --
+ *
+ *      Implements the command of an accumulator created by `::tclmeasure::accumulator create`:
+ *          $acc push values ?-key name?  - pushes a list of values, as the results of a sweep; with -key the values
+ *                                          are dictionaries and the value of the key is pushed, as xdelta of
+ *                                          Trigger-Target results. Empty values count as failed runs. Without -key
+ *                                          a vector or a bytearray of whole doubles is pushed as binary doubles,
+ *                                          by the same rule as vector arguments (see IsBinaryVector()).
+ *          $acc result                   - returns the dictionary of statistics: count, failed, mean, sigma (sample
+ *                                          standard deviation), min, max, quantiles (dictionary with probabilities
+ *                                          as the keys) and, if limits were given, yield (the fraction of values
+ *                                          within the limits among all values, failed ones included)
+ *          $acc reset                    - forgets the pushed values
+ *          $acc destroy                  - deletes the command
+ *
+ * Parameters:
+ *      void *clientData              - input: pointer to the MeasAccumulator
+ *      Tcl_Interp *interp            - input/output: Tcl interpreter for error and result handling
+ *      Tcl_Size objc                 - input: number of command arguments
+ *      Tcl_Obj *const objv[]         - input: command arguments
+ *
+ * Results:
+ *      TCL_OK with the result of the subcommand; TCL_ERROR on invalid arguments or values, or if no value was pushed
+ *      when the result is asked for.
+ *
+ * Side Effects:
+ *      push and reset update the statistics, destroy deletes the command.
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-int findPPObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result) {
-    double min, max;
-    if (findMinObj(interp, objv, len, &min) != TCL_OK)
+static int AccumulatorHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
+    MeasAccumulator *accPtr = (MeasAccumulator *)clientData;
+    static const char *const subcommands[] = {"push", "result", "reset", "destroy", NULL};
+    enum Subcommands { SUB_PUSH, SUB_RESULT, SUB_RESET, SUB_DESTROY };
+    int sub;
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg ...?");
         return TCL_ERROR;
-    if (findMaxObj(interp, objv, len, &max) != TCL_OK)
+    }
+    if (Tcl_GetIndexFromObjStruct(interp, objv[1], subcommands, sizeof(char *), "subcommand", 0, &sub) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (sub == SUB_PUSH) {
+        if ((objc != 3) && ((objc != 5) || strcmp(Tcl_GetString(objv[3]), "-key"))) {
+            Tcl_WrongNumArgs(interp, 2, objv, "values ?-key name?");
+            return TCL_ERROR;
+        }
+        return PushAccumulator(interp, accPtr, objv[2], (objc == 5) ? objv[4] : NULL);
+    }
+    if (objc != 2) {
+        Tcl_WrongNumArgs(interp, 2, objv, NULL);
         return TCL_ERROR;
-    *result = fabs(min) + fabs(max);
+    }
+    switch ((enum Subcommands)sub) {
+    case SUB_RESULT: {
+        if (accPtr->count == 0) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("No values were pushed to the accumulator", -1));
+            return TCL_ERROR;
+        }
+        Tcl_Obj *resultDict = Tcl_NewDictObj();
+        Tcl_Obj *quantilesDict = Tcl_NewDictObj();
+        double sigma = (accPtr->count > 1) ? sqrt(accPtr->m2 / (double)(accPtr->count - 1)) : 0.0;
+        for (Tcl_Size j = 0; j < accPtr->quantileCount; ++j) {
+            Tcl_DictObjPut(NULL, quantilesDict, Tcl_NewDoubleObj(accPtr->quantiles[j].p),
+                           Tcl_NewDoubleObj(QuantileValue(&accPtr->quantiles[j], accPtr->count)));
+        }
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("count", -1), Tcl_NewWideIntObj(accPtr->count));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("failed", -1), Tcl_NewWideIntObj(accPtr->failed));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("mean", -1), Tcl_NewDoubleObj(accPtr->mean));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("sigma", -1), Tcl_NewDoubleObj(sigma));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("min", -1), Tcl_NewDoubleObj(accPtr->min));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("max", -1), Tcl_NewDoubleObj(accPtr->max));
+        Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("quantiles", -1), quantilesDict);
+        if (accPtr->hasLimits) {
+            Tcl_DictObjPut(NULL, resultDict, Tcl_NewStringObj("yield", -1),
+                           Tcl_NewDoubleObj((double)accPtr->passed / (double)(accPtr->count + accPtr->failed)));
+        }
+        Tcl_SetObjResult(interp, resultDict);
+        return TCL_OK;
+    }
+    case SUB_RESET:
+        ResetAccumulator(accPtr);
+        return TCL_OK;
+    case SUB_DESTROY:
+        Tcl_DeleteCommandFromToken(interp, accPtr->token);
+        return TCL_OK;
+    default:
+        break;
+    }
     return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * ListRange --
+ * PushAccumulator --
  *
- *      Create a new Tcl list consisting of a prefix element (`firstObj`), a subrange of elements from `listObj`,
- *      and a suffix element (`lastObj`). The subrange is defined by the `start` and `end` indices (inclusive).
+ *      Adds values to the statistics of an accumulator. All values are checked before the first one is added.
  *
  * Parameters:
- *      Tcl_Interp *interp        - input: interpreter used for memory management (and list manipulation)
- *      Tcl_Obj *listObj          - input: Tcl list object from which to extract a subrange
- *      Tcl_Size start            - input: starting index of the subrange (inclusive)
- *      Tcl_Size end              - input: ending index of the subrange (inclusive)
- *      Tcl_Obj *firstObj         - input: object to prepend to the result list
- *      Tcl_Obj *lastObj          - input: object to append to the result list
+ *      Tcl_Interp *interp        - input/output: interpreter for error reporting
+ *      MeasAccumulator *accPtr   - input/output: accumulator
+ *      Tcl_Obj *valuesObj        - input: list or vector of values, empty elements are failed measurements; a
+ *                                  bytearray is read as doubles only under `configure -binary`, see IsBinaryVector()
+ *      Tcl_Obj *keyObj           - input: key of the value in each element, NULL if the elements are the values
  *
  * Results:
- *      Returns a newly created Tcl list with the structure:
- *          [firstObj elem(start) ... elem(end) lastObj]
- *
- *      If the start/end indices are out of range or empty, the result will contain only:
- *          [firstObj lastObj]
+ *      TCL_OK on success; TCL_ERROR if a value is not a number or a key is missing, the accumulator is unchanged
  *
  * Side Effects:
- *      None (allocates a new list Tcl_Obj and returns it)
- *
- * Notes:
- *      - If `start >= listLen`, an empty subrange is used.
- *      - If `end >= listLen`, it is clamped to `listLen - 1`.
- *      - If `start > end` or the list is too short, no subrange is included between `firstObj` and `lastObj`.
+ *      None
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-Tcl_Obj *ListRange(Tcl_Interp *interp, Tcl_Obj *listObj, Tcl_Size start, Tcl_Size end, Tcl_Obj *firstObj,
-                   Tcl_Obj *lastObj) {
-    Tcl_Obj **elemPtrs;
-    Tcl_Size listLen;
-    Tcl_ListObjGetElements(interp, listObj, &listLen, &elemPtrs);
-    if (start >= listLen) {
-        start = listLen;
+static int PushAccumulator(Tcl_Interp *interp, MeasAccumulator *accPtr, Tcl_Obj *valuesObj, Tcl_Obj *keyObj) {
+    Tcl_Size len;
+    const double *values;
+    double *parsed = NULL;
+    if ((keyObj == NULL) &&
+        ((Tcl_FetchInternalRep(valuesObj, &measVectorType) != NULL) || IsBinaryVector(interp, valuesObj))) {
+        if (GetMeasVectorElements(interp, valuesObj, &len, &values) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    } else {
+        Tcl_Obj **elems;
+        if (Tcl_ListObjGetElements(interp, valuesObj, &len, &elems) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        /* NaN marks an empty element, numbers parsed by Tcl are never NaN */
+        parsed = (double *)Tcl_Alloc(sizeof(double) * (len + 1));
+        for (Tcl_Size i = 0; i < len; ++i) {
+            Tcl_Obj *valueObj = elems[i];
+            parsed[i] = NAN;
+            if (keyObj != NULL) {
+                Tcl_Size size;
+                if ((Tcl_DictObjSize(interp, elems[i], &size) != TCL_OK) ||
+                    ((size > 0) && (Tcl_DictObjGet(interp, elems[i], keyObj, &valueObj) != TCL_OK))) {
+                    Tcl_Free((char *)parsed);
+                    return TCL_ERROR;
+                }
+                if (size == 0) {
+                    continue;
+                }
+                if (valueObj == NULL) {
+                    Tcl_SetObjResult(interp, Tcl_ObjPrintf("key \"%s\" not known in dictionary",
+                                                           Tcl_GetString(keyObj)));
+                    Tcl_Free((char *)parsed);
+                    return TCL_ERROR;
+                }
+            }
+            /* numbers are checked first, so they don't get a string representation */
+            if (Tcl_GetDoubleFromObj(NULL, valueObj, &parsed[i]) == TCL_OK) {
+                continue;
+            }
+            if ((keyObj == NULL) && (Tcl_GetCharLength(valueObj) == 0)) {
+                continue;
+            }
+            Tcl_GetDoubleFromObj(interp, valueObj, &parsed[i]);
+            Tcl_Free((char *)parsed);
+            return TCL_ERROR;
+        }
+        values = parsed;
     }
-    if (end >= listLen) {
-        end = listLen - 1;
+    for (Tcl_Size i = 0; i < len; ++i) {
+        double x = values[i];
+        if (isnan(x)) {
+            accPtr->failed++;
+            continue;
+        }
+        for (Tcl_Size j = 0; j < accPtr->quantileCount; ++j) {
+            AddQuantileValue(&accPtr->quantiles[j], accPtr->count, x);
+        }
+        accPtr->count++;
+        double delta = x - accPtr->mean;
+        accPtr->mean += delta / (double)accPtr->count;
+        accPtr->m2 += delta * (x - accPtr->mean);
+        accPtr->min = fmin(accPtr->min, x);
+        accPtr->max = fmax(accPtr->max, x);
+        if ((x >= accPtr->low) && (x <= accPtr->high)) {
+            accPtr->passed++;
+        }
     }
-    if (start > end || start >= listLen) {
-        return Tcl_NewListObj(0, NULL);
+    if (parsed != NULL) {
+        Tcl_Free((char *)parsed);
     }
-    Tcl_Size rangeLen = end - start + 1;
-    Tcl_Obj *resultList = Tcl_NewListObj(0, NULL);
-    Tcl_ListObjAppendElement(interp, resultList, firstObj);
-    Tcl_ListObjAppendList(interp, resultList, Tcl_NewListObj(rangeLen, &elemPtrs[start]));
-    Tcl_ListObjAppendElement(interp, resultList, lastObj);
-    return resultList;
+    return TCL_OK;
 }
 
 /*
  *----------------------------------------------------------------------------------------------------------------------
  *
- * MinMaxPPMinAtMaxAtCmdProc2 --
+ * AddQuantileValue --
  *
- *      Implements a Tcl command that analyzes a segment of a (x, y) signal and computes a statistical result over
- *      that interval. Supported result types include min/max values, peak-to-peak range, and the x-location of
- *      the min/max value. The interval is defined by `xstart` and `xend`, and the command supports optional
- *      extraction of the segment as a dictionary.
+ *      Adds a value to the P-square estimate of a quantile (Jain and Chlamtac, 1985). The first five values become
+ *      the markers, later values move the markers that follow them by one position, and the three inner markers
+ *      that are off their desired positions by one or more are moved by one position, their heights predicted with
+ *      the piecewise-parabolic formula, or linearly when the parabola leaves the neighbouring heights.
  *
  * Parameters:
- *      void *clientData              - input: optional user data (unused)
- *      Tcl_Interp *interp            - input/output: interpreter for result and error reporting
- *      Tcl_Size objc                 - input: number of command arguments
- *      Tcl_Obj *const objv[]         - input: command arguments, expected as:
- *
- *          objv[1] = x        - list of X values (monotonically increasing)
- *          objv[2] = y        - list of Y values (aligned with X)
- *          objv[3] = xstart   - start of the range (inclusive)
- *          objv[4] = xend     - end of the range (inclusive)
- *          objv[5] = type     - operation to perform:
- *                                  "min"     => minimum value of y in range
- *                                  "max"     => maximum value of y in range
- *                                  "pp"      => peak-to-peak (fabs(min) + fabs(max))
- *                                  "minat"   => x value at which min(y) occurs
- *                                  "maxat"   => x value at which max(y) occurs
- *                                  "between" => dict with "x" and "y" lists between xstart and xend
+ *      MeasQuantile *quantPtr    - input/output: quantile estimate
+ *      Tcl_WideInt count         - input: number of values added before this one
+ *      double x                  - input: value
  *
  * Results:
- *      TCL_OK with one of the following:
- *          - A double value (min, max, pp)
- *          - A scalar X value where the min or max occurs
- *          - A dictionary {x -> list, y -> list} of the subrange
- *
- *      TCL_ERROR on:
- *          - incorrect argument count
- *          - failure to parse X or Y lists
- *          - mismatched X/Y lengths
- *          - xstart/xend outside of X range or invalid interval
- *          - unrecognized type keyword
+ *      None
  *
  * Side Effects:
- *      - Performs interpolation at the edges of the integration interval using `CalcYBetween`
- *      - Creates temporary lists to isolate subranges of x and y for processing
- *      - Allocates and returns result as either a scalar, list, or dictionary
- *
- * Notes:
- *      - The range [xstart, xend] must lie entirely within the input X domain
- *      - Subrange data includes interpolated boundary points at xstart and xend
- *      - Uses helper functions: `findMinObj`, `findMaxObj`, `findPPObj`, `findMinIndexObj`, `findMaxIndexObj`
- *      - Requires at least 2 X/Y samples in the interval to function correctly
+ *      None
  *
  *----------------------------------------------------------------------------------------------------------------------
  */
-static int MinMaxPPMinAtMaxAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]) {
-    if (objc != 6) {
-        Tcl_WrongNumArgs(interp, 5, objv, "x y xstart xend type");
-        return TCL_ERROR;
-    }
-    Tcl_Size xLen, yLen;
-    Tcl_Obj **xElems, **yElems;
-    if (Tcl_ListObjGetElements(interp, objv[1], &xLen, &xElems) == TCL_ERROR) {
-        return TCL_ERROR;
-    }
-    if (Tcl_ListObjGetElements(interp, objv[2], &yLen, &yElems) == TCL_ERROR) {
-        return TCL_ERROR;
+static void AddQuantileValue(MeasQuantile *quantPtr, Tcl_WideInt count, double x) {
+    double *q = quantPtr->q, *n = quantPtr->n;
+    double p = quantPtr->p;
+    if (count < 5) {
+        /* insertion into the sorted first values */
+        Tcl_Size i = (Tcl_Size)count;
+        for (; (i > 0) && (q[i - 1] > x); --i) {
+            q[i] = q[i - 1];
+        }
+        q[i] = x;
+        if (count == 4) {
+            for (int k = 0; k < 5; ++k) {
+                n[k] = k + 1;
+            }
+            quantPtr->np[0] = 1.0;
+            quantPtr->np[1] = 1.0 + 2.0 * p;
+            quantPtr->np[2] = 1.0 + 4.0 * p;
+            quantPtr->np[3] = 3.0 + 2.0 * p;
+            quantPtr->np[4] = 5.0;
+            quantPtr->dn[0] = 0.0;
+            quantPtr->dn[1] = p / 2.0;
+            quantPtr->dn[2] = p;
+            quantPtr->dn[3] = (1.0 + p) / 2.0;
+            quantPtr->dn[4] = 1.0;
+        }
+        return;
     }
-    double xstart;
-    Tcl_GetDoubleFromObj(interp, objv[3], &xstart);
-    double xend;
-    Tcl_GetDoubleFromObj(interp, objv[4], &xend);
-    int type;
-    const char *typeStr = Tcl_GetString(objv[5]);
-    if (!strcmp(typeStr, "min")) {
-        type = TYPE_MIN;
-    } else if (!strcmp(typeStr, "max")) {
-        type = TYPE_MAX;
-    } else if (!strcmp(typeStr, "pp")) {
-        type = TYPE_PP;
-    } else if (!strcmp(typeStr, "minat")) {
-        type = TYPE_MINAT;
-    } else if (!strcmp(typeStr, "maxat")) {
-        type = TYPE_MAXAT;
-    } else if (!strcmp(typeStr, "between")) {
-        type = TYPE_BETWEEN;
+    /* cell k of the value, q[k] <= x < q[k+1], the extreme markers follow the extrema */
+    int k;
+    if (x < q[0]) {
+        q[0] = x;
+        k = 0;
+    } else if (x >= q[4]) {
+        q[4] = x;
+        k = 3;
     } else {
-        return TCL_ERROR;
+        for (k = 0; x >= q[k + 1]; ++k) {
+        }
     }
-    if (xLen != yLen) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Length of x '%ld' is not equal to length of y '%ld'", xLen, yLen);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
+    for (int i = k + 1; i < 5; ++i) {
+        n[i] += 1.0;
     }
-    double xActualStart, xActualEnd;
-    Tcl_GetDoubleFromObj(interp, xElems[0], &xActualStart);
-    Tcl_GetDoubleFromObj(interp, xElems[xLen - 1], &xActualEnd);
-    if (xstart < xActualStart) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("Start of integration interval '%f' is outside the x values range", xstart);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else if (xend > xActualEnd) {
-        Tcl_Obj *errorMsg = Tcl_ObjPrintf("End of integration interval '%f' is outside the x values range", xend);
-        Tcl_SetObjResult(interp, errorMsg);
-        return TCL_ERROR;
-    } else if (xstart >= xend) {
-        Tcl_SetObjResult(
-            interp, Tcl_NewStringObj("Start of the integration should be lower than the end of the integration", -1));
-        return TCL_ERROR;
+    for (int i = 0; i < 5; ++i) {
+        quantPtr->np[i] += quantPtr->dn[i];
     }
-    int startFlagFound = 0;
-    int endFlagFound = 0;
-    double ystart = 0, yend;
-    int istart = 0, iend;
-    for (Tcl_Size i = 0; i < xLen - 1; ++i) {
-        double xi, xip1, yi, yip1;
-        Tcl_GetDoubleFromObj(interp, xElems[i], &xi);
-        Tcl_GetDoubleFromObj(interp, xElems[i + 1], &xip1);
-        Tcl_GetDoubleFromObj(interp, yElems[i], &yi);
-        Tcl_GetDoubleFromObj(interp, yElems[i + 1], &yip1);
-        if ((xi <= xstart) && (xip1 >= xstart) && !startFlagFound) {
-            ystart = CalcYBetween(xi, yi, xip1, yip1, xstart);
-            istart = i;
-            startFlagFound = 1;
-        } else if ((xi <= xend) && (xip1 >= xend) && !endFlagFound) {
-            yend = CalcYBetween(xi, yi, xip1, yip1, xend);
-            iend = i;
-            endFlagFound = 1;
-            break;
+    for (int i = 1; i < 4; ++i) {
+        double d = quantPtr->np[i] - n[i];
+        if (((d >= 1.0) && (n[i + 1] - n[i] > 1.0)) || ((d <= -1.0) && (n[i - 1] - n[i] < -1.0))) {
+            int s = (d > 0.0) ? 1 : -1;
+            double qp = q[i] + s / (n[i + 1] - n[i - 1]) *
+                                   ((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                                    (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+            if (!((q[i - 1] < qp) && (qp < q[i + 1]))) {
+                qp = q[i] + s * (q[i + s] - q[i]) / (n[i + s] - n[i]);
+            }
+            q[i] = qp;
+            n[i] += s;
         }
     }
-    Tcl_Obj *targetArrayObjs;
-    Tcl_Obj **targetArrayObjsElems;
-    Tcl_Size targetArrayLen;
-    if (endFlagFound) {
-        targetArrayObjs =
-            ListRange(interp, objv[2], istart + 1, iend, Tcl_NewDoubleObj(ystart), Tcl_NewDoubleObj(yend));
-        if (Tcl_ListObjGetElements(interp, targetArrayObjs, &targetArrayLen, &targetArrayObjsElems) == TCL_ERROR) {
-            return TCL_ERROR;
+}
+
+/*
+ *----------------------------------------------------------------------------------------------------------------------
+ *
+ * QuantileValue --
+ *
+ *      Gets the estimate of a quantile: the middle marker of the P-square algorithm, the extreme marker for the
+ *      probabilities 0 and 1, or the value interpolated between the sorted values while there are at most five of
+ *      them.
+ *
+ * Parameters:
+ *      const MeasQuantile *quantPtr - input: quantile estimate
+ *      Tcl_WideInt count            - input: number of added values, at least 1
+ *
+ * Results:
+ *      Estimate of the quantile
+ *
+ * Side Effects:
+ *      None
+ *
+ *----------------------------------------------------------------------------------------------------------------------
+ */
+static double QuantileValue(const MeasQuantile *quantPtr, Tcl_WideInt count) {
+    if (count > 5) {
+        /* the extreme markers are the exact extrema */
+        if (quantPtr->p == 0.0) {
+            return quantPtr->q[0];
         }
-        double result;
-        Tcl_Obj *targetXArrayObjs;
-        Tcl_Obj **targetXArrayObjsElems;
-        Tcl_Size targetXArrayLen;
-        switch ((enum Types)type) {
-        case TYPE_MIN:
-            findMinObj(interp, targetArrayObjsElems, targetArrayLen, &result);
-            Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
-            break;
-        case TYPE_MAX:
-            findMaxObj(interp, targetArrayObjsElems, targetArrayLen, &result);
-            Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
-            break;
-        case TYPE_PP:
-            findPPObj(interp, targetArrayObjsElems, targetArrayLen, &result);
-            Tcl_SetObjResult(interp, Tcl_NewDoubleObj(result));
-            break;
-        case TYPE_MINAT:
-            targetXArrayObjs =
-                ListRange(interp, objv[1], istart + 1, iend, Tcl_NewDoubleObj(xstart), Tcl_NewDoubleObj(xend));
-            if (Tcl_ListObjGetElements(interp, targetXArrayObjs, &targetXArrayLen, &targetXArrayObjsElems) ==
-                TCL_ERROR) {
-                return TCL_ERROR;
-            }
-            Tcl_Size minIndex;
-            findMinIndexObj(interp, targetArrayObjsElems, targetArrayLen, &minIndex);
-            Tcl_SetObjResult(interp, targetXArrayObjsElems[minIndex]);
-            break;
-        case TYPE_MAXAT:
-            targetXArrayObjs =
-                ListRange(interp, objv[1], istart + 1, iend, Tcl_NewDoubleObj(xstart), Tcl_NewDoubleObj(xend));
-            if (Tcl_ListObjGetElements(interp, targetXArrayObjs, &targetXArrayLen, &targetXArrayObjsElems) ==
-                TCL_ERROR) {
-                return TCL_ERROR;
-            }
-            Tcl_Size maxIndex;
-            findMaxIndexObj(interp, targetArrayObjsElems, targetArrayLen, &maxIndex);
-            Tcl_SetObjResult(interp, targetXArrayObjsElems[maxIndex]);
-            break;
-        case TYPE_BETWEEN:
-            targetXArrayObjs =
-                ListRange(interp, objv[1], istart + 1, iend, Tcl_NewDoubleObj(xstart), Tcl_NewDoubleObj(xend));
-            Tcl_Obj *resultDict = Tcl_NewDictObj();
-            Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("x", -1), targetXArrayObjs);
-            Tcl_DictObjPut(interp, resultDict, Tcl_NewStringObj("y", -1), targetArrayObjs);
-            Tcl_SetObjResult(interp, resultDict);
-            break;
-        };
-        return TCL_OK;
-    } else {
-        return TCL_ERROR;
+        return (quantPtr->p == 1.0) ? quantPtr->q[4] : quantPtr->q[2];
+    }
+    double pos = quantPtr->p * (double)(count - 1);
+    int i = (int)pos;
+    if (i >= count - 1) {
+        return quantPtr->q[count - 1];
     }
+    return quantPtr->q[i] + (pos - i) * (quantPtr->q[i + 1] - quantPtr->q[i]);
 }
@@ -13,25 +13,618 @@ enum FindDerivWhenSwitchId {
 enum Types { TYPE_MIN = 0, TYPE_MAX, TYPE_PP, TYPE_MINAT, TYPE_MAXAT, TYPE_BETWEEN };
 static const char *FindDerivWhenSwitches[] = {"when",       "wheneq",      "findwhen", "derivwhen",
                                               "findwheneq", "derivwheneq", NULL};
+
+/*
+ * Index of all crossings of one level by a vector, kept in the vector representation by GetCrossIndex(), so repeated
+ * searches of the same level are answered with binary searches instead of scans.
+ */
+typedef struct CrossIndex {
+    double val;      /* crossed level */
+    Tcl_Size count;  /* number of crossings, -1 while the index is not built */
+    Tcl_Size *segs;  /* increasing segments of the crossings */
+    Tcl_Size *rises; /* rises[k] is the number of rising crossings among segs[0..k] */
+} CrossIndex;
+
+/*
+ * Number of levels whose crossings are indexed per vector, the oldest level is replaced by a new one.
+ */
+#define MEAS_CROSS_LEVELS 4
+
+/*
+ * Cumulative trapezoidal integrals of a vector over an x vector, kept in the vector representation by
+ * GetCumIntegral(), so integrals over any window are differences of two entries.
+ */
+typedef struct CumIntegral {
+    Tcl_WideUInt xId; /* id of the representation of the x vector */
+    double *sum;      /* sum[i] is the sum of (y[k] + y[k+1]) * (x[k+1] - x[k]) over the segments before point i */
+    double *sumSq;    /* sumSq[i] is the same sum of (y[k]^2 + y[k+1]^2) * (x[k+1] - x[k]) */
+} CumIntegral;
+
+/*
+ * Range extrema index of a vector, kept in the vector representation by GetRangeIndex(): sparse table over blocks of
+ * MEAS_RANGE_BLOCK points, level k holds the extrema of 2^k consecutive blocks. Extrema skip NaN values, as fmin()
+ * and fmax() do, and refer to the first point that holds them.
+ */
+typedef struct RangeIndex {
+    Tcl_Size blocks;  /* number of whole blocks */
+    int levels;       /* number of levels of the table */
+    Tcl_Size *minIdx; /* minIdx[k * blocks + j] is the point of the smallest value of blocks [j, j + 2^k) */
+    Tcl_Size *maxIdx; /* maxIdx[k * blocks + j] is the point of the largest value of blocks [j, j + 2^k) */
+} RangeIndex;
+
+/*
+ * Number of points of a block of the range extrema index, points of partially covered blocks are scanned.
+ */
+#define MEAS_RANGE_BLOCK 256
+
+/*
+ * Uniform grid of an x vector: x[i] = x0 + i*dx within MEAS_GRID_TOL steps for every point. Searches along such a
+ * vector compute the index from the value and only check the neighbouring points.
+ */
+typedef struct MeasGrid {
+    double x0; /* first value */
+    double dx; /* step, (x[len-1] - x[0]) / (len - 1) */
+} MeasGrid;
+
+#define MEAS_GRID_TOL 1.0e-6
+
+enum Grids { GRID_UNKNOWN = 0, GRID_UNIFORM, GRID_IRREGULAR };
+
+/*
+ * Plot of an ngspice rawfile mapped into memory by `::tclmeasure::rawfile open`. Binary values are stored point by
+ * point, all variables of a point together, so a variable is read with a stride. The mapping is shared by the handle
+ * command and by the vectors that were not read yet. ASCII values are parsed into columns when the file is opened.
+ */
+typedef struct MeasRawFile {
+    Tcl_Size refCount;   /* handle command and unread vectors that use the mapping */
+    Tcl_Command token;   /* handle command, NULL once it is deleted */
+    const char *base;    /* mapped file */
+    size_t size;         /* size of the mapped file in bytes */
+    const char *values;  /* first value of the plot */
+    const char *end;     /* end of the values of the plot */
+    double **columns;    /* values of each variable of an ASCII plot until its vector is created, NULL if binary */
+    Tcl_Size points;     /* number of points of the plot in the file */
+    Tcl_Size vars;       /* number of variables, the first one is the scale (time, frequency, ...) */
+    int isComplex;       /* each value is a pair of doubles, real and imaginary part */
+    int isAscii;         /* values are written as text */
+    Tcl_Obj *infoObj;    /* dictionary returned by the info subcommand */
+    Tcl_Obj *namesObj;   /* list of the names of the variables */
+    Tcl_HashTable names; /* index of each variable by name */
+    Tcl_Obj **vecObjs;   /* vector of each variable, NULL until it is asked for */
+} MeasRawFile;
+
+/*
+ * Internal representation of the "measvector" Tcl_ObjType: numeric list packed into a contiguous array of doubles.
+ * It is shared between duplicated objects through reference counting.
+ */
+typedef struct MeasVectorRep {
+    Tcl_Size refCount;      /* number of Tcl_Obj that use this representation */
+    Tcl_Size len;           /* number of elements in data */
+    double *data;           /* packed values */
+    Tcl_Obj *listObj;       /* elements for list access, NULL until a script asks for them, parsed again from the
+                             * string of the object or created from the packed values */
+    Tcl_Obj *bytesObj;      /* bytearray the vector was built from, used for string generation, NULL if none */
+    int inPlace;            /* data points into bytesObj and is not freed */
+    int order;              /* ORDER_* state of the values, computed on the first monotonicity check */
+    Tcl_Size orderIdx;      /* index of the first element that breaks strict increase, if any */
+    CrossIndex *crossIndex; /* MEAS_CROSS_LEVELS searched levels, NULL before the first crossing search */
+    int crossNext;          /* entry of crossIndex replaced by the next new level */
+    Tcl_WideUInt id;        /* number that identifies the representation, never reused */
+    CumIntegral *cumPtr;    /* cumulative integrals over the last x vector, NULL if not built */
+    RangeIndex *rangePtr;   /* range extrema index, NULL if not built */
+    int rangeQueries;       /* number of windowed extrema queries, the index is built by the second one */
+    int grid;               /* GRID_* state of the values, computed on the first use as an x axis */
+    MeasGrid step;          /* origin and step of the values, valid if grid is GRID_UNIFORM */
+    MeasRawFile *rawPtr;    /* binary rawfile the data is read from on first use (ReadRawVector()), NULL once read */
+    Tcl_Size rawVar;        /* variable of rawPtr */
+} MeasVectorRep;
+
+enum Orders { ORDER_UNKNOWN = 0, ORDER_INCREASING, ORDER_UNORDERED };
+
+/*
+ * Vectors returned by the commands (-between windows, -cum series) are packed "measvector" objects when the core can
+ * read them as lists without shimmering, i.e. with the abstract list interface of Tcl 9. Otherwise they are plain
+ * lists of doubles. Define MEAS_PACKED_RESULTS to force packed results.
+ */
+#if defined(TCL_OBJTYPE_V2) && !defined(MEAS_PACKED_RESULTS)
+#define MEAS_PACKED_RESULTS 1
+#endif
+
+/*
+ * Per-interpreter settings changed with ::tclmeasure::configure and passed as client data to every command.
+ */
+typedef struct MeasConfig {
+    int checkX;       /* verify that x vectors are strictly increasing before using them */
+    int threads;      /* number of threads that share reductions over long ranges, 1 keeps them in the calling thread */
+    int reproducible; /* compute sums over fixed blocks, so they do not depend on the number of threads */
+    int cumulative;   /* integrate over windows with cumulative integrals cached in the vectors */
+    Tcl_Size streams; /* number of streams created in the interpreter, numbers their commands */
+    Tcl_Size files;   /* number of rawfiles opened in the interpreter, numbers their commands */
+    Tcl_Size sets;    /* number of datasets created in the interpreter, numbers their commands */
+    Tcl_Size accums;  /* number of accumulators created in the interpreter, numbers their commands */
+    int binary;       /* return vectors as bytearrays of little-endian doubles instead of lists */
+    int kernel;       /* KERNEL_* implementation of the range scans and crossing masks, never KERNEL_AUTO */
+} MeasConfig;
+
+enum ConfigOptions { CONFIG_CHECKX = 0, CONFIG_THREADS, CONFIG_REPRODUCIBLE, CONFIG_CUMULATIVE, CONFIG_BINARY };
+static const char *ConfigOptions[] = {"-checkx", "-threads", "-reproducible", "-cumulative", "-binary", NULL};
+
+/*
+ * Implementations of ScanRange() and of the crossing mask, "auto" is the fastest one supported by the CPU. The hidden
+ * configure option -kernel pins one of them in the interpreter, so the tests can run each of them.
+ */
+enum MeasKernels { KERNEL_AUTO = 0, KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2 };
+static const char *MeasKernels[] = {"auto", "scalar", "sse2", "avx2", NULL};
+
+/*
+ * Limits of the chunked execution: number of threads of a job, and the smallest number of segments handed to one
+ * thread, shorter ranges are not worth the synchronization.
+ */
+#define MEAS_MAX_THREADS 64
+#define MEAS_CHUNK_MIN 65536
+
+/*
+ * Smallest number of bytes of text parsed by one thread, see CountTextTokens().
+ */
+#define MEAS_TEXT_CHUNK_MIN (1 << 20)
+
+/*
+ * Number of segments summed by the kernel before the partial sums are combined pairwise in reproducible mode, a
+ * divisor of MEAS_CHUNK_MIN.
+ */
+#define MEAS_SUM_BLOCK 4096
+
+/*
+ * Procedure that processes one chunk of a job submitted to RunChunks().
+ */
+typedef void(MeasChunkProc)(void *clientData, int chunk);
+
+/*
+ * Worker pool used by RunChunks(), one per process.
+ */
+typedef struct MeasPool {
+    Tcl_Mutex mutex;                            /* protects the fields below */
+    Tcl_Mutex jobMutex;                         /* held while a job runs, jobs of different threads do not mix */
+    Tcl_Condition workCond;                     /* signaled when a job is submitted or the pool is stopped */
+    Tcl_Condition doneCond;                     /* signaled when the last chunk of the job is done */
+    Tcl_ThreadId threads[MEAS_MAX_THREADS - 1]; /* started worker threads */
+    int size;                                   /* number of started worker threads */
+    int shutdown;                               /* set to stop the workers */
+    MeasChunkProc *proc;                        /* chunk procedure of the current job */
+    void *clientData;                           /* data of the current job */
+    int chunks;                                 /* number of chunks of the current job */
+    int next;                                   /* next chunk to take */
+    int pending;                                /* chunks not finished yet */
+} MeasPool;
+
+/*
+ * Read-only view of the packed values of a vector object, filled by GetMeasVectorFromObj.
+ */
+typedef struct MeasVector {
+    Tcl_Size len;          /* number of elements */
+    const double *data;    /* pointer to the first element */
+    MeasVectorRep *repPtr; /* internal representation the data belongs to */
+} MeasVector;
+
+/*
+ * Results of ScanRange(), a single pass over a range of points of a vector.
+ */
+typedef struct RangeScan {
+    double min;      /* smallest value, start value on input */
+    double max;      /* largest value, start value on input */
+    Tcl_Size minIdx; /* index of the first occurrence of min, -1 if the start value was not improved */
+    Tcl_Size maxIdx; /* index of the first occurrence of max, -1 if the start value was not improved */
+    double sum;      /* sum of (y[i] + y[i+1]) * (x[i+1] - x[i]) over the segments of the range */
+    double sumSq;    /* sum of (y[i]^2 + y[i+1]^2) * (x[i+1] - x[i]) over the segments of the range */
+} RangeScan;
+
+enum ScanFlags { SCAN_EXTREMA = 1, SCAN_SUMS = 2 };
+
+/*
+ * Results of a single pass over a window of a vector, filled by WindowStats.
+ */
+typedef struct MeasStats {
+    double avg;   /* average value, trapezoidal integral divided by the window width */
+    double rms;   /* root mean square value */
+    double min;   /* minimum value */
+    double max;   /* maximum value */
+    double pp;    /* fabs(min) + fabs(max) */
+    double minAt; /* x of the first minimum */
+    double maxAt; /* x of the first maximum */
+} MeasStats;
+/*
+ * Crossing search of FindCrossing(): crossings of a level by vector y, or crossings of vectors y and y2.
+ */
+typedef struct CrossSearch {
+    const double *y;            /* vector that crosses the level, left side of a crossing between two vectors */
+    const double *y2;           /* right side of a crossing between two vectors, NULL to search for crossings of val */
+    double val;                 /* level to cross, unused if y2 is not NULL */
+    int cond;                   /* kind of crossing, one of enum Conditions */
+    const CrossIndex *indexPtr; /* built index of the crossings of val by y, NULL to check the segments */
+    Tcl_WideUInt (*crossMask)(const struct CrossSearch *searchPtr, Tcl_Size i, int n); /* kernel of the interpreter */
+} CrossSearch;
+
+/*
+ * Implementations of ScanRange() and of the crossing mask for one instruction set, see GetKernel().
+ */
+typedef struct MeasKernel {
+    void (*scanRange)(const double *x, const double *y, Tcl_Size first, Tcl_Size last, int flags, RangeScan *scanPtr);
+    Tcl_WideUInt (*crossMask)(const CrossSearch *searchPtr, Tcl_Size i, int n);
+} MeasKernel;
+
+/*
+ * Job of ScanRange() on the worker pool, chunk c scans the points [bounds[c], bounds[c+1]], or the blocks of segments
+ * [bounds[c], bounds[c+1]) if blockSums is set.
+ */
+typedef struct ScanChunks {
+    const double *x;
+    const double *y;
+    Tcl_Size first;                        /* first point of the range */
+    Tcl_Size last;                         /* last point of the range */
+    int flags;
+    void (*scanRange)(const double *x, const double *y, Tcl_Size first, Tcl_Size last, int flags, RangeScan *scanPtr);
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1];
+    RangeScan scans[MEAS_MAX_THREADS];
+    Tcl_Size blocks;                       /* number of blocks of MEAS_SUM_BLOCK segments in reproducible mode */
+    double *blockSums;                     /* sums of each block followed by sums of squares, NULL if not used */
+} ScanChunks;
+
+/*
+ * Job of FindCrossing() and CollectCrossings() on the worker pool, chunk c checks the segments [bounds[c],
+ * bounds[c+1]).
+ */
+typedef struct CrossChunks {
+    const CrossSearch *searchPtr;
+    const Tcl_Size *bounds;
+    Tcl_WideInt counts[MEAS_MAX_THREADS]; /* number of crossings in each chunk */
+    Tcl_Size offsets[MEAS_MAX_THREADS];   /* index of the first crossing of each chunk in hits */
+    Tcl_Size *hits;                       /* segments of all crossings */
+} CrossChunks;
+
+/*
+ * Job of FindLevels() on the worker pool, chunk c counts the crossings of the levels that are still searched among
+ * segments [bounds[c], bounds[c+1]).
+ */
+typedef struct LevelChunks {
+    const CrossSearch *searches; /* search of each level */
+    int levels;                  /* number of levels */
+    const Tcl_Size *bounds;
+    const Tcl_Size *hits;        /* segment of each level, levels with a segment are not counted */
+    Tcl_WideInt *counts;         /* crossings of level l in chunk c at counts[c * levels + l] */
+} LevelChunks;
+
+/*
+ * Job of CountTextTokens() and StoreTextTokens() on the worker pool: the numbers of a text are split at blanks, and at
+ * commas and semicolons for tables, token k goes to column k % stride at row k / stride. Chunk c handles the tokens
+ * that start in [bounds[c], bounds[c+1]), so a number split by a chunk boundary belongs to the first chunk.
+ */
+typedef struct TextChunks {
+    const char *text;                       /* start of the text */
+    size_t len;                             /* length of the text */
+    int chunks;                             /* number of chunks */
+    size_t bounds[MEAS_MAX_THREADS + 1];    /* offsets of the chunks in the text */
+    int commas;                             /* commas separate numbers, otherwise they end the real part of a complex
+                                             * value */
+    int rows;                               /* each line of the text holds whole rows, checked while storing */
+    Tcl_Size stride;                        /* number of tokens of a row */
+    Tcl_Size points;                        /* number of rows to store, later tokens are not parsed */
+    double **columns;                       /* values of each token of a row, NULL for tokens that are skipped */
+    Tcl_WideInt counts[MEAS_MAX_THREADS];   /* number of tokens of each chunk */
+    Tcl_WideInt firsts[MEAS_MAX_THREADS];   /* index of the first token of each chunk */
+    const char *invalid[MEAS_MAX_THREADS];  /* first token of each chunk that is not a number, NULL if none */
+    const char *ragged[MEAS_MAX_THREADS];   /* first token of each chunk that starts a line in the middle of a row */
+} TextChunks;
+
+/*
+ * Job of ColumnsCmdProc2() on the worker pool: the same window of many vectors, chunk c reduces the vectors
+ * [bounds[c], bounds[c+1]), each one by a single thread.
+ */
+typedef struct ColumnChunks {
+    const MeasConfig *configPtr;           /* settings of the interpreter with a single thread */
+    const double *x;
+    const double **ys;                     /* values of each vector */
+    const CumIntegral **cums;              /* cumulative integrals of each vector, NULL entries to sum the samples */
+    const RangeIndex **ranges;             /* range extrema index of each vector, NULL entries to scan the samples */
+    Tcl_Size istart;                       /* segment that contains xstart */
+    Tcl_Size iend;                         /* segment that contains xend */
+    double xstart;
+    double xend;
+    int sums;                              /* integrals are needed, otherwise only the extrema are scanned */
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1];
+    MeasStats *stats;                      /* computed values of each vector */
+} ColumnChunks;
+
+/*
+ * Crossing search of a streamed Trigger-Target measurement, carried from chunk to chunk.
+ */
+typedef struct StreamCross {
+    int vec;           /* vector of the stream that crosses the level */
+    double val;        /* level to cross */
+    int cond;          /* kind of crossing, one of enum Conditions */
+    Tcl_WideInt count; /* 1-based number of the crossing, -1 for the last one */
+    Tcl_WideInt left;  /* number of the crossing among the ones not fed yet */
+    double delay;      /* only segments that start at or after delay are checked */
+    int found;         /* the crossing was found, for the last one at least one crossing was found */
+    double x;          /* x of the crossing */
+} StreamCross;
+
+/*
+ * Window of a streamed Integ, Avg, Rms, Stats, Min, Max, PP, MinAt or MaxAt measurement. Points are summed once the
+ * next point is fed, the last fed point is the end of the window until `to` is reached. Also used for Find-At, which
+ * is the start value of a window that begins at the given x.
+ */
+typedef struct StreamWindow {
+    int vec;               /* vector of the stream */
+    double from;           /* start of the window */
+    double to;             /* end of the window, +Inf if not given */
+    int state;             /* one of enum WindowStates */
+    double xstart, ystart; /* start of the window and value interpolated there */
+    double sqStart;        /* square of y interpolated at xstart */
+    double xc, yc, sqc;    /* last summed point, its value and its square, the start point before the first one */
+    double integ;          /* trapezoidal integral of y from xstart to xc */
+    double integSq;        /* trapezoidal integral of y^2 from xstart to xc */
+    double min, max;       /* extrema from xstart to xc */
+    double minAt, maxAt;   /* x of the first minimum and maximum from xstart to xc */
+    double xa, ya, xb, yb; /* segment that holds the end of the window */
+    double xend;           /* end of the window, `to` once reached, xb before */
+} StreamWindow;
+
+enum WindowStates { WINDOW_BEFORE = 0, WINDOW_OPEN, WINDOW_CLOSED, WINDOW_MISSED };
+
+/*
+ * Measurement of a stream, given by the command of its plan (see ::tclmeasure::Plan).
+ */
+typedef struct StreamMeas {
+    Tcl_Obj *nameObj;    /* name of the measurement in a batch, NULL for a single measurement */
+    int kind;            /* one of enum StreamKinds, STREAM_EVAL only in a sweep */
+    int result;          /* value returned by a window, one of enum StreamResults */
+    int hasFrom;         /* the start of the window was given, otherwise it is the first fed x value */
+    StreamCross trig;    /* trigger search of STREAM_TRIGTARG */
+    StreamCross targ;    /* target search of STREAM_TRIGTARG */
+    StreamWindow window; /* window of STREAM_WINDOW */
+} StreamMeas;
+
+enum StreamKinds { STREAM_TRIGTARG = 0, STREAM_WINDOW, STREAM_EVAL };
+enum StreamResults {
+    RESULT_INTEG = 0,
+    RESULT_AVG,
+    RESULT_RMS,
+    RESULT_STATS,
+    RESULT_MIN,
+    RESULT_MAX,
+    RESULT_PP,
+    RESULT_MINAT,
+    RESULT_MAXAT,
+    RESULT_FINDAT
+};
+
+/*
+ * Measurements fed with chunks of data by the command of a stream (see StreamCmdProc2). Memory does not depend on
+ * the amount of fed data, the last fed sample of every vector is kept to check the segment that joins two chunks.
+ */
+typedef struct MeasStream {
+    MeasConfig *configPtr;  /* settings of the interpreter */
+    Tcl_Command token;      /* command of the stream */
+    Tcl_Size vecCount;      /* number of vectors used by the measurements, vector 0 is the x axis */
+    Tcl_Obj **vecNames;     /* names of the vectors in the data dictionaries */
+    double *last;           /* last fed value of each vector */
+    double *joint;          /* two points per vector, the last fed one and the first one of a chunk */
+    const double **chunks;  /* values of each vector in the chunk being fed, then each vector in joint */
+    Tcl_WideInt fed;        /* number of fed points */
+    int batch;              /* the result is a dictionary of the results of named measurements */
+    Tcl_Size measCount;     /* number of measurements */
+    StreamMeas *meas;       /* measurements */
+} MeasStream;
+
+/*
+ * Sweep of measurements over many runs of the same circuit, see SweepCmdProc2(). The measurements are set up once as
+ * the ones of a stream, every run gets its own copy of them and is fed at once by the worker pool. Measurements that
+ * can't be streamed are evaluated by the interpreter for each run.
+ */
+typedef struct MeasSweep {
+    MeasStream *streamPtr;                 /* measurements and vectors, copied for every run */
+    MeasConfig config;                     /* settings of the interpreter with a single thread per run */
+    Tcl_Obj **plans;                       /* plan of each measurement, evaluated for STREAM_EVAL ones */
+    Tcl_Size runs;                         /* number of runs */
+    const double **vecs;                   /* values of the vectors of the stream, vecCount pointers per run */
+    Tcl_Size *lens;                        /* number of points of each run */
+    Tcl_Obj **errors;                      /* error of each run whose vectors are invalid, NULL for valid ones */
+    StreamMeas *meas;                      /* measurements of each run, measCount per run */
+    Tcl_Size bounds[MEAS_MAX_THREADS + 1]; /* runs of each chunk */
+} MeasSweep;
+
+/*
+ * Dataset created by `::tclmeasure::dataset create`: named vectors of the same length, converted and checked once, with
+ * a strictly increasing x vector. The vectors are private objects, the handle returns new objects that share their
+ * representation, so scripts that use the returned values as strings or lists don't drop the cached data.
+ */
+typedef struct MeasDataset {
+    Tcl_Command token;   /* handle command */
+    Tcl_Obj *xnameObj;   /* name of the x vector */
+    Tcl_Obj *columnsObj; /* dictionary of the vectors by name */
+    Tcl_Size len;        /* length of all vectors */
+} MeasDataset;
+
+/*
+ * Streaming estimate of a quantile with the P-square algorithm: five markers track the minimum, the p/2, p, (1+p)/2
+ * quantiles and the maximum of the pushed values, their heights are adjusted with a piecewise-parabolic formula as
+ * the values arrive. The first five values are kept in `q` as they are.
+ */
+typedef struct MeasQuantile {
+    double p;     /* probability of the quantile, in [0, 1] */
+    double q[5];  /* heights of the markers */
+    double n[5];  /* positions of the markers, 1-based */
+    double np[5]; /* desired positions of the markers */
+    double dn[5]; /* increments of the desired positions for every value */
+} MeasQuantile;
+
+/*
+ * Accumulator created by `::tclmeasure::accumulator create`: statistics of measurement results pushed to it, with
+ * memory that does not depend on the number of values. Mean and variance follow Welford's algorithm.
+ */
+typedef struct MeasAccumulator {
+    Tcl_Command token;       /* handle command */
+    Tcl_WideInt count;       /* number of pushed values */
+    Tcl_WideInt failed;      /* number of pushed empty values, measurements that failed on a run */
+    double mean;             /* mean of the values */
+    double m2;               /* sum of the squared differences from the mean */
+    double min, max;         /* extrema of the values */
+    int hasLimits;           /* a limit was given, the yield is computed */
+    double low, high;        /* limits of the values that pass, -Inf and +Inf if not given */
+    Tcl_WideInt passed;      /* number of values within the limits */
+    Tcl_Size quantileCount;  /* number of estimated quantiles */
+    MeasQuantile *quantiles; /* estimated quantiles */
+} MeasAccumulator;
 const char *TclGetUnqualifiedName(const char *qualifiedName);
 extern DLLEXPORT int Tclmeasure_Init(Tcl_Interp *interp);
+static void ScanRangeScalar(const double *x, const double *y, Tcl_Size first, Tcl_Size last, int flags,
+                            RangeScan *scanPtr);
+static void ScanRangeLanes(const double *x, const double *y, Tcl_Size first, Tcl_Size done, Tcl_Size last, int flags,
+                           const double *laneMin, const double *laneMinIdx, const double *laneMax,
+                           const double *laneMaxIdx, double *acc, double *accSq, double min, double max,
+                           Tcl_Size minIdx, Tcl_Size maxIdx, RangeScan *scanPtr);
+static Tcl_WideUInt CrossMaskScalar(const CrossSearch *searchPtr, Tcl_Size i, int n);
+static int KernelSupported(int kernel);
+static int BestKernel(void);
+static const MeasKernel *GetKernel(const MeasConfig *configPtr);
+static int SplitRange(const MeasConfig *configPtr, Tcl_Size first, Tcl_Size end, Tcl_Size minLen,
+                      Tcl_Size *bounds);
+static void RunChunks(int chunks, MeasChunkProc *proc, void *clientData);
+static void ScanRange(const MeasConfig *configPtr, const double *x, const double *y, Tcl_Size first, Tcl_Size last,
+                      int flags, RangeScan *scanPtr);
+static Tcl_Size FindCrossing(const MeasConfig *configPtr, const CrossSearch *searchPtr, Tcl_Size first, Tcl_Size end,
+                             Tcl_WideInt count);
+static CrossIndex *GetCrossIndex(const MeasConfig *configPtr, MeasVectorRep *repPtr, double val);
+static Tcl_Size IndexBound(const CrossIndex *indexPtr, Tcl_Size seg);
+static Tcl_Size IndexRank(const CrossIndex *indexPtr, int cond, Tcl_Size k);
+static Tcl_Size *CollectCrossings(const MeasConfig *configPtr, const CrossSearch *searchPtr, Tcl_Size first,
+                                  Tcl_Size end, Tcl_Size *countPtr);
+static void FindLevels(const MeasConfig *configPtr, const CrossSearch *searches, int levels, Tcl_Size first,
+                       Tcl_Size end, Tcl_WideInt count, Tcl_Size *hits);
+static void CountLevelsProc(void *clientData, int chunk);
 static inline double CalcXBetween(double x1, double y1, double x2, double y2, double yBetween);
 static inline double CalcYBetween(double x1, double y1, double x2, double y2, double xBetween);
 static inline double CalcCrossPoint(double x11, double y11, double x21, double y21, double x12, double y12, double x22,
                                     double y22);
 static int TrigTargCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int TrigTargLevelsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int WhenLevelsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static CrossSearch *GetLevelsFromObj(Tcl_Interp *interp, const MeasConfig *configPtr, Tcl_Obj *objPtr,
+                                     const double *y, int cond, int *levelsPtr);
+static int GetCondFromObjs(Tcl_Interp *interp, Tcl_Obj *condObj, Tcl_Obj *countObj, int *condPtr,
+                           Tcl_WideInt *countPtr);
+static double FindDerivValue(const double *x, Tcl_Size len, const double *findVec, Tcl_Size i, double xWhen,
+                             int derivMode);
 static int FindDerivWhenCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
 static int FindAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
 static int DerivAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
-static void DerivSelect(Tcl_Interp *interp, Tcl_WideInt i, double xi, double xwhen, double xip1, Tcl_WideInt xlen,
-                        Tcl_Obj **x, Tcl_Obj **vec, double ywhen, double *out, int *pos);
+static void DerivSelect(Tcl_WideInt i, double xi, double xwhen, double xip1, Tcl_WideInt xlen, const double *x,
+                        const double *vec, double ywhen, double *out, int *pos);
 static double Deriv(double xim1, double xi, double xip1, double yim1, double yi, double yip1, int type);
+static int IntegSegments(Tcl_Interp *interp, const double *x, const MeasGrid *gridPtr, Tcl_Size len, double xstart,
+                         double xend, Tcl_Size *istartPtr, Tcl_Size *iendPtr);
+static const RangeIndex *GetRangeIndex(const MeasConfig *configPtr, Tcl_Obj *yObj);
+static void ScanExtrema(const MeasConfig *configPtr, const RangeIndex *rangePtr, const double *y, Tcl_Size first,
+                        Tcl_Size last, RangeScan *scanPtr);
+static void WindowExtrema(const double *x, const double *y, Tcl_Size istart, Tcl_Size iend, double xstart, double xend,
+                          double ystart, double yend, const RangeScan *scanPtr, MeasStats *statsPtr);
+static const CumIntegral *GetCumIntegral(const MeasConfig *configPtr, Tcl_Obj *xObj, Tcl_Obj *yObj);
+static double IntegTrapz(const MeasConfig *configPtr, const CumIntegral *cumPtr, const double *x, const double *y,
+                         Tcl_Size istart, Tcl_Size iend, double xstart, double xend, int squared);
 static int IntegCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int AvgRms(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[], int squared);
+static int AvgCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int RmsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static void WindowStats(const MeasConfig *configPtr, const CumIntegral *cumPtr, const RangeIndex *rangePtr,
+                        const double *x, const double *y, Tcl_Size istart, Tcl_Size iend, double xstart, double xend,
+                        MeasStats *statsPtr);
+static Tcl_Obj *NewStatsObj(const MeasStats *statsPtr);
+static int StatsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int ColumnsCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static void ColumnChunkProc(void *clientData, int chunk);
 static int MinMaxPPMinAtMaxAtCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
-Tcl_Obj *ListRange(Tcl_Interp *interp, Tcl_Obj *listObj, Tcl_Size start, Tcl_Size end, Tcl_Obj *firstObj,
-                   Tcl_Obj *lastObj);
-int findMinObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result);
-int findMaxObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result);
-int findMinIndexObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, Tcl_Size *index);
-int findMaxIndexObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, Tcl_Size *index);
-int findPPObj(Tcl_Interp *interp, Tcl_Obj *const objv[], Tcl_Size len, double *result);
+static void FreeMeasVectorInternalRep(Tcl_Obj *objPtr);
+static void DupMeasVectorInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *dupPtr);
+static void UpdateStringOfMeasVector(Tcl_Obj *objPtr);
+static int SetMeasVectorFromAny(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static MeasVectorRep *NewMeasVectorRep(double *data, Tcl_Size len);
+static Tcl_Obj *NewMeasVectorObj(const MeasConfig *configPtr, double *data, Tcl_Size len);
+static int IsBinaryVector(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static int SetMeasVectorFromBytes(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static void CopyLittleEndian(void *dst, const void *src, Tcl_Size len);
+static int VectorCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+#ifdef TCL_OBJTYPE_V2
+static Tcl_Obj *GetMeasVectorList(Tcl_Obj *objPtr);
+static Tcl_Size MeasVectorLength(Tcl_Obj *objPtr);
+static int MeasVectorIndex(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size index, Tcl_Obj **elemObjPtr);
+static int MeasVectorGetElements(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size *objcPtr, Tcl_Obj ***objvPtr);
+#endif
+static int GetMeasVectorFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr, MeasVector *vecPtr);
+static int GetMeasVectorElements(Tcl_Interp *interp, Tcl_Obj *objPtr, Tcl_Size *lenPtr, const double **elemsPtr);
+static int GetMeasXElements(Tcl_Interp *interp, MeasConfig *configPtr, Tcl_Obj *objPtr, Tcl_Size *lenPtr,
+                            const double **elemsPtr, const MeasGrid **gridPtrPtr);
+static const MeasGrid *GetMeasGrid(MeasVectorRep *repPtr);
+static int CheckIncreasing(Tcl_Interp *interp, MeasVectorRep *repPtr);
+static int GetBoundFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr, const double *x, Tcl_Size len, int atEnd,
+                           double *valuePtr);
+static Tcl_Size LowerBound(const double *x, const MeasGrid *gridPtr, Tcl_Size first, Tcl_Size last, double val);
+static Tcl_Size FindSegment(const double *x, const MeasGrid *gridPtr, Tcl_Size len, double val, Tcl_Size from);
+static int ConfigureCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static void FreeMeasConfig(void *clientData, Tcl_Interp *interp);
+static int NewStreamCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int StreamVector(MeasStream *streamPtr, Tcl_Obj *nameObj);
+static int ParseStreamMeas(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *cmdObj, StreamMeas *measPtr);
+static int ParseStreamCross(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *vecObj, Tcl_Obj *valObj,
+                            Tcl_Obj *condObj, Tcl_Obj *countObj, Tcl_Obj *delayObj, StreamCross *crossPtr);
+static void ResetStream(MeasStream *streamPtr);
+static void FreeStream(void *clientData);
+static int StreamCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int FeedStream(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *dataObj);
+static void FeedStreamPoints(MeasStream *streamPtr, const double *const *vecs, Tcl_Size n);
+static void FeedStreamCross(const MeasConfig *configPtr, StreamCross *crossPtr, const double *x, const double *y,
+                            Tcl_Size n);
+static void FeedStreamWindow(const MeasConfig *configPtr, StreamWindow *winPtr, const double *x, const double *y,
+                             Tcl_Size n);
+static void SumStreamWindow(const MeasConfig *configPtr, StreamWindow *winPtr, const double *x, const double *y,
+                            Tcl_Size p, Tcl_Size q);
+static Tcl_Obj *StreamMeasResult(Tcl_Interp *interp, const MeasStream *streamPtr, const StreamMeas *measPtr);
+static MeasStream *NewStream(Tcl_Interp *interp, MeasConfig *configPtr, Tcl_Obj *xnameObj, Tcl_Size count,
+                             Tcl_Obj *const *names, Tcl_Obj *const *cmds, int evalOthers);
+static int GetStreamVectors(Tcl_Interp *interp, MeasStream *streamPtr, Tcl_Obj *dataObj, const double **vecs,
+                            Tcl_Size *lenPtr);
+static void StartStreamWindows(MeasStream *streamPtr, double x0);
+static int RawfileCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int MapFile(Tcl_Interp *interp, Tcl_Obj *pathObj, const char **basePtr, size_t *sizePtr);
+static void UnmapFile(const char *base, size_t size);
+static int ParseRawHeader(Tcl_Interp *interp, MeasRawFile *rawPtr, const char *path, int plot);
+static int ParseRawVariable(const char *line, const char *end, Tcl_Obj *namesObj, Tcl_Obj *typesObj);
+static void ReleaseRawFile(MeasRawFile *rawPtr);
+static void DeleteRawHandle(void *clientData);
+static int RawHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int GetRawVector(Tcl_Interp *interp, MeasRawFile *rawPtr, Tcl_Obj *nameObj, Tcl_Obj **vecObjPtr);
+static void ReadRawVector(MeasVectorRep *repPtr);
+static const char *FindPlotEnd(const char *pos, const char *end);
+static int ParseRawValues(Tcl_Interp *interp, const MeasConfig *configPtr, MeasRawFile *rawPtr, const char *path);
+static int ReadTableCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static inline int IsTextSeparator(char c, int commas);
+static int ParseTextNumber(const char *p, const char *end, double *valPtr);
+static Tcl_WideInt CountTextTokens(const MeasConfig *configPtr, TextChunks *jobPtr);
+static void CountTokensProc(void *clientData, int chunk);
+static int StoreTextTokens(Tcl_Interp *interp, const MeasConfig *configPtr, TextChunks *jobPtr, const char *path);
+static void StoreTokensProc(void *clientData, int chunk);
+static int DatasetCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int AddDatasetVector(Tcl_Interp *interp, MeasDataset *dsPtr, Tcl_Obj *nameObj, Tcl_Obj *vecObj);
+static Tcl_Obj *ShareMeasVector(Tcl_Obj *objPtr);
+static void DeleteDataset(void *clientData);
+static int DatasetHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int SweepCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static void SweepRunsProc(void *clientData, int chunk);
+static Tcl_Obj *SweepMeasResult(Tcl_Interp *interp, const MeasSweep *sweepPtr, Tcl_Size run, Tcl_Size meas,
+                                Tcl_Obj *dataObj);
+static int AccumulatorCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static void ResetAccumulator(MeasAccumulator *accPtr);
+static void DeleteAccumulator(void *clientData);
+static int AccumulatorHandleCmdProc2(void *clientData, Tcl_Interp *interp, Tcl_Size objc, Tcl_Obj *const objv[]);
+static int PushAccumulator(Tcl_Interp *interp, MeasAccumulator *accPtr, Tcl_Obj *valuesObj, Tcl_Obj *keyObj);
+static void AddQuantileValue(MeasQuantile *quantPtr, Tcl_WideInt count, double x);
+static double QuantileValue(const MeasQuantile *quantPtr, Tcl_WideInt count);
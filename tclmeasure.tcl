@@ -3,7 +3,34 @@ package provide tclmeasure 0.5
 
 namespace eval ::tclmeasure {
     namespace import ::tcl::mathop::*
-    namespace export measure
+    namespace export measure compile stream rawfile readtable vector dataset sweep accumulator
+    variable keysList {trig targ find when at integ deriv avg min max pp rms minat maxat between stats}
+    variable definition {
+        {-xname= -help {Name of x list in data dictionary. This list must be strictly increaing without duplicate\
+                                elements}}
+        {-data= -help {Dictionary that contains lists with names as the keys and lists as the values}}
+        {-dataset= -help {Dataset command created by `dataset create`, gives the x list name and the data dictionary}}
+        {-trig= -require targ -allow {data xname dataset targ} -help {Conditions for trigger, selects Trigger-Target\
+                                                                      measurement}}
+        {-targ= -require trig -allow {data xname dataset trig}  -help {Conditions for target}}
+        {-find= -allow {data xname dataset when at} -help {Conditions for Find-When or Find-At mode}}
+        {-when= -allow {data xname dataset find deriv} -help {Conditions for Find-When or Deriv-When modes}}
+        {-at= -type double -allow {data xname dataset find deriv} -help {Time for Find-At or Deriv-At modes}}
+        {-integ= -allow {data xname dataset} -help {Conditions for Integ mode}}
+        {-deriv= -allow {data xname dataset deriv when at} -help {Conditions for Deriv-At mode}}
+        {-avg= -allow {data xname dataset} -help {Conditions for finding average value across the interval}}
+        {-min= -allow {data xname dataset} -help {Conditions for finding minimum value in the interval}}
+        {-max= -allow {data xname dataset} -help {Conditions for finding maximum value in the interval}}
+        {-pp= -allow {data xname dataset} -help {Conditions for finding peak to peak value in the interval}}
+        {-rms= -allow {data xname dataset} -help {Conditions for finding root meas square value across the interval}}
+        {-minat= -allow {data xname dataset} -help {Conditions for finding time of minimum value in the interval}}
+        {-maxat= -allow {data xname dataset} -help {Conditions for finding time of maximum value in the interval}}
+        {-between= -allow {data xname dataset} -help {Conditions for fetching data in the interval}}
+        {-stats= -allow {data xname dataset} -help {Conditions for finding avg, rms, min, max, pp, minat and maxat\
+                                                            values in the interval}}
+        {-batch= -allow {data xname dataset} -help {Dictionary of measurements names and their switches, all of them\
+                                                            are done on the same data}}
+    }
 }
 
 proc ::tclmeasure::AliasesKeysCheck {arguments keys} {
@@ -16,25 +43,268 @@ proc ::tclmeasure::AliasesKeysCheck {arguments keys} {
     return -code error "[join [lrange $formKeys 0 end-1] ", "] or [lindex $formKeys end] must be presented"
 }
 
-proc ::tclmeasure::FromTo {argsDict data xname} {
-    if {![dict exists $argsDict from]} {
-        set from [lindex [dict get $data $xname] 0]
-    } else {
-        set from [dict get $argsDict from]
+proc ::tclmeasure::FromTo {argsDict} {
+    # Sets from and to variables in the caller, empty string means the first or the last x value
+    foreach key {from to} {
+        if {[dict exists $argsDict $key]} {
+            uplevel 1 [list set $key [dict get $argsDict $key]]
+        } else {
+            uplevel 1 [list set $key {}]
+        }
+    }
+}
+
+proc ::tclmeasure::LevelsCheck {argsDict} {
+    # Checks that a condition with -vec switch has -val or -vals switch, and that the levels of -vals switch are
+    #  numbers
+    if {![dict exists $argsDict vec]} {
+        return
+    }
+    AliasesKeysCheck $argsDict {val vals}
+    if {[dict exists $argsDict vals]} {
+        set vals [dict get $argsDict vals]
+        if {[llength $vals]==0} {
+            return -code error "-vals switch requires at least one level"
+        }
+        foreach val $vals {
+            if {![string is double -strict $val]} {
+                return -code error "Level '$val' of -vals switch is not a number"
+            }
+        }
     }
-    if {![dict exists $argsDict to]} {
-        set to [lindex [dict get $data $xname] end]
+}
+
+proc ::tclmeasure::CrossingArgs {switch conditions} {
+    # Parses the conditions of -trig, -targ or -when switch and checks the levels and the count of the crossing.
+    #  switch - trig, targ or when
+    #  conditions - value of the switch
+    # Returns dictionary of the switches parsed by argparse, the condition of the crossing (cross, rise or fall) is
+    #  added with key cond unless -trig or -targ is given by -at switch.
+    if {$switch eq {when}} {
+        set argsDict [argparse -inline {
+            {-vec= -forbid {vec1 vec2}}
+            {-val= -require vec -forbid {vec1 vec2 vals}}
+            {-vals= -require vec -forbid {vec1 vec2}}
+            {-vec1= -require vec2 -forbid {vec val}}
+            {-vec2= -require vec1 -forbid {vec val}}
+            {-td|delay= -default 0.0 -type double}
+            {-from= -type double}
+            {-to= -type double}
+            {-cross= -forbid {rise fall}}
+            {-rise= -forbid {cross fall}}
+            {-fall= -forbid {cross rise}}
+        } $conditions]
+        AliasesKeysCheck $argsDict {vec vec1}
     } else {
-        set to [dict get $argsDict to]
+        set argsDict [argparse -inline {
+            {-at= -forbid {vec val vals delay cross rise fall} -type double}
+            {-vec= -forbid at}
+            {-val= -forbid {at vals} -type double}
+            {-vals= -forbid at -require vec}
+            {-td|delay= -default 0.0 -forbid at -require vec -type double}
+            {-cross= -forbid {rise fall} -forbid at -require vec}
+            {-rise= -forbid {cross fall} -forbid at -require vec}
+            {-fall= -forbid {cross rise} -forbid at -require vec}
+        } $conditions]
+        AliasesKeysCheck $argsDict {at vec}
+    }
+    LevelsCheck $argsDict
+    if {[dict exists $argsDict at]} {
+        return $argsDict
+    }
+    set cond [AliasesKeysCheck $argsDict {cross rise fall}]
+    set count [dict get $argsDict $cond]
+    set name [expr {$switch eq {targ} ? {Targ} : {Trig}}]
+    if {[string is integer $count]} {
+        if {$count<=0} {
+            return -code error "$name count '$count' must be more than 0"
+        }
+    } elseif {$switch ne {when}} {
+        if {$count ne {last}} {
+            return -code error "$name count '$count' must be an integer or 'last' string"
+        }
+    } elseif {[dict exists $argsDict vals]} {
+        if {$count ne {last}} {
+            return -code error "$name count '$count' must be an integer or 'last' string with -vals switch"
+        }
+    } elseif {$count ni {last all}} {
+        return -code error "$name count '$count' must be an integer, 'last' or 'all' string"
+    }
+    return [dict replace $argsDict cond $cond]
+}
+
+proc ::tclmeasure::WhenLevelsPlan {xname whenArgs mode find} {
+    # Creates plan of -when measurement with -vals switch, the crossings of all levels are found with a single pass.
+    #  xname - name of x list in data dictionary
+    #  whenArgs - switches of -when checked by [::tclmeasure::CrossingArgs]
+    #  mode - one of when, findwhen or derivwhen
+    #  find - name of the list of -find or -deriv switch, empty for when mode
+    # Returns plan dictionary, see [::tclmeasure::PlanCmd].
+    set whenVecCond [dict get $whenArgs cond]
+    set count [dict get $whenArgs $whenVecCond]
+    FromTo $whenArgs
+    return [PlanCmd [expr {$mode eq {when} ? {1 4} : {1 3 4}}] {} ::tclmeasure::WhenLevels $xname $mode $find\
+                    [dict get $whenArgs vec] [dict get $whenArgs vals] $whenVecCond $count [dict get $whenArgs delay]\
+                    $from $to]
+}
+
+proc ::tclmeasure::ColumnsPlan {xname argsDict type} {
+    # Checks -vec and -vecs switches of a measurement over an interval and creates the plan of the measurement done on
+    #  each vector listed by -vecs switch.
+    #  xname - name of x list in data dictionary
+    #  argsDict - switches of the measurement parsed by argparse
+    #  type - measurement, one of avg, rms, min, max, pp, minat, maxat or stats
+    # Returns plan dictionary, see [::tclmeasure::PlanCmd], or empty string if the measurement is done on the single
+    #  vector given by -vec switch.
+    if {![dict exists $argsDict vecs]} {
+        if {![dict exists $argsDict vec]} {
+            return -code error "-vec or -vecs switch is required"
+        }
+        return
+    } elseif {[dict exists $argsDict vec]} {
+        return -code error "-vec switch is not allowed with -vecs switch"
+    }
+    set vecs [dict get $argsDict vecs]
+    if {[llength $vecs]==0} {
+        return -code error "-vecs switch requires at least one vector name"
+    }
+    FromTo $argsDict
+    set indices [list 1]
+    for {set index 6} {$index<[llength $vecs]+6} {incr index} {
+        lappend indices $index
+    }
+    return [PlanCmd $indices {} ::tclmeasure::Columns $xname $vecs $from $to $type {*}$vecs]
+}
+
+proc ::tclmeasure::Modes {} {
+    # Collects the switches that select the measurement from the variables set by argparse in the caller
+    variable keysList
+    set modes [dict create]
+    foreach key $keysList {
+        upvar 1 $key value
+        if {[info exists value]} {
+            dict set modes $key $value
+        }
+    }
+    return $modes
+}
+
+proc ::tclmeasure::PlanCmd {vecs stat args} {
+    # Creates plan dictionary of a measurement.
+    #  vecs - indices of the command words that are names of lists in data dictionary
+    #  stat - key of [::tclmeasure::Stats] result that gives the same value, empty if there is no such key
+    #  args - command and its arguments, lists are given by their names
+    # Returns dictionary with keys cmd, vecs and stat.
+    return [dict create cmd $args vecs $vecs stat $stat]
+}
+
+proc ::tclmeasure::Run {plan data} {
+    # Runs the measurement described by plan dictionary on data dictionary
+    set cmd [dict get $plan cmd]
+    foreach index [dict get $plan vecs] {
+        lset cmd $index [dict get $data [lindex $cmd $index]]
+    }
+    return [{*}$cmd]
+}
+
+proc ::tclmeasure::Batch {xname data batch} {
+    # Does a set of measurements on the same data.
+    #  xname - name of x list in data dictionary
+    #  data - dictionary that contains lists with names as the keys and lists as the values
+    #  batch - dictionary with names of measurements as the keys and switches of `measure` as the values
+    # Returns dictionary with names of measurements as the keys and results as the values.
+    return [RunBatch [PlanBatch $xname $batch] $data]
+}
+
+proc ::tclmeasure::PlanBatch {xname batch} {
+    # Validates a set of measurements and builds their plans.
+    #  xname - name of x list in data dictionary
+    #  batch - dictionary with names of measurements as the keys and switches of `measure` as the values
+    # Returns dictionary with names of measurements as the keys and plans as the values.
+    set plans [dict create]
+    dict for {name spec} $batch {
+        if {[catch {Plan $xname [SpecModes $spec]} plan]} {
+            return -code error "Measurement '$name': $plan"
+        }
+        dict set plans $name $plan
+    }
+    return $plans
+}
+
+proc ::tclmeasure::RunBatch {plans data} {
+    # Runs plans created by [::tclmeasure::PlanBatch] on data dictionary. Avg, Rms, Min, Max, PP, MinAt and MaxAt
+    #  measurements of the same list over the same interval are done by a single call to [::tclmeasure::Stats].
+    # Returns dictionary with names of measurements as the keys and results as the values.
+    set groups [dict create]
+    dict for {name plan} $plans {
+        if {[dict get $plan stat] ne {}} {
+            dict lappend groups [lrange [dict get $plan cmd] 1 4] $name
+        }
     }
-    uplevel 1 [list set from $from]
-    uplevel 1 [list set to $to] 
+    set grouped [dict create]
+    dict for {key names} $groups {
+        if {[llength $names]>1} {
+            if {[catch {Run [PlanCmd {1 2} {} ::tclmeasure::Stats {*}$key] $data} stats]} {
+                return -code error "Measurement '[lindex $names 0]': $stats"
+            }
+            foreach name $names {
+                dict set grouped $name [dict get $stats [dict get $plans $name stat]]
+            }
+        }
+    }
+    set results [dict create]
+    dict for {name plan} $plans {
+        if {[dict exists $grouped $name]} {
+            dict set results $name [dict get $grouped $name]
+        } elseif {[catch {Run $plan $data} result]} {
+            return -code error "Measurement '$name': $result"
+        } else {
+            dict set results $name $result
+        }
+    }
+    return $results
+}
+
+proc ::tclmeasure::SpecModes {spec} {
+    # Parses the switches of one measurement from the -batch dictionary
+    variable definition
+    argparse $definition [list -xname {} -data {} {*}$spec]
+    if {[info exists batch]} {
+        return -code error "-batch switch is not allowed inside of -batch"
+    }
+    return [Modes]
+}
+
+proc ::tclmeasure::DataSource {} {
+    # Sets xname and data variables of the caller from the -dataset switch, or checks that -xname and -data switches
+    #  are given
+    upvar xname xname data data dataset dataset
+    if {[info exists dataset]} {
+        if {[info exists data]} {
+            return -code error "-data switch is not allowed with -dataset switch, data is taken from the dataset"
+        }
+        set datasetXname [$dataset xname]
+        if {[info exists xname] && ($xname ne $datasetXname)} {
+            return -code error "x list '$xname' is not the x list '$datasetXname' of the dataset"
+        }
+        set xname $datasetXname
+        set data [$dataset data]
+        return
+    }
+    foreach name {xname data} {
+        if {![info exists $name]} {
+            return -code error "-$name switch is required"
+        }
+    }
+    return
 }
 
 proc ::tclmeasure::measure {args} {
     # Does different measurements of input data lists.
     #  -xname - name of x list in data dictionary. This list must be strictly increaing without duplicate elements.
     #  -data - dictionary that contains lists with names as the keys and lists as the values.
+    #  -dataset - dataset command created by `dataset create`, replaces -data and -xname switches; its vectors are
+    #    converted and checked once when the dataset is created.
     #  -trig - contains conditions for trigger (see below), selects Trigger-Target measurement, requires -targ
     #  -targ - contains conditions for target (see below), requires -trig
     #  -find - contains conditions for find (see below), requires -when or -at
@@ -49,6 +319,22 @@ proc ::tclmeasure::measure {args} {
     #  -minat - contains conditions for finding time of minimum value in the interval
     #  -maxat - contains conditions for finding time of maximum value in the interval
     #  -between - contains conditions for fetching data in the interval
+    #  -stats - contains conditions for finding avg, rms, min, max, pp, minat and maxat values in one pass
+    #  -batch - dictionary of measurements names and their switches, see below
+    # Points on x list are located with binary search, so its strict increase is not verified by default, run
+    #  `::tclmeasure::configure -checkx true` to enable the check (done once per list).
+    # Reductions (-integ, -avg, -rms, -min, -max, -pp, -minat, -maxat, -stats) and crossing searches over long lists
+    #  could be split between several threads with `::tclmeasure::configure -threads N`, results of -integ, -avg, -rms
+    #  and -stats could then differ from the single-threaded ones in the last digits, unless
+    #  `::tclmeasure::configure -reproducible true` is set to sum over fixed blocks that do not depend on the number of
+    #  threads.
+    # Crossings of a level searched more than once on the same list are indexed in the list, so later -rise, -fall and
+    #  -cross searches of that level with any count, delay or interval are binary searches instead of scans.
+    # Many -integ, -avg or -rms measurements over windows of the same lists are faster with
+    #  `::tclmeasure::configure -cumulative true`: cumulative integrals are then built once per pair of x and y lists
+    #  and each window takes two lookups, the results could differ from the summed ones in the last digits.
+    # Lists used in more than one -min, -max, -pp, -minat or -maxat measurement get an index of the extrema of their
+    #  blocks, so later windows only scan their partial blocks at the ends, with the same results.
     # This procedure imitates the .meas command from SPICE3 and Ngspice in particular. It has mutiple modes, and each
     #  mod could have different forms:
     #  ###### **Trigger-Target**
@@ -60,6 +346,10 @@ proc ::tclmeasure::measure {args} {
     #  certain exact point on x axis. These conditions are provided as a list of arguments to -trig and -targ switches:
     #   -vec - name of vector in data dictionary
     #   -val - value to match
+    #   -vals - list of values to match, replaces -val. The n-th crossing of every value is found with a single pass
+    #     over the vector, and the result is a list of dictionaries, one for each pair of trigger and target values.
+    #     A single trigger or target value is paired with every value of the other list, otherwise both lists have
+    #     the same length and are paired by position.
     #   -td - x axis delay after which the search is start, default is 0.0.
     #   -cross - condition's count, cross conditions counts every time vector crosses value, and saves
     #     only n-th crossing the value. The possible values are positive integers, or `last` string.
@@ -87,14 +377,22 @@ proc ::tclmeasure::measure {args} {
     # Here we use x key value as x axis, trigger vector point is when y1 crosses value 0.7, second rise, and target point 
     # is value 20.0 at x axis.
     # 
-    # In this mode procedure returns dictionary with keys `xtrig`, `xtarg`, `xdelta` and corresponding values.
+    # ```tcl
+    # measure -xname x -data [dict create x $x in $in out $out] -trig {-vec in -vals {0.1 0.5 0.9} -rise 1}\
+    #         -targ {-vec out -vals {0.1 0.5 0.9} -rise 1}
+    # ```
+    # Here the result is a list of three dictionaries with the delays from first rise of in to first rise of out at
+    # levels 0.1, 0.5 and 0.9.
+    #
+    # In this mode procedure returns dictionary with keys `xtrig`, `xtarg`, `xdelta` and corresponding values, or list
+    # of such dictionaries with -vals switch.
     #
-    # Synopsis: -xname value -data value -trig \{-vec value -val value ?-td value? -cross|rise|fall value\} -targ \{-vec
-    # value -val value ?-td value? -cross|rise|fall value\}
-    # Synopsis: -xname value -data value -trig \{-at value\} -targ \{-vec value -val value ?-td value? -cross|rise|fall
-    # value\}
-    # Synopsis: -xname value -data value -trig \{-vec value -val value ?-td value? -cross|rise|fall value\} -targ \{-at
-    # value\}
+    # Synopsis: -xname value -data value -trig \{-vec value -val|vals value ?-td value? -cross|rise|fall value\}
+    # -targ \{-vec value -val|vals value ?-td value? -cross|rise|fall value\}
+    # Synopsis: -xname value -data value -trig \{-at value\} -targ \{-vec value -val|vals value ?-td value?
+    # -cross|rise|fall value\}
+    # Synopsis: -xname value -data value -trig \{-vec value -val|vals value ?-td value? -cross|rise|fall value\}
+    # -targ \{-at value\}
     #
     # ###### **Find-When** or **Deriv-When**
     # In this mode it measures any vector (or its derivative), when two signals cross each other or a signal crosses 
@@ -103,6 +401,8 @@ proc ::tclmeasure::measure {args} {
     # switches are:
     #  -vec - name of vector in data dictionary
     #  -val - value to match
+    #  -vals - list of values to match, replaces -val. The n-th crossing of every value is found with a single pass
+    #    over the vector and the result is a list with one element for each value, `all` count is not allowed.
     #  -td - x axis delay after which the search is start, default is 0.0.
     #  -from - start of the range in which search happens, default is minimum value of x.
     #  -to - end of the range in which search happens, default is maximum value of x.
@@ -153,8 +453,8 @@ proc ::tclmeasure::measure {args} {
     # [1,30].  In this mode procedure returns dictionary with keys `xwhen`, and `yfind` if `-find` switch is specified,
     # and corresponding values.
     #
-    # Synopsis: -xname value -data value ?-find|deriv value? -when \{-vec value -val value ?-td value? ?-from value? 
-    #   ?-to value? -cross|rise|fall value\}
+    # Synopsis: -xname value -data value ?-find|deriv value? -when \{-vec value -val|vals value ?-td value?
+    #   ?-from value? ?-to value? -cross|rise|fall value\}
     # Synopsis: -xname value -data value ?-find|deriv value? -when \{-vec1 value -vec2 value ?-td value? ?-from value? 
     #   ?-to value? -cross|rise|fall value\}
     #
@@ -180,15 +480,30 @@ proc ::tclmeasure::measure {args} {
     # ###### **Avg|Rms|Min|Max|PP|MinAt|MaxAt|Between**
     # This mode is combination of many modes with the same interface.
     #  -vec - name of vector in data dictionary
+    #  -vecs - list of names of vectors in data dictionary, replaces -vec, not allowed in Between mode. The same
+    #    measurement is done on each vector and the results are returned as a dictionary with the names as the keys.
+    #    The interval is located on x list once for all vectors.
     #  -from - start of the range in which search happens, default is minimum value of x.
     #  -to - end of the range in which search happens, default is maximum value of x.
     # Examples of usages:
     # ```tcl
     # measure -xname x -data [dict create x $x y1 $y1 y2 $y2] -avg {-vec y1 -from 1 -to 5}
+    # measure -xname x -data [dict create x $x y1 $y1 y2 $y2] -max {-vecs {y1 y2} -from 1 -to 5}
     # ```
     # In **Between** mode, the x and y values are returned within specified interval.
     # Synopsis: -xname value -data value -avg|rms|pp|min|max|minat|maxat|between \{-vec value ?-td value? ?-from value?
     #   ?-to value?\}
+    # Synopsis: -xname value -data value -avg|rms|pp|min|max|minat|maxat \{-vecs value ?-from value? ?-to value?\}
+    #
+    # ###### **Stats**
+    # Computes avg, rms, min, max, pp, minat and maxat values with a single pass over the data and returns them as a
+    #  dictionary with these keys. The interface is the same as in Avg|Rms|Min|Max|PP|MinAt|MaxAt|Between modes.
+    # Examples of usages:
+    # ```tcl
+    # measure -xname x -data [dict create x $x y1 $y1 y2 $y2] -stats {-vec y1 -from 1 -to 5}
+    # ```
+    # With -vecs switch the result is a dictionary of such dictionaries with the names of the vectors as the keys.
+    # Synopsis: -xname value -data value -stats \{-vec|vecs value ?-from value? ?-to value?\}
     #
     # ###### **Integ**
     # This mode is combination of many modes with the same interface.
@@ -202,31 +517,55 @@ proc ::tclmeasure::measure {args} {
     # ```
     #
     # Synopsis: -xname value -data value -integ \{-vec value ?-td value? ?-from value? ?-to value? ?-cum?\}
-    set keysList {trig targ find when at integ deriv avg min max pp rms minat maxat between}
+    #
+    # ###### **Batch**
+    # Does many measurements on the same data. Each measurement is given by its name and switches of any mode above
+    #  except -xname and -data. All measurements are validated first, and Avg|Rms|Min|Max|PP|MinAt|MaxAt measurements
+    #  of the same vector over the same interval are done with a single pass over the data. Returns dictionary with
+    #  names of measurements as the keys and results as the values.
+    # Examples of usages:
+    # ```tcl
+    # measure -xname x -data [dict create x $x y1 $y1 y2 $y2] -batch {
+    #     y1max {-max {-vec y1}}
+    #     y1rms {-rms {-vec y1}}
+    #     y2at5 {-find y2 -at 5}
+    # }
+    # ```
+    # Synopsis: -xname value -data value -batch value
+    #
+    # ###### **Dataset**
+    # Any mode can take its data from a dataset instead of -xname and -data switches. The dataset converts its vectors
+    #  and checks their lengths and the order of x once, and the data kept for the vectors by measurements (x grid,
+    #  crossings, cumulative integrals) is reused by the next measurements on the same dataset.
+    # Examples of usages:
+    # ```tcl
+    # set ds [dataset create x [dict create x $x y1 $y1 y2 $y2]]
+    # measure -dataset $ds -max {-vec y1}
+    # measure -dataset $ds -find y2 -at 5
+    # $ds close
+    # ```
+    # Synopsis: -dataset value -trig|targ|find|deriv|when|at|integ|avg|rms|min|max|pp|minat|maxat|between|stats|batch
+    #   value ?...?
+    variable definition
     argparse -help {Does different measurements of input data lists. This procedure imitates the .meas command from\
                             SPICE3 and Ngspice in particular. It has mutiple modes, and each mod could have different\
                             forms: Trigger-Target, Find-When, Deriv-When, Find-At, Deriv-At,\
-                            Avg|Rms|Min|Max|PP|MinAt|MaxAt|Between and Integ. See documentation for further details} {
-        {-xname= -required -help {Name of x list in data dictionary. This list must be strictly increaing without\
-                                          duplicate elements}}
-        {-data= -required -help {Dictionary that contains lists with names as the keys and lists as the values}}
-        {-trig= -require targ -allow {data xname targ} -help {Conditions for trigger, selects Trigger-Target\
-                                                                      measurement}}
-        {-targ= -require trig -allow {data xname trig}  -help {Conditions for target}}
-        {-find= -allow {data xname when at} -help {Conditions for Find-When or Find-At mode}}
-        {-when= -allow {data xname find deriv} -help {Conditions for Find-When or Deriv-When modes}}
-        {-at= -type double -allow {data xname find deriv} -help {Time for Find-At or Deriv-At modes}}
-        {-integ= -allow {data xname} -help {Conditions for Integ mode}}
-        {-deriv= -allow {data xname deriv when at} -help {Conditions for Deriv-At mode}}
-        {-avg= -allow {data xname} -help {Conditions for finding average value across the interval}}
-        {-min= -allow {data xname} -help {Conditions for finding minimum value in the interval}}
-        {-max= -allow {data xname} -help {Conditions for finding maximum value in the interval}}
-        {-pp= -allow {data xname} -help {Conditions for finding peak to peak value in the interval}}
-        {-rms= -allow {data xname} -help {Conditions for finding root meas square value across the interval}}
-        {-minat= -allow {data xname} -help {Conditions for finding time of minimum value in the interval}}
-        {-maxat= -allow {data xname} -help {Conditions for finding time of maximum value in the interval}}
-        {-between= -allow {data xname} -help {Conditions for fetching data in the interval}}
+                            Avg|Rms|Min|Max|PP|MinAt|MaxAt|Between, Stats and Integ. See documentation for further\
+                            details} $definition
+    DataSource
+    if {[info exists batch]} {
+        return [Batch $xname $data $batch]
     }
+    return [Run [Plan $xname [Modes]] $data]
+}
+
+proc ::tclmeasure::Plan {xname modes} {
+    # Validates the conditions of a measurement and builds the command that performs it.
+    #  xname - name of x list in data dictionary
+    #  modes - dictionary with the switches of `measure` that select the measurement and their values
+    # Returns plan dictionary, see [::tclmeasure::PlanCmd]. The plan doesn't depend on the data, so it could be run
+    #  against any data dictionary that contains the lists it refers to.
+    dict with modes {}
     if {[info exists at]} {
         if {![info exists find] && ![info exists deriv]} {
             return -code error "When -at switch is presented, -find switch or -deriv switch is required"
@@ -238,167 +577,87 @@ proc ::tclmeasure::measure {args} {
         }
     }
     if {[info exists trig]} {
-        set definition {
-            {-at= -forbid {vec val delay cross rise fall} -type double}
-            {-vec= -forbid at -require val}
-            {-val= -forbid at -type double}
-            {-td|delay= -default 0.0 -forbid at -require {vec val} -type double}
-            {-cross= -forbid {rise fall} -forbid at -require {vec val}}
-            {-rise= -forbid {cross fall} -forbid at -require {vec val}}
-            {-fall= -forbid {cross rise} -forbid at -require {vec val}}
-        }
-        set trigArgs [argparse -inline $definition $trig]
-        set targArgs [argparse -inline $definition $targ]
-        AliasesKeysCheck $trigArgs {at vec}
-        AliasesKeysCheck $targArgs {at vec}
+        set trigArgs [CrossingArgs trig $trig]
+        set targArgs [CrossingArgs targ $targ]
         if {![dict exists $trigArgs at]} {
-            set trigVecCond [AliasesKeysCheck $trigArgs {cross rise fall}]
+            set trigVecCond [dict get $trigArgs cond]
             set trigVecCondCount [dict get $trigArgs $trigVecCond]
-            if {[string is integer $trigVecCondCount]} {
-                if {$trigVecCondCount<=0} {
-                    return -code error "Trig count '$trigVecCondCount' must be more than 0"
-                }
-            } elseif {$trigVecCondCount ne {last}} {
-                return -code error "Trig count '$trigVecCondCount' must be an integer or 'last' string"
+            set trigData [dict get $trigArgs vec]
+            if {[dict exists $trigArgs vals]} {
+                set trigVal [dict get $trigArgs vals]
+                set levels {}
+            } else {
+                set trigVal [dict get $trigArgs val]
             }
-            set trigData [dict get $data [dict get $trigArgs vec]]
-            set trigVal [dict get $trigArgs val]
         } else {
             set trigVecCond rise
             set trigVecCondCount 1
-            set trigData [dict get $data $xname]
+            set trigData $xname
             set trigVal [dict get $trigArgs at]
         }
         if {![dict exists $targArgs at]} {
-            set targVecCond [AliasesKeysCheck $targArgs {cross rise fall}]
+            set targVecCond [dict get $targArgs cond]
             set targVecCondCount [dict get $targArgs $targVecCond]
-            if {[string is integer $targVecCondCount]} {
-                if {$targVecCondCount<=0} {
-                    return -code error "Targ count '$targVecCondCount' must be more than 0"
-                }
-            } elseif {$targVecCondCount ne {last}} {
-                return -code error "Targ count '$targVecCondCount' must be an integer or 'last' string"
+            set targData [dict get $targArgs vec]
+            if {[dict exists $targArgs vals]} {
+                set targVal [dict get $targArgs vals]
+                set levels {}
+            } else {
+                set targVal [dict get $targArgs val]
             }
-            set targData [dict get $data [dict get $targArgs vec]]
-            set targVal [dict get $targArgs val]
         } else {
             set targVecCond rise
             set targVecCondCount 1
-            set targData [dict get $data $xname]
+            set targData $xname
             set targVal [dict get $targArgs at]
         }
-        return [::tclmeasure::TrigTarg [dict get $data $xname] $trigData $trigVal $targData $targVal $trigVecCond\
-                        $trigVecCondCount $targVecCond $targVecCondCount [dict get $trigArgs delay]\
-                        [dict get $targArgs delay]]
-    } elseif {[info exists find] && [info exists when]} {
-        set whenArgs [argparse -inline {
-            {-vec= -require val -forbid {vec1 vec2}}
-            {-val= -require vec -forbid {vec1 vec2}}
-            {-vec1= -require vec2 -forbid {vec val}}
-            {-vec2= -require vec1 -forbid {vec val}}
-            {-td|delay= -default 0.0 -type double}
-            {-from= -type double}
-            {-to= -type double}
-            {-cross= -forbid {rise fall}}
-            {-rise= -forbid {cross fall}}
-            {-fall= -forbid {cross rise}}
-        } $when]
-        AliasesKeysCheck $whenArgs {vec vec1}
-        set whenVecCond [AliasesKeysCheck $whenArgs {cross rise fall}]
-        if {[string is integer [dict get $whenArgs $whenVecCond]]} {
-            if {[dict get $whenArgs $whenVecCond]<=0} {
-                return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be more than 0"
+        if {[info exists levels]} {
+            set trigLevels [llength $trigVal]
+            set targLevels [llength $targVal]
+            if {$trigLevels!=$targLevels && $trigLevels!=1 && $targLevels!=1} {
+                return -code error "Number of trig levels '$trigLevels' is not equal to number of targ levels\
+                        '$targLevels'"
             }
-        } elseif {[dict get $whenArgs $whenVecCond] ni {last all}} {
-            return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be an integer, 'last' or 'all'\
-                    string"
+            return [PlanCmd {1 2 4} {} ::tclmeasure::TrigTargLevels $xname $trigData $trigVal $targData $targVal\
+                            $trigVecCond $trigVecCondCount $targVecCond $targVecCondCount [dict get $trigArgs delay]\
+                            [dict get $targArgs delay]]
         }
-        FromTo $whenArgs $data $xname
-        if {[dict exists $whenArgs vec1]} {
-            if {[dict get $whenArgs vec1] eq [dict get $whenArgs vec2]} {
-                return -code error "vec1 must be different to vec2"
-            }
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] findwheneq [dict get $data $find]\
-                            [dict get $data [dict get $whenArgs vec1]] {} [dict get $data [dict get $whenArgs vec2]]\
-                            $whenVecCond [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
+        return [PlanCmd {1 2 4} {} ::tclmeasure::TrigTarg $xname $trigData $trigVal $targData $targVal $trigVecCond\
+                        $trigVecCondCount $targVecCond $targVecCondCount [dict get $trigArgs delay]\
+                        [dict get $targArgs delay]]
+    } elseif {[info exists when]} {
+        set whenArgs [CrossingArgs when $when]
+        if {[info exists find]} {
+            set mode findwhen
+        } elseif {[info exists deriv]} {
+            set mode derivwhen
+            set find $deriv
         } else {
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] findwhen [dict get $data $find]\
-                            [dict get $data [dict get $whenArgs vec]] [dict get $whenArgs val] {} $whenVecCond\
-                            [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
+            set mode when
+            set find {}
         }
-    } elseif {[info exists deriv] && [info exists when]} {
-        set whenArgs [argparse -inline {
-            {-vec= -require val -forbid {vec1 vec2}}
-            {-val= -require vec -forbid {vec1 vec2}}
-            {-vec1= -require vec2 -forbid {vec val}}
-            {-vec2= -require vec1 -forbid {vec val}}
-            {-td|delay= -default 0.0 -type double}
-            {-from= -type double}
-            {-to= -type double}
-            {-cross= -forbid {rise fall}}
-            {-rise= -forbid {cross fall}}
-            {-fall= -forbid {cross rise}}
-        } $when]
-        AliasesKeysCheck $whenArgs {vec vec1}
-        set whenVecCond [AliasesKeysCheck $whenArgs {cross rise fall}]
-        if {[string is integer [dict get $whenArgs $whenVecCond]]} {
-            if {[dict get $whenArgs $whenVecCond]<=0} {
-                return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be more than 0"
-            }
-        } elseif {[dict get $whenArgs $whenVecCond] ni {last all}} {
-            return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be an integer, 'last' or 'all'\
-                    string"
+        if {[dict exists $whenArgs vals]} {
+            return [WhenLevelsPlan $xname $whenArgs $mode $find]
         }
-        FromTo $whenArgs $data $xname
+        set whenVecCond [dict get $whenArgs cond]
+        FromTo $whenArgs
+        set indices [expr {$mode eq {when} ? {1 4} : {1 3 4}}]
         if {[dict exists $whenArgs vec1]} {
-            if {[dict get $whenArgs vec1] eq [dict get $whenArgs vec2]} {
+            if {$mode ne {when} && [dict get $whenArgs vec1] eq [dict get $whenArgs vec2]} {
                 return -code error "vec1 must be different to vec2"
             }
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] derivwheneq [dict get $data $deriv]\
-                            [dict get $data [dict get $whenArgs vec1]] {} [dict get $data [dict get $whenArgs vec2]]\
-                            $whenVecCond [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
-        } else {
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] derivwhen [dict get $data $deriv]\
-                            [dict get $data [dict get $whenArgs vec]] [dict get $whenArgs val] {} $whenVecCond\
-                            [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
-        }
-    } elseif {[info exists when]} {
-        set whenArgs [argparse -inline {
-            {-vec= -require val -forbid {vec1 vec2}}
-            {-val= -require vec -forbid {vec1 vec2}}
-            {-vec1= -require vec2 -forbid {vec val}}
-            {-vec2= -require vec1 -forbid {vec val}}
-            {-td|delay= -default 0.0 -type double}
-            {-from= -type double}
-            {-to= -type double}
-            {-cross= -forbid {rise fall}}
-            {-rise= -forbid {cross fall}}
-            {-fall= -forbid {cross rise}}
-        } $when]
-        AliasesKeysCheck $whenArgs {vec vec1}
-        set whenVecCond [AliasesKeysCheck $whenArgs {cross rise fall}]
-        if {[string is integer [dict get $whenArgs $whenVecCond]]} {
-            if {[dict get $whenArgs $whenVecCond]<=0} {
-                return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be more than 0"
-            }
-        } elseif {[dict get $whenArgs $whenVecCond] ni {last all}} {
-            return -code error "Trig count '[dict get $whenArgs $whenVecCond]' must be an integer, 'last' or 'all'\
-                    string"
-        }
-        FromTo $whenArgs $data $xname
-        if {[dict exists $whenArgs vec1]} {
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] wheneq {}\
-                            [dict get $data [dict get $whenArgs vec1]] {} [dict get $data [dict get $whenArgs vec2]]\
+            return [PlanCmd [list {*}$indices 6] {} ::tclmeasure::FindDerivWhen $xname ${mode}eq $find\
+                            [dict get $whenArgs vec1] {} [dict get $whenArgs vec2]\
                             $whenVecCond [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
         } else {
-            return [::tclmeasure::FindDerivWhen [dict get $data $xname] when {}\
-                            [dict get $data [dict get $whenArgs vec]] [dict get $whenArgs val] {}\
+            return [PlanCmd $indices {} ::tclmeasure::FindDerivWhen $xname $mode $find\
+                            [dict get $whenArgs vec] [dict get $whenArgs val] {}\
                             $whenVecCond [dict get $whenArgs $whenVecCond] [dict get $whenArgs delay] $from $to]
         }
     } elseif {[info exists find] && [info exists at]} {
-        return [::tclmeasure::FindAt [dict get $data $xname] $at [dict get $data $find]]
+        return [PlanCmd {1 3} {} ::tclmeasure::FindAt $xname $at $find]
     } elseif {[info exists deriv] && [info exists at]} {
-        return [::tclmeasure::DerivAt [dict get $data $xname] $at [dict get $data $deriv]]
+        return [PlanCmd {1 3} {} ::tclmeasure::DerivAt $xname $at $deriv]
     } elseif {[info exists integ]} {
         set integArgs [argparse -inline {
             {-vec= -required}
@@ -406,25 +665,45 @@ proc ::tclmeasure::measure {args} {
             {-to= -type double}
             {-cum -boolean}
         } $integ]
-        FromTo $integArgs $data $xname
-        return [::tclmeasure::Integ [dict get $data $xname] [dict get $data [dict get $integArgs vec]] $from $to\
+        FromTo $integArgs
+        return [PlanCmd {1 2} {} ::tclmeasure::Integ $xname [dict get $integArgs vec] $from $to\
                         [dict get $integArgs cum]]
     } elseif {[info exists avg]} {
         set avgArgs [argparse -inline {
-            {-vec= -required}
+            {-vec=}
+            {-vecs=}
             {-from= -type double}
             {-to= -type double}
         } $avg]
-        FromTo $avgArgs $data $xname
-        return [::tclmeasure::Avg [dict get $data $xname] [dict get $data [dict get $avgArgs vec]] $from $to]
+        if {[set plan [ColumnsPlan $xname $avgArgs avg]] ne {}} {
+            return $plan
+        }
+        FromTo $avgArgs
+        return [PlanCmd {1 2} avg ::tclmeasure::Avg $xname [dict get $avgArgs vec] $from $to]
     } elseif {[info exists rms]} {
         set rmsArgs [argparse -inline {
-            {-vec= -required}
+            {-vec=}
+            {-vecs=}
             {-from= -type double}
             {-to= -type double}
         } $rms]
-        FromTo $rmsArgs $data $xname
-        return [::tclmeasure::Rms [dict get $data $xname] [dict get $data [dict get $rmsArgs vec]] $from $to]
+        if {[set plan [ColumnsPlan $xname $rmsArgs rms]] ne {}} {
+            return $plan
+        }
+        FromTo $rmsArgs
+        return [PlanCmd {1 2} rms ::tclmeasure::Rms $xname [dict get $rmsArgs vec] $from $to]
+    } elseif {[info exists stats]} {
+        set statsArgs [argparse -inline {
+            {-vec=}
+            {-vecs=}
+            {-from= -type double}
+            {-to= -type double}
+        } $stats]
+        if {[set plan [ColumnsPlan $xname $statsArgs stats]] ne {}} {
+            return $plan
+        }
+        FromTo $statsArgs
+        return [PlanCmd {1 2} {} ::tclmeasure::Stats $xname [dict get $statsArgs vec] $from $to]
     } elseif {[info exists min] || [info exists max] || [info exists pp] || [info exists minat] || [info exists maxat]\
                       || [info exists between]} {
         if {[info exists min]} {
@@ -447,23 +726,165 @@ proc ::tclmeasure::measure {args} {
             set argsDict $between
         }
         set resDict [argparse -inline {
-            {-vec= -required}
+            {-vec=}
+            {-vecs=}
             {-from= -validate {[string is double $arg]}}
             {-to= -validate {[string is double $arg]}}
         } $argsDict]
-        FromTo $resDict $data $xname
-        return [::tclmeasure::MinMaxPPMinAtMaxAt [dict get $data $xname] [dict get $data [dict get $resDict vec]]\
-                        $from $to $type]
+        if {$type eq {between}} {
+            if {[dict exists $resDict vecs]} {
+                return -code error "-vecs switch is not allowed in Between mode"
+            } elseif {![dict exists $resDict vec]} {
+                return -code error "-vec switch is required"
+            }
+        } elseif {[set plan [ColumnsPlan $xname $resDict $type]] ne {}} {
+            return $plan
+        }
+        FromTo $resDict
+        if {$type eq {between}} {
+            set stat {}
+        } else {
+            set stat $type
+        }
+        return [PlanCmd {1 2} $stat ::tclmeasure::MinMaxPPMinAtMaxAt $xname [dict get $resDict vec] $from $to $type]
     }
+    return [PlanCmd {} {}]
 }
 
-proc ::tclmeasure::Avg {x y xstart xend} {
-    set integral [Integ $x $y $xstart $xend false]
-    return [expr {$integral/($xend-$xstart)}]
+proc ::tclmeasure::compile {args} {
+    # Validates a measurement once and returns a command prefix that does it on the data dictionary passed as the only
+    #  argument. Switches are the same as for `measure`, except -data.
+    # Examples of usages:
+    # ```tcl
+    # set riseTime [compile -xname x -trig {-vec y1 -val 0.1 -rise 1} -targ {-vec y1 -val 0.9 -rise 1}]
+    # foreach data $runs {
+    #     lappend results [{*}$riseTime $data]
+    # }
+    # ```
+    # No switches are parsed when the returned command is called, it is a lambda which calls the C command directly,
+    #  and it is byte-compiled on the first call. With -batch switch the returned command does all measurements from
+    #  the batch dictionary and returns dictionary of results, as `measure -batch` does.
+    # Synopsis: -xname value -trig|targ|find|deriv|when|at|integ|avg|rms|min|max|pp|minat|maxat|between|stats|batch
+    #   value ?...?
+    variable definition
+    argparse -help {Validates a measurement once and returns a command prefix that does it on the data dictionary\
+                            passed as the only argument. Switches are the same as for measure, except -data}\
+            $definition [list -data {} {*}$args]
+    if {$data ne {}} {
+        return -code error "-data switch is not allowed, data dictionary is passed to the compiled command"
+    }
+    if {[info exists dataset]} {
+        return -code error "-dataset switch is not allowed, data dictionary is passed to the compiled command"
+    }
+    if {![info exists xname]} {
+        return -code error "-xname switch is required"
+    }
+    if {[info exists batch]} {
+        return [list ::tclmeasure::RunBatch [PlanBatch $xname $batch]]
+    }
+    set plan [Plan $xname [Modes]]
+    set cmd [dict get $plan cmd]
+    set words [lmap word $cmd {list $word}]
+    foreach index [dict get $plan vecs] {
+        lset words $index "\[dict get \$data [list [lindex $cmd $index]]\]"
+    }
+    return [list apply [list data [join $words] ::tclmeasure]]
 }
 
-proc ::tclmeasure::Rms {x y xstart xend} {
-    set ySq [lmap yVal $y {expr {$yVal*$yVal}}]
-    set integral [Integ $x $ySq $xstart $xend false]
-    return [expr {sqrt($integral/($xend-$xstart))}]
+proc ::tclmeasure::stream {args} {
+    # Validates a measurement once and returns a stream command that does it on data fed in chunks, without keeping
+    #  the fed data. Switches are the same as for `measure`, except -data.
+    # Examples of usages:
+    # ```tcl
+    # set m [stream -xname x -trig {-vec y1 -val 0.1 -rise 1} -targ {-vec y1 -val 0.9 -rise 1}]
+    # while {[gets $chan line]>=0} {
+    #     $m feed [dict create x [lindex $line 0] y1 [lindex $line 1]]
+    # }
+    # set riseTime [$m result]
+    # $m destroy
+    # ```
+    # Subcommands of the stream command:
+    #  feed data - feeds a chunk, a dictionary with x list and lists of the measurement, the chunk continues the data
+    #   fed before
+    #  result - returns the result over the data fed so far, a window without -to ends at the last fed point
+    #  reset - forgets the fed data
+    #  destroy - deletes the stream command
+    # Trig-Targ without -vals, Find-At, Integ without -cum, Avg, Rms, Min, Max, PP, MinAt, MaxAt and Stats measurements
+    #  without -vecs can be streamed. With -batch switch the result is the dictionary of results, as `measure -batch`
+    #  returns.
+    # Synopsis: -xname value -trig|targ|find|at|integ|avg|rms|min|max|pp|minat|maxat|stats|batch value ?...?
+    variable definition
+    argparse -help {Validates a measurement once and returns a stream command that does it on data fed in chunks.\
+                            Switches are the same as for measure, except -data}\
+            $definition [list -data {} {*}$args]
+    if {$data ne {}} {
+        return -code error "-data switch is not allowed, data chunks are passed to the feed subcommand"
+    }
+    if {[info exists dataset]} {
+        return -code error "-dataset switch is not allowed, data chunks are passed to the feed subcommand"
+    }
+    if {![info exists xname]} {
+        return -code error "-xname switch is required"
+    }
+    if {[info exists batch]} {
+        return [Stream $xname 1 [dict map {name plan} [PlanBatch $xname $batch] {dict get $plan cmd}]]
+    }
+    return [Stream $xname 0 [dict get [Plan $xname [Modes]] cmd]]
+}
+
+proc ::tclmeasure::sweep {runs args} {
+    # Does a measurement on many runs of the same circuit, as Monte Carlo or parameter sweeps produce, and returns the
+    #  result of every run. Switches are the same as for `measure`, except -data and -dataset.
+    #  runs - list of the runs, each one is a data dictionary or a dataset command created by `dataset create`
+    # Returns dictionary with keys:
+    #  results - list with the result of every run, or with the dictionary of results of every run with -batch
+    #    switch; a measurement that failed on a run gives an empty value
+    #  errors - dictionary with the indexes of the failed runs as the keys and the error messages as the values, with
+    #    -batch switch the values are dictionaries of the messages of the failed measurements
+    # Examples of usages:
+    # ```tcl
+    # set sweep [sweep $datasets -batch {
+    #     delay {-trig {-vec in -val 0.5 -rise 1} -targ {-vec out -val 0.5 -rise 1}}
+    #     power {-avg {-vec i -from 1e-9}}
+    # }]
+    # foreach run [dict get $sweep results] {
+    #     lappend delays [dict get $run delay]
+    # }
+    # ```
+    # Trig-Targ without -vals, Find-At, Integ without -cum, Avg, Rms, Min, Max, PP, MinAt, MaxAt and Stats measurements
+    #  without -vecs are done as the ones of `stream`, with each run fed at once, and the runs are shared between the
+    #  threads set with `configure -threads`. Other measurements are done on each run in turn.
+    # Synopsis: runs ?-xname value? -trig|targ|find|deriv|when|at|integ|avg|rms|min|max|pp|minat|maxat|between|stats
+    #   |batch value ?...?
+    variable definition
+    argparse -help {Does a measurement on many runs and returns the result of every run. Switches are the same as for\
+                            measure, except -data and -dataset}\
+            $definition [list -data {} {*}$args]
+    if {$data ne {}} {
+        return -code error "-data switch is not allowed, data of the runs is passed as the first argument"
+    }
+    if {[info exists dataset]} {
+        return -code error "-dataset switch is not allowed, datasets of the runs are passed as the first argument"
+    }
+    set runsData {}
+    foreach run $runs {
+        if {[llength $run]==1} {
+            set runXname [$run xname]
+            if {![info exists xname]} {
+                set xname $runXname
+            } elseif {$xname ne $runXname} {
+                return -code error "x list '$runXname' of dataset '$run' is not the x list '$xname' of the sweep"
+            }
+            lappend runsData [$run data]
+        } else {
+            lappend runsData $run
+        }
+    }
+    if {![info exists xname]} {
+        return -code error "-xname switch is required"
+    }
+    if {[info exists batch]} {
+        return [Sweep $xname 1 [PlanBatch $xname $batch] $runsData]
+    }
+    return [Sweep $xname 0 [Plan $xname [Modes]] $runsData]
 }